@@ -0,0 +1,337 @@
+#ifndef _ALLOCACCOUNT_H
+#define _ALLOCACCOUNT_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+#include "stageprofile.h"
+
+// Allocation accounting for the geometry containers.
+//
+// GeometryVector, GeometryList and the objects made by makeGeometryShared
+// (with their shared_ptr control blocks) take their memory through
+// GeometryAllocator. It gets the memory from the current AllocationHooks,
+// malloc and free unless an arena or pool has been plugged in, and counts
+// every allocation and free here. Without accounting that is a few updates
+// to thread-local counters per call: the thread's totals and the bytes it
+// has live, which AllocationScope measures peaks from.
+//
+// Define GEOMETRY_ALLOC_ACCOUNTING to turn on ALLOC_SCOPE and the per-stage
+// totals shared by every thread. Allocations are then charged to the stage
+// of the innermost ALLOC_SCOPE on their thread (to "other" outside any),
+// and each scope records the most bytes its block had live at once beyond
+// what was live when it began: the peak resident memory of one query of
+// that stage.
+//
+// Define GEOMETRY_STRICT_ALLOC for strict mode, which implies accounting.
+// An allocation inside an ALLOC_FORBID block then prints its stage and
+// aborts where it happens, in release builds too, so sections meant to be
+// allocation-free stay that way.
+//
+// Memory that does not come through here, such as plain std containers, is
+// seen only if the program also routes it here, as the benchmark's operator
+// new does.
+
+#if defined(GEOMETRY_STRICT_ALLOC) && !defined(GEOMETRY_ALLOC_ACCOUNTING)
+#define GEOMETRY_ALLOC_ACCOUNTING
+#endif
+
+const int   kAllocationOther = ProfileStageCount;   // Stage slot for allocations outside any ALLOC_SCOPE
+
+inline const char *allocationStageName(int stage)
+{
+    return stage == kAllocationOther ? "other" : profileStageName(stage);
+}
+
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+// Per-stage sums over every thread
+struct AllocationStageTotals
+{
+    std::atomic<uint64_t>   count;
+    std::atomic<uint64_t>   bytes;
+    std::atomic<uint64_t>   frees;
+    std::atomic<uint64_t>   freedBytes;
+    std::atomic<uint64_t>   queries;    // ALLOC_SCOPE blocks that ended
+    std::atomic<uint64_t>   peakSum;    // Sum of their peaks, for the mean
+    std::atomic<uint64_t>   peakMax;
+};
+
+inline AllocationStageTotals *allocationStageTotals()
+{
+    static AllocationStageTotals totals[ProfileStageCount + 1] = {};
+    return totals;
+}
+#endif
+
+struct AllocationThreadState
+{
+    int         stage;      // Charged for this thread's allocations
+    int         forbidden;  // ALLOC_FORBID blocks open
+    int64_t     live;       // Bytes allocated less bytes freed by this thread
+    int64_t     peak;       // Highest live since the innermost scope began
+    uint64_t    count;      // Allocations made by this thread
+    uint64_t    bytes;
+};
+
+inline AllocationThreadState &allocationThreadState()
+{
+    static thread_local AllocationThreadState state = { kAllocationOther, 0, 0, 0, 0, 0 };
+    return state;
+}
+
+// Count an allocation or free of this many bytes. GeometryAllocator calls
+// these; so can anything else whose memory should be counted.
+inline void accountAllocation(size_t bytes)
+{
+    AllocationThreadState &t = allocationThreadState();
+#ifdef GEOMETRY_STRICT_ALLOC
+    if (t.forbidden != 0) {
+        fprintf(stderr, "allocation of %llu bytes inside an ALLOC_FORBID block, stage %s\n",
+            static_cast<unsigned long long>(bytes), allocationStageName(t.stage));
+        abort();
+    }
+#endif
+    profileThreadAllocations()++;
+    t.live += static_cast<int64_t>(bytes);
+    t.peak = t.live > t.peak ? t.live : t.peak;
+    t.count++;
+    t.bytes += bytes;
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+    AllocationStageTotals &s = allocationStageTotals()[t.stage];
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+#endif
+}
+
+inline void accountFree(size_t bytes)
+{
+    AllocationThreadState &t = allocationThreadState();
+    t.live -= static_cast<int64_t>(bytes);
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+    AllocationStageTotals &s = allocationStageTotals()[t.stage];
+    s.frees.fetch_add(1, std::memory_order_relaxed);
+    s.freedBytes.fetch_add(bytes, std::memory_order_relaxed);
+#endif
+}
+
+struct AllocationTotals
+{
+    uint64_t    count;
+    uint64_t    bytes;
+};
+
+// Allocations this thread has made so far
+inline AllocationTotals allocationTotals()
+{
+    const AllocationThreadState &t = allocationThreadState();
+    AllocationTotals sum = { t.count, t.bytes };
+    return sum;
+}
+
+// Where geometry memory comes from. context is passed back to both calls.
+struct AllocationHooks
+{
+    void    *(*allocate)(size_t bytes, void *context);
+    void    (*deallocate)(void *p, size_t bytes, void *context);
+    void    *context;
+};
+
+inline void *mallocAllocate(size_t bytes, void *)
+{
+    return malloc(bytes > 0 ? bytes : 1);
+}
+
+inline void mallocDeallocate(void *p, size_t, void *)
+{
+    free(p);
+}
+
+inline AllocationHooks &allocationHooks()
+{
+    static AllocationHooks hooks = { mallocAllocate, mallocDeallocate, NULL };
+    return hooks;
+}
+
+// Install before any geometry container exists: memory goes back to the
+// hooks current when it is freed, which must be the ones it came from
+inline void setAllocationHooks(const AllocationHooks &hooks)
+{
+    allocationHooks() = hooks;
+}
+
+inline void *geometryAllocate(size_t bytes)
+{
+    const AllocationHooks &h = allocationHooks();
+    void *p = h.allocate(bytes, h.context);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    accountAllocation(bytes);
+    return p;
+}
+
+inline void geometryFree(void *p, size_t bytes)
+{
+    if (p == NULL) {
+        return;
+    }
+    accountFree(bytes);
+    const AllocationHooks &h = allocationHooks();
+    h.deallocate(p, bytes, h.context);
+}
+
+// Standard allocator over geometryAllocate, stateless so containers swap
+// and splice freely
+template <class T>
+class GeometryAllocator
+{
+public:
+    typedef T value_type;
+
+    GeometryAllocator() {}
+    template <class U> GeometryAllocator(const GeometryAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(geometryAllocate(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { geometryFree(p, n * sizeof(T)); }
+};
+
+template <class T, class U>
+inline bool operator==(const GeometryAllocator<T> &, const GeometryAllocator<U> &) { return true; }
+
+template <class T, class U>
+inline bool operator!=(const GeometryAllocator<T> &, const GeometryAllocator<U> &) { return false; }
+
+template <class T> using GeometryVector = std::vector<T, GeometryAllocator<T> >;
+template <class T> using GeometryList = std::list<T, GeometryAllocator<T> >;
+
+// make_shared through GeometryAllocator: the object and its control block
+// are one counted allocation
+template <class T, class... Args>
+inline std::shared_ptr<T> makeGeometryShared(Args &&... args)
+{
+    return std::allocate_shared<T>(GeometryAllocator<T>(), std::forward<Args>(args)...);
+}
+
+// Charges the rest of its block's allocations to a stage, and measures the
+// block's peak. With no stage, only measures.
+class AllocationScope
+{
+public:
+    explicit AllocationScope(int stage = -1) : stage(stage)
+    {
+        AllocationThreadState &t = allocationThreadState();
+        previous = t.stage;
+        outerPeak = t.peak;
+        start = t.live;
+        t.peak = t.live;
+        t.stage = stage >= 0 ? stage : t.stage;
+    }
+
+    ~AllocationScope()
+    {
+        AllocationThreadState &t = allocationThreadState();
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+        uint64_t peak = PeakBytes();
+#endif
+        t.stage = previous;
+        t.peak = t.peak > outerPeak ? t.peak : outerPeak;
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+        if (stage < 0) {
+            return;
+        }
+        AllocationStageTotals &s = allocationStageTotals()[stage];
+        s.queries.fetch_add(1, std::memory_order_relaxed);
+        s.peakSum.fetch_add(peak, std::memory_order_relaxed);
+        uint64_t seen = s.peakMax.load(std::memory_order_relaxed);
+        while (peak > seen && !s.peakMax.compare_exchange_weak(seen, peak, std::memory_order_relaxed)) {
+        }
+#endif
+    }
+
+    // Most bytes live at once so far in the block, beyond those live when it began
+    uint64_t PeakBytes() const
+    {
+        const AllocationThreadState &t = allocationThreadState();
+        return t.peak > start ? static_cast<uint64_t>(t.peak - start) : 0;
+    }
+
+private:
+    int         stage;
+    int         previous;
+    int64_t     start;
+    int64_t     outerPeak;
+};
+
+// Marks its block as allocation-free for strict mode
+class NoAllocationScope
+{
+public:
+    NoAllocationScope() { allocationThreadState().forbidden++; }
+    ~NoAllocationScope() { allocationThreadState().forbidden--; }
+};
+
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+// One line per stage that allocated or ran a query: allocations and bytes,
+// frees, and the mean and largest peak per query
+inline void printAllocations(FILE *f)
+{
+    fprintf(f, "%-16s %10s %12s %10s %10s %12s %12s\n", "stage", "allocs", "bytes", "frees", "queries", "mean_peak", "max_peak");
+    for (int s = 0; s <= ProfileStageCount; s++) {
+        const AllocationStageTotals &t = allocationStageTotals()[s];
+        uint64_t queries = t.queries.load();
+        if (t.count.load() == 0 && queries == 0) {
+            continue;
+        }
+        fprintf(f, "%-16s %10llu %12llu %10llu %10llu %12.1f %12llu\n", allocationStageName(s),
+            static_cast<unsigned long long>(t.count.load()), static_cast<unsigned long long>(t.bytes.load()),
+            static_cast<unsigned long long>(t.frees.load()), static_cast<unsigned long long>(queries),
+            queries > 0 ? static_cast<double>(t.peakSum.load()) / queries : 0.0, static_cast<unsigned long long>(t.peakMax.load()));
+    }
+}
+
+// The same totals as JSON. Returns false if the file could not be written.
+inline bool writeAllocations(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "{\n  \"stages\": [");
+    bool first = true;
+    for (int s = 0; s <= ProfileStageCount; s++) {
+        const AllocationStageTotals &t = allocationStageTotals()[s];
+        uint64_t queries = t.queries.load();
+        if (t.count.load() == 0 && queries == 0) {
+            continue;
+        }
+        fprintf(f, "%s\n    {\"stage\": \"%s\", \"allocations\": %llu, \"bytes\": %llu, \"frees\": %llu, \"freed_bytes\": %llu, "
+            "\"queries\": %llu, \"mean_peak_bytes\": %.1f, \"max_peak_bytes\": %llu}",
+            first ? "" : ",", allocationStageName(s), static_cast<unsigned long long>(t.count.load()),
+            static_cast<unsigned long long>(t.bytes.load()), static_cast<unsigned long long>(t.frees.load()),
+            static_cast<unsigned long long>(t.freedBytes.load()), static_cast<unsigned long long>(queries),
+            queries > 0 ? static_cast<double>(t.peakSum.load()) / queries : 0.0, static_cast<unsigned long long>(t.peakMax.load()));
+        first = false;
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+#define ALLOC_SCOPE(name, stage)    AllocationScope name(stage)
+#else
+#define ALLOC_SCOPE(name, stage)
+#endif
+
+#ifdef GEOMETRY_STRICT_ALLOC
+#define ALLOC_FORBID(name)          NoAllocationScope name
+#else
+#define ALLOC_FORBID(name)
+#endif
+
+#endif
@@ -0,0 +1,1155 @@
+// Console benchmark for the portable geometry kernels.
+// Builds on Windows through Benchmark.vcxproj, or on Linux with
+//     g++ -O2 -std=c++14 -pthread benchmark.cpp -o benchmark
+//
+//     benchmark [maxPoints]                        scaling tables
+//     benchmark --suite [--json out.json] [--perf out.json] [--allocs out.json] [maxPoints]
+//                                                  per-kernel suite
+//     benchmark --trace out.trace [pointsPerGroup] write a synthetic input trace
+//     benchmark --replay in.trace [--chrome out.json] [--perf out.json] [--allocs out.json] [--interval us]
+//                                                  per-event latency of a trace, and
+//                                                  the same trace with scheduled recomputes
+//     benchmark --check [pairs]                    support-polygon GJK against the point-set
+//                                                  GJK on random pairs, exit 1 on any mismatch
+// Add -DGEOMETRY_PROFILE for per-stage times in the replay and the Chrome trace,
+// and on Linux -DGEOMETRY_PERF_COUNTERS for hardware counters per kernel in the
+// suite and the replay (--perf out.json writes them as JSON).
+// -DGEOMETRY_ALLOC_ACCOUNTING adds allocations and peak bytes per stage
+// (--allocs out.json writes them as JSON); -DGEOMETRY_STRICT_ALLOC also
+// asserts that the kernels meant to be allocation-free are.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "allocaccount.h"
+#include "calipers.h"
+#include "geometry.h"
+#include "hull2d.h"
+#include "hullkernel.h"
+#include "hullshard.h"
+#include "inputtrace.h"
+#include "intersection2d.h"
+#include "narrowphase.h"
+#include "narrowphase3d.h"
+#include "onlinehull.h"
+#include "perfcounters.h"
+#include "pointcloud.h"
+#include "quickhull3d.h"
+#include "raycast.h"
+#include "stageprofile.h"
+#include "support2d.h"
+#include "workload.h"
+
+using namespace std;
+
+// Every allocation in the process goes through these and is counted by
+// allocaccount.h, so the suite can report allocations per call. Each block
+// keeps its size in a header in front of it, so frees are counted in bytes.
+const size_t kAllocationHeader = 16;
+
+// GCC sees the free below inlined against a new-expression and warns, and
+// takes the size header in front of an inlined block as out of its bounds
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+
+void *operator new(size_t bytes)
+{
+    void *block = malloc(bytes + kAllocationHeader);
+    if (block == NULL) {
+        throw bad_alloc();
+    }
+    *static_cast<size_t *>(block) = bytes;
+    accountAllocation(bytes);
+    return static_cast<char *>(block) + kAllocationHeader;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p == NULL) {
+        return;
+    }
+    void *block = static_cast<char *>(p) - kAllocationHeader;
+    accountFree(*static_cast<size_t *>(block));
+    free(block);
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+// Uniform points in the cube [-1, 1]^3; the hull keeps O(log^2 n) of them
+void CubePoints(int n, mt19937 &rng, vector<Vec3> *points)
+{
+    uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    points->resize(n);
+    for (int i = 0; i < n; i++) {
+        (*points)[i] = MakeVec3(dist(rng), dist(rng), dist(rng));
+    }
+}
+
+// Uniform points on the unit sphere; every point is a hull vertex
+void SpherePoints(int n, mt19937 &rng, vector<Vec3> *points)
+{
+    normal_distribution<float> dist(0.0f, 1.0f);
+    points->resize(n);
+    for (int i = 0; i < n; i++) {
+        Vec3 p = MakeVec3(dist(rng), dist(rng), dist(rng));
+        (*points)[i] = p * (1.0f / length(p));
+    }
+}
+
+// Best of a few runs, in milliseconds
+double TimeHull3D(QuickHull3D &builder, const vector<Vec3> &points, HalfEdgeMesh *mesh)
+{
+    double best = 0.0;
+    int runs = points.size() >= 1000000 ? 1 : 3;
+    for (int r = 0; r < runs; r++) {
+        auto start = chrono::steady_clock::now();
+        builder.Build(&points[0], static_cast<int>(points.size()), mesh);
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+        if (r == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+// Scaling of the 3D QuickHull. The slope column is the log-log growth rate
+// between consecutive sizes: about 1 means linear, and n log n shows up as a
+// little above 1.
+void BenchmarkQuickHull3D(int maxPoints)
+{
+    const char *names[2] = { "cube", "sphere" };
+    QuickHull3D builder;
+    HalfEdgeMesh mesh;
+    vector<Vec3> points;
+
+    printf("%-8s %10s %12s %10s %8s %8s\n", "3d", "n", "ms", "ns/point", "faces", "slope");
+    for (int d = 0; d < 2; d++) {
+        double prevMs = 0.0;
+        int prevN = 0;
+        for (int n = 1000; n <= maxPoints; n *= 10) {
+            mt19937 rng(12345);
+            if (d == 0) {
+                CubePoints(n, rng, &points);
+            }
+            else {
+                SpherePoints(n, rng, &points);
+            }
+
+            double ms = TimeHull3D(builder, points, &mesh);
+            printf("%-8s %10d %12.3f %10.1f %8d", names[d], n, ms, ms * 1e6 / n, static_cast<int>(mesh.faces.size()));
+            if (prevN > 0 && prevMs > 0.0) {
+                printf(" %8.2f", log(ms / prevMs) / log(static_cast<double>(n) / prevN));
+            }
+            printf("\n");
+            prevMs = ms;
+            prevN = n;
+        }
+    }
+}
+
+// Input coordinate for each scalar type; the int32 path uses 8 fractional bits
+template <class Scalar> Scalar BenchCoord(float v) { return static_cast<Scalar>(v); }
+template <> int32_t BenchCoord<int32_t>(float v) { return static_cast<int32_t>(floor(v * 256.0 + 0.5)); }
+
+// Uniform points in a 4096 pixel square
+template <class Scalar>
+void SquarePoints2D(int n, mt19937 &rng, vector<HullPointT<Scalar> > *points)
+{
+    uniform_real_distribution<float> dist(0.0f, 4096.0f);
+    points->resize(n);
+    for (int i = 0; i < n; i++) {
+        (*points)[i] = MakeHullPoint(BenchCoord<Scalar>(dist(rng)), BenchCoord<Scalar>(dist(rng)));
+    }
+}
+
+// Points on a circle, so every point is a hull vertex
+template <class Scalar>
+void CirclePoints2D(int n, float cx, float cy, float r, mt19937 &rng, vector<HullPointT<Scalar> > *points)
+{
+    uniform_real_distribution<float> dist(0.0f, 6.2831853f);
+    points->resize(n);
+    for (int i = 0; i < n; i++) {
+        float a = dist(rng);
+        (*points)[i] = MakeHullPoint(BenchCoord<Scalar>(cx + r * cosf(a)), BenchCoord<Scalar>(cy + r * sinf(a)));
+    }
+}
+
+double ElapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+template <class Scalar>
+void HullVertices2D(const vector<HullPointT<Scalar> > &points, vector<HullPointT<Scalar> > *hull)
+{
+    vector<int> index;
+    convexHull(&points[0], static_cast<int>(points.size()), &index);
+    hull->clear();
+    for (size_t i = 0; i < index.size(); i++) {
+        hull->push_back(points[index[i]]);
+    }
+}
+
+// Monotone chain, QuickHull and the online hull, minimum-area box, Minkowski difference,
+// convex intersection, batch containment, batch support, the streaming
+// epsilon kernel and GJK on the 2D kernels,
+// instantiated once per scalar type so float, double and fixed point compare
+// on identical inputs
+template <class Scalar>
+void BenchmarkHull2D(const char *mode, int maxPoints)
+{
+    vector<HullPointT<Scalar> > points, circleA, circleB, hullA, hullB, difference;
+    vector<HullPointT<typename ScalarTraits<Scalar>::Real> > region;
+    vector<int> hull;
+    vector<Scalar> xs, ys;
+    vector<uint8_t> inside;
+    vector<typename ScalarTraits<Scalar>::Wide> dxs, dys;
+    vector<int> extreme;
+    SupportPolygon<Scalar> polygon;
+
+    printf("%-8s %10s %12s %12s %12s %12s %12s %12s %12s %12s %12s %12s\n", mode, "n", "hull ns/pt", "qhull ns/pt", "online ns/pt", "box ns/pt", "mink ns/pt", "clip ns/pt", "inside ns/pt", "sup ns/q", "kern ns/pt", "gjk us");
+    for (int n = 1000; n <= maxPoints; n *= 10) {
+        mt19937 rng(12345);
+        SquarePoints2D(n, rng, &points);
+        CirclePoints2D(n / 10, 1000.0f, 1000.0f, 500.0f, rng, &circleA);
+        CirclePoints2D(n / 10, 1600.0f, 1200.0f, 400.0f, rng, &circleB);
+
+        auto start = chrono::steady_clock::now();
+        convexHull(&points[0], n, &hull);
+        double hullMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        quickHull(&points[0], n, &hull);
+        double quickMs = ElapsedMs(start);
+
+        OnlineHull<Scalar> online;
+        start = chrono::steady_clock::now();
+        online.InsertBatch(&points[0], n);
+        double onlineMs = ElapsedMs(start);
+
+        HullVertices2D(circleA, &hullA);
+        HullVertices2D(circleB, &hullB);
+        int m = static_cast<int>(hullA.size() + hullB.size());
+
+        OrientedRect<typename ScalarTraits<Scalar>::Real> box;
+        start = chrono::steady_clock::now();
+        minAreaRect(&hullA[0], static_cast<int>(hullA.size()), &box, HullPointAccessor<Scalar>());
+        double boxMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        minkowskiDifference(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()), &difference);
+        double minkMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        convexIntersection(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()), &region);
+        double clipMs = ElapsedMs(start);
+
+        xs.resize(n);
+        ys.resize(n);
+        inside.resize(n);
+        for (int i = 0; i < n; i++) {
+            xs[i] = points[i].x;
+            ys[i] = points[i].y;
+        }
+        start = chrono::steady_clock::now();
+        hullContainsBatch(&hullA[0], static_cast<int>(hullA.size()), &xs[0], &ys[0], n, &inside[0]);
+        double insideMs = ElapsedMs(start);
+
+        // Directions from the same random points, relative to the square center
+        dxs.resize(n);
+        dys.resize(n);
+        extreme.resize(n);
+        for (int i = 0; i < n; i++) {
+            dxs[i] = static_cast<typename ScalarTraits<Scalar>::Wide>(xs[i]) - BenchCoord<Scalar>(2048.0f);
+            dys[i] = static_cast<typename ScalarTraits<Scalar>::Wide>(ys[i]) - BenchCoord<Scalar>(2048.0f);
+        }
+        polygon.Build(&hullA[0], static_cast<int>(hullA.size()));
+        start = chrono::steady_clock::now();
+        polygon.SupportBatch(&dxs[0], &dys[0], n, &extreme[0]);
+        double supportMs = ElapsedMs(start);
+
+        HullKernel<Scalar> kernel;
+        start = chrono::steady_clock::now();
+        kernel.InsertBatch(&xs[0], &ys[0], n);
+        double kernelMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        bool overlap = gjkOverlap(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()));
+        double gjkMs = ElapsedMs(start);
+
+        printf("%-8s %10d %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f %12.2f %12.1f %12.1f %12.1f%s\n", mode, n, hullMs * 1e6 / n, quickMs * 1e6 / n, onlineMs * 1e6 / n, boxMs * 1e6 / hullA.size(), minkMs * 1e6 / m, clipMs * 1e6 / m,
+            insideMs * 1e6 / (static_cast<double>(n) * hullA.size()), supportMs * 1e6 / n, kernelMs * 1e6 / n, gjkMs * 1e3, overlap ? "" : " (separate)");
+    }
+}
+
+// Cross-check of gjkOverlap on SupportPolygons, which climbs from the last
+// support vertex or binary-searches, against the point-set gjkOverlap, which
+// scans every vertex. The pairs are circle hulls of 3 to 300 points. Half
+// are placed anywhere nearby, half within 10% of touching, where a wrong
+// support vertex would flip the answer. Returns the pairs they disagree on.
+template <class Scalar>
+int CheckGJK2D(const char *mode, int pairs)
+{
+    mt19937 rng(12345);
+    uniform_int_distribution<int> count(3, 300);
+    uniform_real_distribution<float> radius(10.0f, 400.0f);
+    uniform_real_distribution<float> offset(-800.0f, 800.0f);
+    uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    uniform_real_distribution<float> gap(0.9f, 1.1f);
+    vector<HullPointT<Scalar> > cloud, hullA, hullB;
+    SupportPolygon<Scalar> polygonA, polygonB;
+    int overlaps = 0;
+    int disagreements = 0;
+    for (int i = 0; i < pairs; i++) {
+        float ra = radius(rng);
+        float rb = radius(rng);
+        float dx = offset(rng);
+        float dy = offset(rng);
+        if (i % 2 == 1) {
+            float a = angle(rng);
+            float d = (ra + rb) * gap(rng);
+            dx = d * cosf(a);
+            dy = d * sinf(a);
+        }
+        CirclePoints2D(count(rng), 2048.0f, 2048.0f, ra, rng, &cloud);
+        HullVertices2D(cloud, &hullA);
+        CirclePoints2D(count(rng), 2048.0f + dx, 2048.0f + dy, rb, rng, &cloud);
+        HullVertices2D(cloud, &hullB);
+        polygonA.Build(&hullA[0], static_cast<int>(hullA.size()));
+        polygonB.Build(&hullB[0], static_cast<int>(hullB.size()));
+
+        bool expected = gjkOverlap(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()));
+        bool got = gjkOverlap(polygonA, polygonB);
+        overlaps += expected ? 1 : 0;
+        if (got != expected) {
+            if (disagreements < 10) {
+                printf("%-8s %-8s pair %d (%d and %d vertices): point set %s, support polygon %s\n", "check", mode, i,
+                    static_cast<int>(hullA.size()), static_cast<int>(hullB.size()), expected ? "overlap" : "apart", got ? "overlap" : "apart");
+            }
+            disagreements++;
+        }
+    }
+    printf("%-8s %-8s %10d %10d %10d\n", "check", mode, pairs, overlaps, disagreements);
+    return disagreements;
+}
+
+// Small random hulls scattered over a 4096 pixel square
+void RandomShapes2D(int count, mt19937 &rng, ShapeSet *shapes)
+{
+    uniform_real_distribution<float> center(0.0f, 4096.0f);
+    vector<HullPointT<float> > cloud, hull;
+    vector<Vec2> polygon;
+    shapes->Clear();
+    for (int i = 0; i < count; i++) {
+        CirclePoints2D(12, center(rng), center(rng), 40.0f, rng, &cloud);
+        HullVertices2D(cloud, &hull);
+        polygon.clear();
+        for (size_t k = 0; k < hull.size(); k++) {
+            polygon.push_back(MakeVec2(hull[k].x, hull[k].y));
+        }
+        shapes->AddShape(&polygon[0], static_cast<int>(polygon.size()));
+    }
+}
+
+// Swept time of impact over candidate pairs of small random hulls, one
+// thread, so ns/pair is the per-pair cost a broad phase would pay
+void BenchmarkTimeOfImpact(int maxPoints)
+{
+    ShapeSet shapes;
+    vector<Vec2> velocities;
+    vector<ShapePair> pairs;
+    TimeOfImpactResults results;
+    NarrowPhaseBatch batch(1);
+
+    printf("%-8s %10s %12s %12s\n", "toi", "pairs", "ns/pair", "hit %");
+    for (int n = 1000; n <= maxPoints; n *= 10) {
+        mt19937 rng(12345);
+        uniform_real_distribution<float> speed(-400.0f, 400.0f);
+        int shapeCount = n / 10 > 2 ? n / 10 : 2;
+        RandomShapes2D(shapeCount, rng, &shapes);
+        velocities.clear();
+        for (int i = 0; i < shapeCount; i++) {
+            velocities.push_back(MakeVec2(speed(rng), speed(rng)));
+        }
+        pairs.resize(n);
+        for (int i = 0; i < n; i++) {
+            pairs[i].a = static_cast<int>(rng() % shapeCount);
+            pairs[i].b = (pairs[i].a + 1 + static_cast<int>(rng() % (shapeCount - 1))) % shapeCount;
+        }
+        results.Resize(n);
+
+        auto start = chrono::steady_clock::now();
+        batch.RunTimeOfImpact(shapes, &velocities[0], &pairs[0], n, &results);
+        double ms = ElapsedMs(start);
+
+        int hits = 0;
+        for (int i = 0; i < n; i++) {
+            hits += results.hit[i];
+        }
+        printf("%-8s %10d %12.1f %12.1f\n", "toi", n, ms * 1e6 / n, 100.0 * hits / n);
+    }
+}
+
+// Placement with a uniformly random rotation, from a random unit quaternion
+Pose3 RandomPose3(mt19937 &rng, Vec3 position)
+{
+    normal_distribution<float> dist(0.0f, 1.0f);
+    float w = dist(rng), x = dist(rng), y = dist(rng), z = dist(rng);
+    float scale = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+    w *= scale;
+    x *= scale;
+    y *= scale;
+    z *= scale;
+    Pose3 pose = Pose3::Translation(position);
+    pose.row0 = MakeVec3(1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y));
+    pose.row1 = MakeVec3(2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x));
+    pose.row2 = MakeVec3(2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y));
+    return pose;
+}
+
+// Per-pair cost of the 3D narrow phase on hulls of points on the unit
+// sphere, rotated at random, with centres 0 to 4 apart so about half the
+// pairs overlap. Each pair keeps a warm-start cache per query from pass to
+// pass, as it would from frame to frame, and the best pass is reported. The scan
+// column runs the boolean test without the adjacency, so every support call
+// visits every vertex; the gap to it is what hill-climbing saves.
+void BenchmarkNarrowPhase3D(int maxPoints)
+{
+    const int shapeCount = 64;
+    const int pairCount = 4096;
+    const int passes = 3;
+    QuickHull3D builder;
+    HalfEdgeMesh mesh;
+    vector<Vec3> points;
+    vector<ConvexPolyhedron> shapes(shapeCount), scans(shapeCount);
+    vector<Pose3> posesA(pairCount), posesB(pairCount);
+    vector<int> shapeA(pairCount), shapeB(pairCount);
+    vector<GJKCache3D> boolCaches(pairCount), distCaches(pairCount), epaCaches(pairCount);
+    vector<char> overlap(pairCount);
+    vector<float> distance(pairCount);
+    EPAScratch3D scratch;
+
+    printf("%-8s %10s %12s %12s %12s %12s %8s\n", "gjk3d", "vertices", "bool ns", "scan ns", "dist ns", "epa ns", "hit %");
+    for (int n = 16; n <= maxPoints && n <= 4096; n *= 4) {
+        mt19937 rng(12345);
+        for (int s = 0; s < shapeCount; s++) {
+            SpherePoints(n, rng, &points);
+            builder.Build(&points[0], n, &mesh);
+            shapes[s].FromMesh(mesh);
+            scans[s] = shapes[s];
+            scans[s].neighbors.clear();
+        }
+        normal_distribution<float> direction(0.0f, 1.0f);
+        uniform_real_distribution<float> position(-100.0f, 100.0f);
+        uniform_real_distribution<float> apart(0.0f, 4.0f);
+        for (int i = 0; i < pairCount; i++) {
+            Vec3 a = MakeVec3(position(rng), position(rng), position(rng));
+            Vec3 d = MakeVec3(direction(rng), direction(rng), direction(rng));
+            posesA[i] = RandomPose3(rng, a);
+            posesB[i] = RandomPose3(rng, a + d * (apart(rng) / length(d)));
+            shapeA[i] = static_cast<int>(rng() % shapeCount);
+            shapeB[i] = static_cast<int>(rng() % shapeCount);
+        }
+
+        double boolNs = 0.0, scanNs = 0.0, distNs = 0.0, epaNs = 0.0;
+        int hits = 0;
+        for (int pass = 0; pass < passes; pass++) {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < pairCount; i++) {
+                overlap[i] = gjkOverlap3D(shapes[shapeA[i]], posesA[i], shapes[shapeB[i]], posesB[i], &boolCaches[i]);
+            }
+            double ns = ElapsedMs(start) * 1e6 / pairCount;
+            boolNs = pass == 0 || ns < boolNs ? ns : boolNs;
+
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < pairCount; i++) {
+                GJKCache3D cold;
+                overlap[i] = gjkOverlap3D(scans[shapeA[i]], posesA[i], scans[shapeB[i]], posesB[i], &cold);
+            }
+            ns = ElapsedMs(start) * 1e6 / pairCount;
+            scanNs = pass == 0 || ns < scanNs ? ns : scanNs;
+
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < pairCount; i++) {
+                Vec3 pointA, pointB;
+                distance[i] = gjkDistance3D(shapes[shapeA[i]], posesA[i], shapes[shapeB[i]], posesB[i], &distCaches[i], &pointA, &pointB);
+            }
+            ns = ElapsedMs(start) * 1e6 / pairCount;
+            distNs = pass == 0 || ns < distNs ? ns : distNs;
+
+            // EPA only on the pairs that overlap, as a contact solver would call it
+            hits = 0;
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < pairCount; i++) {
+                if (overlap[i]) {
+                    Vec3 normal;
+                    float depth;
+                    epaPenetration3D(shapes[shapeA[i]], posesA[i], shapes[shapeB[i]], posesB[i], &epaCaches[i], scratch, &normal, &depth);
+                    hits++;
+                }
+            }
+            ns = hits > 0 ? ElapsedMs(start) * 1e6 / hits : 0.0;
+            epaNs = pass == 0 || ns < epaNs ? ns : epaNs;
+        }
+        printf("%-8s %10d %12.1f %12.1f %12.1f %12.1f %8.1f\n", "gjk3d", static_cast<int>(shapes[0].vertices.size()),
+            boolNs, scanNs, distNs, epaNs, 100.0 * hits / pairCount);
+    }
+}
+
+// Nearest hit for n rays from random points in random directions against
+// n / 10 hulls in a BVH, as rays and as swept circles
+void BenchmarkRayCast(int maxPoints)
+{
+    ShapeSet shapes;
+    ShapeBVH bvh;
+    vector<float> ox, oy, dx, dy;
+    RayHits hits;
+
+    printf("%-8s %10s %12s %12s %12s %12s\n", "ray", "rays", "shapes", "build ms", "ray ns", "circle ns");
+    for (int n = 1000; n <= maxPoints; n *= 10) {
+        mt19937 rng(12345);
+        uniform_real_distribution<float> position(0.0f, 4096.0f);
+        uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+        int shapeCount = n / 10;
+        RandomShapes2D(shapeCount, rng, &shapes);
+
+        auto start = chrono::steady_clock::now();
+        bvh.Build(shapes);
+        double buildMs = ElapsedMs(start);
+
+        ox.resize(n);
+        oy.resize(n);
+        dx.resize(n);
+        dy.resize(n);
+        for (int i = 0; i < n; i++) {
+            float a = angle(rng);
+            ox[i] = position(rng);
+            oy[i] = position(rng);
+            dx[i] = cosf(a);
+            dy[i] = sinf(a);
+        }
+        hits.Resize(n);
+
+        start = chrono::steady_clock::now();
+        bvh.CastRays(shapes, &ox[0], &oy[0], &dx[0], &dy[0], n, 0.0f, 8192.0f, &hits);
+        double rayMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        bvh.CastRays(shapes, &ox[0], &oy[0], &dx[0], &dy[0], n, 8.0f, 8192.0f, &hits);
+        double circleMs = ElapsedMs(start);
+
+        printf("%-8s %10d %12d %12.2f %12.1f %12.1f\n", "ray", n, shapeCount, buildMs, rayMs * 1e6 / n, circleMs * 1e6 / n);
+    }
+}
+
+// One hull over 64 shards: the shard summaries merged in process, and the
+// same split over worker processes where fork is available. bytes is the
+// summary the coordinator receives. No other thread is running here, as
+// shardedHull requires.
+void BenchmarkShardedHull(int maxPoints)
+{
+    const int shards = 64;
+    vector<HullPointT<double> > points;
+    vector<HullSummary<double> > parts(shards);
+    HullSummary<double> merged;
+
+    printf("%-8s %10s %12s %12s %12s %12s\n", "shard", "points", "hull ms", "merge ms", "fork ms", "bytes");
+    for (int n = 1000; n <= maxPoints; n *= 10) {
+        mt19937 rng(12345);
+        SquarePoints2D(n, rng, &points);
+
+        auto start = chrono::steady_clock::now();
+        summarizeHull(&points[0], n, &merged);
+        double hullMs = ElapsedMs(start);
+
+        for (int s = 0; s < shards; s++) {
+            int begin = static_cast<int>(static_cast<int64_t>(n) * s / shards);
+            int end = static_cast<int>(static_cast<int64_t>(n) * (s + 1) / shards);
+            summarizeHull(&points[begin], end - begin, &parts[s]);
+        }
+        start = chrono::steady_clock::now();
+        mergeHullSummaries(&parts[0], shards, &merged);
+        double mergeMs = ElapsedMs(start);
+
+        double forkMs = 0.0;
+        size_t bytes = hullSummaryBytes<double>(merged.vertices.size());
+#ifndef _WIN32
+        start = chrono::steady_clock::now();
+        if (!shardedHull(&points[0], n, 4, &merged, &bytes)) {
+            printf("shard    worker processes failed\n");
+            return;
+        }
+        forkMs = ElapsedMs(start);
+#endif
+        printf("%-8s %10d %12.2f %12.3f %12.2f %12d\n", "shard", n, hullMs, mergeMs, forkMs, static_cast<int>(bytes));
+    }
+}
+
+// Point cloud file of n points in four groups: writing it, mapping it, the
+// hull of one group and the containment of the next in that hull, both run
+// straight on the mapped pages
+void BenchmarkPointCloud(int maxPoints)
+{
+    const char *path = "benchmark.pcld";
+    vector<float> xs, ys;
+    vector<uint32_t> groups;
+    vector<HullPointT<float> > hull;
+    vector<uint8_t> inside;
+
+    printf("%-8s %10s %12s %12s %12s %12s\n", "cloud", "points", "write ms", "open ms", "hull ns/pt", "in ns/pt");
+    for (int n = 1000; n <= maxPoints; n *= 10) {
+        mt19937 rng(12345);
+        uniform_real_distribution<float> dist(0.0f, 4096.0f);
+        xs.resize(n);
+        ys.resize(n);
+        groups.resize(n);
+        for (int i = 0; i < n; i++) {
+            xs[i] = dist(rng);
+            ys[i] = dist(rng);
+            groups[i] = static_cast<uint32_t>(rng() % 4);
+        }
+
+        auto start = chrono::steady_clock::now();
+        bool written = writePointCloud(path, &xs[0], &ys[0], &groups[0], n);
+        double writeMs = ElapsedMs(start);
+
+        PointCloudFile cloud;
+        start = chrono::steady_clock::now();
+        if (!written || !cloud.Open(path)) {
+            printf("cloud    could not write or map %s\n", path);
+            return;
+        }
+        double openMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        pointCloudHull(cloud, 0, &hull);
+        double hullMs = ElapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        pointCloudContains(cloud, 1, &hull[0], static_cast<int>(hull.size()), &inside);
+        double insideMs = ElapsedMs(start);
+
+        double per0 = 1e6 / static_cast<double>(cloud.Group(0).count);
+        double per1 = 1e6 / static_cast<double>(cloud.Group(1).count);
+        printf("%-8s %10d %12.2f %12.3f %12.2f %12.2f\n", "cloud", n, writeMs, openMs, hullMs * per0, insideMs * per1);
+        cloud.Close();
+        remove(path);
+    }
+}
+
+// Every workload streamed a chunk at a time into an epsilon kernel, so
+// memory stays flat however many points are generated
+void BenchmarkWorkloads(int maxPoints)
+{
+    float xs[kWorkloadChunk];
+    float ys[kWorkloadChunk];
+
+    printf("%-8s %-10s %10s %12s %12s\n", "workload", "kind", "points", "gen ns/pt", "kernel");
+    for (int d = 0; d < WorkloadDistributionCount; d++) {
+        for (int n = 1000; n <= maxPoints; n *= 10) {
+            WorkloadGenerator generator(makeWorkload(static_cast<WorkloadDistribution>(d), n));
+            HullKernel<float> kernel;
+            double genMs = 0.0;
+            for (;;) {
+                auto start = chrono::steady_clock::now();
+                int m = generator.Next(xs, ys, NULL, kWorkloadChunk);
+                genMs += ElapsedMs(start);
+                if (m == 0) {
+                    break;
+                }
+                kernel.InsertBatch(xs, ys, m);
+            }
+            vector<HullPointT<float> > hull;
+            kernel.Vertices(&hull);
+            printf("%-8s %-10s %10d %12.2f %12d\n", "workload", workloadName(static_cast<WorkloadDistribution>(d)), n, genMs * 1e6 / n, static_cast<int>(hull.size()));
+        }
+    }
+}
+
+const double    kSuiteMinMs = 25.0;    // Each case repeats until it has run this long
+const int       kSuitePerfCalls = 64;   // Calls per case counted with hardware counters
+const int       kSuiteQueries = 4096;   // Containment queries per call, spread over the scene
+
+volatile int    suiteSink;              // Keeps results alive past the optimizer
+
+// The pointer read back through a volatile, so a call on fixed inputs cannot
+// be hoisted out of the timing loop
+template <class T>
+T *Opaque(T *p)
+{
+    T *volatile q = p;
+    return q;
+}
+
+struct SuiteResult
+{
+    string      kernel;
+    string      distribution;
+    int         size;           // Workload points
+    int         points;         // Input points per call
+    uint64_t    iterations;
+    double      nsPerCall;
+    double      allocsPerCall;
+    double      bytesPerCall;
+    uint64_t    peakBytes;      // Most bytes live at once during one call
+    int         hullSize;
+};
+
+// Time body, repeating it with more iterations until one run lasts
+// kSuiteMinMs. body returns a value that depends on its work; hullSize is the
+// size of the hull it builds or uses. With hardware counters on, a few more
+// calls are counted under stage after the timed runs.
+template <class Body>
+SuiteResult RunSuiteCase(const char *kernel, ProfileStage stage, const char *distribution, int size, int points, int hullSize, Body body)
+{
+    SuiteResult r = { kernel, distribution, size, points, 0, 0.0, 0.0, 0.0, 0, hullSize };
+    uint64_t iterations = 1;
+    for (;;) {
+        AllocationTotals before = allocationTotals();
+        auto start = chrono::steady_clock::now();
+        for (uint64_t k = 0; k < iterations; k++) {
+            suiteSink = body();
+        }
+        double ms = ElapsedMs(start);
+        if (ms >= kSuiteMinMs || iterations >= (1u << 30)) {
+            r.iterations = iterations;
+            r.nsPerCall = ms * 1e6 / iterations;
+            AllocationTotals after = allocationTotals();
+            r.allocsPerCall = static_cast<double>(after.count - before.count) / iterations;
+            r.bytesPerCall = static_cast<double>(after.bytes - before.bytes) / iterations;
+            {
+                AllocationScope query(stage);
+                suiteSink = body();
+                r.peakBytes = query.PeakBytes();
+            }
+#ifdef GEOMETRY_PERF_COUNTERS
+            for (uint64_t k = 0; k < iterations && k < static_cast<uint64_t>(kSuitePerfCalls); k++) {
+                PERF_SCOPE(counters, stage);
+                suiteSink = body();
+            }
+#endif
+            return r;
+        }
+        uint64_t next = ms > 0.01 ? static_cast<uint64_t>(iterations * 1.4 * kSuiteMinMs / ms) : iterations * 100;
+        iterations = next > iterations ? next : iterations * 2;
+    }
+}
+
+// Hardware counters per stage, printed and, given a path, written as JSON
+void ReportPerfCounters(const char *perfPath)
+{
+#ifdef GEOMETRY_PERF_COUNTERS
+    printf("\n");
+    printPerfCounters(stdout);
+    if (perfPath != NULL && !writePerfCounters(perfPath)) {
+        printf("perf     could not write %s\n", perfPath);
+    }
+#else
+    if (perfPath != NULL) {
+        printf("perf     build with -DGEOMETRY_PERF_COUNTERS for hardware counters\n");
+    }
+#endif
+}
+
+// Allocations and peak bytes per stage, when the build accounts for them
+void ReportAllocations(const char *allocsPath)
+{
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+    printf("\n");
+    printAllocations(stdout);
+    if (allocsPath != NULL && !writeAllocations(allocsPath)) {
+        printf("allocs   could not write %s\n", allocsPath);
+    }
+#else
+    if (allocsPath != NULL) {
+        printf("allocs   build with -DGEOMETRY_ALLOC_ACCOUNTING for allocations per stage\n");
+    }
+#endif
+}
+
+template <class Point>
+int SuiteHull(const vector<Point> &points, int first, int count, vector<Point> *hull)
+{
+    vector<int> index;
+    quickHull(&points[first], count, &index);
+    hull->clear();
+    for (size_t i = 0; i < index.size(); i++) {
+        hull->push_back(points[first + index[i]]);
+    }
+    return static_cast<int>(hull->size());
+}
+
+// The kernels behind the window's screens, as they would be called from
+// them: QuickHull of a scene, the Minkowski sum and difference of the hulls of
+// its two halves, point containment and GJK. Each runs on every workload
+// distribution from 10 points up. ns/pt divides by the points a call reads.
+void BenchmarkSuite(int maxPoints, const char *jsonPath, const char *perfPath, const char *allocsPath, const char *executable)
+{
+    vector<SuiteResult> results;
+    vector<HullPointT<float> > points;
+    vector<float> xs(kWorkloadChunk), ys(kWorkloadChunk);
+
+    printf("%-34s %10s %14s %12s %12s %12s %10s\n", "suite", "iterations", "ns/call", "ns/pt", "allocs/call", "peak bytes", "hull");
+    for (int d = 0; d < WorkloadDistributionCount; d++) {
+        const char *name = workloadName(static_cast<WorkloadDistribution>(d));
+        for (int n = 10; n <= maxPoints; n *= 10) {
+            WorkloadGenerator generator(makeWorkload(static_cast<WorkloadDistribution>(d), n));
+            points.clear();
+            for (int m = generator.Next(&xs[0], &ys[0], NULL, kWorkloadChunk); m > 0; m = generator.Next(&xs[0], &ys[0], NULL, kWorkloadChunk)) {
+                for (int i = 0; i < m; i++) {
+                    points.push_back(MakeHullPoint(xs[i], ys[i]));
+                }
+            }
+            int half = n / 2;
+            vector<HullPointT<float> > hull, hullA, hullB;
+            SuiteHull(points, 0, n, &hull);
+            SuiteHull(points, 0, half, &hullA);
+            SuiteHull(points, half, n - half, &hullB);
+            size_t first = results.size();
+
+            vector<HullPointT<float> > sum, difference;
+            minkowskiSum(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()), &sum);
+            minkowskiDifference(&hullA[0], static_cast<int>(hullA.size()), &hullB[0], static_cast<int>(hullB.size()), &difference);
+            int pair = static_cast<int>(hullA.size() + hullB.size());
+
+            results.push_back(RunSuiteCase("quickhull", StageQuickHull, name, n, n, static_cast<int>(hull.size()), [&]() {
+                vector<int> index;
+                quickHull(Opaque(&points[0]), n, &index);
+                return static_cast<int>(index.size());
+            }));
+            results.push_back(RunSuiteCase("minkowski_sum", StageMinkowski, name, n, n, static_cast<int>(sum.size()), [&]() {
+                vector<HullPointT<float> > a, b, out;
+                SuiteHull(points, 0, half, &a);
+                SuiteHull(points, half, n - half, &b);
+                minkowskiSum(Opaque(&a[0]), static_cast<int>(a.size()), &b[0], static_cast<int>(b.size()), &out);
+                return static_cast<int>(out.size());
+            }));
+            results.push_back(RunSuiteCase("minkowski_difference", StageMinkowski, name, n, n, static_cast<int>(difference.size()), [&]() {
+                vector<HullPointT<float> > a, b, out;
+                SuiteHull(points, 0, half, &a);
+                SuiteHull(points, half, n - half, &b);
+                minkowskiDifference(Opaque(&a[0]), static_cast<int>(a.size()), &b[0], static_cast<int>(b.size()), &out);
+                return static_cast<int>(out.size());
+            }));
+
+            // Containment is linear in the hull, so it is timed on a fixed
+            // number of queries rather than on every point of the scene
+            int queries = n < kSuiteQueries ? n : kSuiteQueries;
+            int stride = n / queries;
+            results.push_back(RunSuiteCase("contains", StageContains, name, n, queries, static_cast<int>(hull.size()), [&]() {
+                ALLOC_FORBID(hot);
+                const HullPointT<float> *h = Opaque(&hull[0]);
+                const HullPointT<float> *p = Opaque(&points[0]);
+                int inside = 0;
+                for (int i = 0; i < queries; i++) {
+                    inside += hullContains(h, static_cast<int>(hull.size()), p[i * stride]) ? 1 : 0;
+                }
+                return inside;
+            }));
+            results.push_back(RunSuiteCase("gjk", StageGJK, name, n, pair, pair, [&]() {
+                ALLOC_FORBID(hot);
+                return gjkOverlap(Opaque(&hullA[0]), static_cast<int>(hullA.size()), Opaque(&hullB[0]), static_cast<int>(hullB.size())) ? 1 : 0;
+            }));
+
+            for (size_t i = first; i < results.size(); i++) {
+                const SuiteResult &r = results[i];
+                string label = r.kernel + "/" + r.distribution + "/" + to_string(r.size);
+                printf("%-34s %10llu %14.1f %12.2f %12.1f %12llu %10d\n", label.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerCall,
+                    r.nsPerCall / r.points, r.allocsPerCall, static_cast<unsigned long long>(r.peakBytes), r.hullSize);
+            }
+        }
+    }
+
+    ReportPerfCounters(perfPath);
+    ReportAllocations(allocsPath);
+    if (jsonPath == NULL) {
+        return;
+    }
+    FILE *f = fopen(jsonPath, "w");
+    if (f == NULL) {
+        printf("suite    could not write %s\n", jsonPath);
+        return;
+    }
+
+    // The same shape as Google Benchmark's JSON, with extra fields per case
+    fprintf(f, "{\n  \"context\": {\n    \"executable\": \"%s\",\n    \"max_points\": %d,\n    \"min_time_ms\": %.1f,\n", executable, maxPoints, kSuiteMinMs);
+#ifdef NDEBUG
+    fprintf(f, "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [\n");
+#else
+    fprintf(f, "    \"library_build_type\": \"debug\"\n  },\n  \"benchmarks\": [\n");
+#endif
+    for (size_t i = 0; i < results.size(); i++) {
+        const SuiteResult &r = results[i];
+        fprintf(f, "    {\"name\": \"%s/%s/%d\", \"kernel\": \"%s\", \"distribution\": \"%s\", \"points\": %d, \"iterations\": %llu, "
+            "\"real_time\": %.3f, \"time_unit\": \"ns\", \"ns_per_point\": %.4f, \"allocs_per_call\": %.3f, \"bytes_per_call\": %.1f, \"peak_bytes\": %llu, \"hull_size\": %d}%s\n",
+            r.kernel.c_str(), r.distribution.c_str(), r.size, r.kernel.c_str(), r.distribution.c_str(), r.points, static_cast<unsigned long long>(r.iterations),
+            r.nsPerCall, r.nsPerCall / r.points, r.allocsPerCall, r.bytesPerCall, static_cast<unsigned long long>(r.peakBytes), r.hullSize, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+// A scene laid out as the window's buttons lay it out in a 1280x800 window
+void SyntheticScene(SceneScreen screen, int perGroup, SceneSnapshot *scene)
+{
+    const float width = 1280.0f;
+    const float height = 800.0f;
+    const float right = 250.0f + (width - 300);
+    const float bottom = 50.0f + (height - 150);
+    const float midX = 250.0f + (width - 300) / 2;
+    const float midY = 50.0f + (height - 150) / 2;
+    bool two = screen != SceneQuickHull && screen != ScenePointConvexHull;
+
+    scene->view.screen = screen;
+    scene->view.centerX = 740.0f;
+    scene->view.centerY = 400.0f;
+    scene->view.scale = 1.0f;
+    scene->view.panX = scene->view.panY = 0.0f;
+    scene->view.pivotX = scene->view.centerX;
+    scene->view.pivotY = scene->view.centerY;
+    scene->points.clear();
+    scene->hull1.clear();
+    scene->hull2.clear();
+    scene->derived.clear();
+    scene->cacheValid = false;
+
+    for (int g = 1; g <= (two ? 2 : 1); g++) {
+        WorkloadSpec spec = makeWorkload(UniformSquare, perGroup, kWorkloadSeed * 4 + g);
+        spec.minX = two && g == 2 ? midX : 250.0f;
+        spec.minY = two && g == 2 ? midY : 50.0f;
+        spec.maxX = two && g == 1 ? midX : right;
+        spec.maxY = two && g == 1 ? midY : bottom;
+        WorkloadGenerator generator(spec);
+        for (uint64_t i = 0; i < spec.count; i++) {
+            ScenePoint p = { 0.0f, 0.0f, screen == ScenePointConvexHull ? 0.0f : 10.0f, g == 1 ? 1.0f : 0.0f, 0.0f, g == 2 ? 1.0f : 0.0f, 1.0f, g };
+            uint32_t group;
+            generator.Point(i, &p.x, &p.y, &group);
+            scene->points.push_back(p);
+        }
+    }
+    if (screen == ScenePointConvexHull) {
+        ScenePoint p = { scene->view.centerX, scene->view.centerY, 10.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0 };
+        scene->points.push_back(p);
+    }
+}
+
+// Spacing of synthetic input on the trace's clock, in microseconds
+const int64_t   kSyntheticMoveInterval = 4000;      // A 250 Hz mouse
+const int64_t   kSyntheticKeyInterval = 33000;      // Keyboard auto-repeat
+
+// A drag from (x, y) by (dx, dy) in steps of one mouse move each
+void RecordDrag(InputTraceWriter *writer, float x, float y, float dx, float dy, int steps)
+{
+    writer->Record(TracePick, x, y);
+    for (int k = 1; k <= steps; k++) {
+        writer->Advance(kSyntheticMoveInterval);
+        writer->Record(TraceDrag, x + dx * k / steps, y + dy * k / steps);
+    }
+    writer->Record(TraceRelease, 0.0f, 0.0f);
+}
+
+// Each screen in turn: drag each group across the other, zoom in and out,
+// drag one point and nudge it with the arrow keys, then pan
+bool WriteSyntheticTrace(const char *path, int perGroup)
+{
+    const SceneScreen screens[] = { SceneQuickHull, SceneMinkowskiSum, SceneMinkowskiDifference, SceneGJK, ScenePointConvexHull };
+    InputTraceWriter writer;
+    if (!writer.Open(path)) {
+        return false;
+    }
+    for (int s = 0; s < 5; s++) {
+        SceneSnapshot scene;
+        SyntheticScene(screens[s], perGroup, &scene);
+        writer.RecordScene(scene);
+
+        SceneModel model;
+        model.Load(scene);
+        model.Update();
+        float x1 = 0.0f, y1 = 0.0f, x2 = 0.0f, y2 = 0.0f;
+        const GeometryVector<ScenePoint> &hull1 = model.Hull1();
+        const GeometryVector<ScenePoint> &hull2 = model.Hull2();
+        for (size_t i = 0; i < hull1.size(); i++) {
+            x1 += hull1[i].x / hull1.size();
+            y1 += hull1[i].y / hull1.size();
+        }
+        for (size_t i = 0; i < hull2.size(); i++) {
+            x2 += hull2[i].x / hull2.size();
+            y2 += hull2[i].y / hull2.size();
+        }
+        if (hull2.empty()) {
+            RecordDrag(&writer, x1, y1, 200.0f, 100.0f, 100);
+        }
+        else {
+            RecordDrag(&writer, x1, y1, x2 - x1, y2 - y1, 100);
+            RecordDrag(&writer, x2, y2, x1 - x2, y1 - y2, 100);
+        }
+        writer.Record(TraceWheel, 0.0f, 0.0f, kSceneWheelDelta);
+        writer.Record(TraceWheel, 0.0f, 0.0f, -kSceneWheelDelta);
+
+        const ScenePoint &p = scene.points.back();
+        RecordDrag(&writer, p.x, p.y, 40.0f, 40.0f, 20);
+        for (int k = 0; k < 5; k++) {
+            writer.Advance(kSyntheticKeyInterval);
+            writer.Record(TraceKey, 0.0f, 0.0f, 0, kSceneKeyLeft);
+        }
+        RecordDrag(&writer, 230.0f, 10.0f, 100.0f, 50.0f, 20);
+    }
+    bool ok = writer.Recording();
+    writer.Close();
+    return ok;
+}
+
+void ReplayTrace(const char *path, const char *chromePath, const char *perfPath, const char *allocsPath, int64_t interval)
+{
+    InputTrace trace;
+    if (!readInputTrace(path, &trace)) {
+        printf("replay   could not read %s\n", path);
+        return;
+    }
+    SceneModel model;
+    TraceLatency latency;
+    replayInputTrace(trace, &model, &latency);
+
+    printf("%-8s %-10s %10s %12s %12s %12s %12s\n", "replay", "event", "count", "p50 us", "p99 us", "max us", "peak bytes");
+    vector<double> all;
+    for (int k = 0; k < TraceEventKindCount; k++) {
+        const vector<double> &samples = latency.samples[k];
+        all.insert(all.end(), samples.begin(), samples.end());
+        if (!samples.empty()) {
+            printf("%-8s %-10s %10d %12.2f %12.2f %12.2f %12llu\n", "replay", traceEventName(k), static_cast<int>(samples.size()),
+                latency.Percentile(k, 0.5), latency.Percentile(k, 0.99), latency.Percentile(k, 1.0),
+                static_cast<unsigned long long>(latency.peakBytes[k]));
+        }
+    }
+
+    // Input events only; scene loads are not interactive
+    TraceLatency input;
+    for (int k = TracePick; k < TraceEventKindCount; k++) {
+        input.samples[0].insert(input.samples[0].end(), latency.samples[k].begin(), latency.samples[k].end());
+    }
+    printf("%-8s %-10s %10d %12.2f %12.2f %12.2f\n", "replay", "input", static_cast<int>(input.samples[0].size()),
+        input.Percentile(0, 0.5), input.Percentile(0, 0.99), input.Percentile(0, 1.0));
+
+    // Again with recomputes paced by the scheduler: how many edits shared a
+    // recompute, how long edits waited for one on the trace's clock, and
+    // what each recompute cost
+    SceneModel scheduled;
+    RecomputeScheduler scheduler(interval);
+    ScheduleReplay schedule;
+    replayScheduled(trace, &scheduled, &scheduler, &schedule);
+    printf("\n%-8s %lld us interval: %llu events, %llu edits, %llu recomputes, %llu edits coalesced\n", "schedule",
+        static_cast<long long>(interval), static_cast<unsigned long long>(schedule.events), static_cast<unsigned long long>(schedule.edits),
+        static_cast<unsigned long long>(schedule.recomputes), static_cast<unsigned long long>(schedule.coalesced));
+    printf("%-8s %-10s %10s %12s %12s %12s\n", "schedule", "", "count", "p50 us", "p99 us", "max us");
+    printf("%-8s %-10s %10d %12.2f %12.2f %12.2f\n", "schedule", "wait", static_cast<int>(schedule.waits.size()),
+        tracePercentile(schedule.waits, 0.5), tracePercentile(schedule.waits, 0.99), tracePercentile(schedule.waits, 1.0));
+    printf("%-8s %-10s %10d %12.2f %12.2f %12.2f\n", "schedule", "recompute", static_cast<int>(schedule.compute.size()),
+        tracePercentile(schedule.compute, 0.5), tracePercentile(schedule.compute, 0.99), tracePercentile(schedule.compute, 1.0));
+
+#ifdef GEOMETRY_PROFILE
+    printf("\n");
+    printProfile(stdout);
+    if (chromePath != NULL && !writeChromeTrace(chromePath)) {
+        printf("replay   could not write %s\n", chromePath);
+    }
+#else
+    if (chromePath != NULL) {
+        printf("replay   build with -DGEOMETRY_PROFILE for a Chrome trace\n");
+    }
+#endif
+    ReportPerfCounters(perfPath);
+    ReportAllocations(allocsPath);
+}
+
+int main(int argc, char **argv)
+{
+    int maxPoints = 1000000;
+    bool suite = false;
+    const char *jsonPath = NULL;
+    const char *tracePath = NULL;
+    const char *replayPath = NULL;
+    const char *chromePath = NULL;
+    const char *perfPath = NULL;
+    const char *allocsPath = NULL;
+    int64_t interval = kRecomputeInterval;
+    bool check = false;
+    bool sized = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--suite") == 0) {
+            suite = true;
+        }
+        else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            suite = true;
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--chrome") == 0 && i + 1 < argc) {
+            chromePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--perf") == 0 && i + 1 < argc) {
+            perfPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--allocs") == 0 && i + 1 < argc) {
+            allocsPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atoll(argv[++i]);
+        }
+        else {
+            maxPoints = atoi(argv[i]);
+            sized = true;
+        }
+    }
+
+    if (tracePath != NULL) {
+        bool written = WriteSyntheticTrace(tracePath, sized ? maxPoints : 100);
+        printf("trace    %s %s\n", written ? "wrote" : "could not write", tracePath);
+        return written ? 0 : 1;
+    }
+    if (replayPath != NULL) {
+        ReplayTrace(replayPath, chromePath, perfPath, allocsPath, interval);
+        return 0;
+    }
+    if (check) {
+        int pairs = sized ? maxPoints : 20000;
+        printf("%-8s %-8s %10s %10s %10s\n", "check", "mode", "pairs", "overlap", "disagree");
+        int disagreements = CheckGJK2D<float>("float", pairs) + CheckGJK2D<double>("double", pairs) + CheckGJK2D<int32_t>("fixed", pairs);
+        return disagreements == 0 ? 0 : 1;
+    }
+    if (suite) {
+        BenchmarkSuite(maxPoints, jsonPath, perfPath, allocsPath, argv[0]);
+        return 0;
+    }
+    BenchmarkHull2D<float>("float", maxPoints);
+    BenchmarkHull2D<double>("double", maxPoints);
+    BenchmarkHull2D<int32_t>("fixed", maxPoints);
+    BenchmarkTimeOfImpact(maxPoints);
+    BenchmarkNarrowPhase3D(maxPoints);
+    BenchmarkRayCast(maxPoints);
+    BenchmarkShardedHull(maxPoints);
+    BenchmarkPointCloud(maxPoints);
+    BenchmarkWorkloads(maxPoints);
+    BenchmarkQuickHull3D(maxPoints);
+    return 0;
+}
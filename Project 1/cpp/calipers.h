@@ -0,0 +1,254 @@
+#ifndef _CALIPERS_H
+#define _CALIPERS_H
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "hull2d.h"
+
+// Rotating calipers on a counter-clockwise convex hull (strictly convex, as
+// quickHull and convexHull produce). Every query is one O(n) sweep of the
+// edges with pointers that only move forward.
+//
+// Vertex-to-edge decisions use the exact Wide predicates; distances, areas
+// and rectangle extents are computed in double and returned as Real.
+
+// Oriented rectangle: axis is the unit direction of the first side, the
+// second side runs along its counter-clockwise perpendicular
+template <class Real>
+struct OrientedRect
+{
+    HullPointT<Real>    center;
+    HullPointT<Real>    axis;
+    Real                halfWidth;
+    Real                halfHeight;
+
+    Real Area() const { return 4 * halfWidth * halfHeight; }
+    Real Perimeter() const { return 4 * (halfWidth + halfHeight); }
+
+    // Corners in counter-clockwise order
+    void Corners(HullPointT<Real> *corners) const
+    {
+        Real ux = axis.x * halfWidth, uy = axis.y * halfWidth;
+        Real vx = -axis.y * halfHeight, vy = axis.x * halfHeight;
+        corners[0] = MakeHullPoint<Real>(center.x - ux - vx, center.y - uy - vy);
+        corners[1] = MakeHullPoint<Real>(center.x + ux - vx, center.y + uy - vy);
+        corners[2] = MakeHullPoint<Real>(center.x + ux + vx, center.y + uy + vy);
+        corners[3] = MakeHullPoint<Real>(center.x - ux + vx, center.y - uy + vy);
+    }
+};
+
+// Twice the area of the triangle between edge i and vertex j
+template <class Point, class Accessor>
+inline typename ScalarTraits<typename Accessor::Coord>::Wide calipersHeight(const Point *p, int n, int i, int j, Accessor get)
+{
+    return orient(p[i], p[(i + 1) % n], p[j], get);
+}
+
+// For each edge i (vertex i to i + 1), the first and last vertex furthest
+// from it. They differ only when the far side has an edge parallel to i.
+template <class Point, class Accessor, class Alloc>
+inline void calipersFarthest(const Point *p, int n, std::vector<int, Alloc> *first, std::vector<int, Alloc> *last, Accessor get)
+{
+    first->resize(n);
+    last->resize(n);
+    int j = 1 % n;
+    for (int i = 0; i < n; i++) {
+        for (int steps = 0; steps < n && calipersHeight(p, n, i, (j + 1) % n, get) > calipersHeight(p, n, i, j, get); steps++) {
+            j = (j + 1) % n;
+        }
+        (*first)[i] = j;
+        (*last)[i] = calipersHeight(p, n, i, (j + 1) % n, get) == calipersHeight(p, n, i, j, get) ? (j + 1) % n : j;
+    }
+}
+
+// All antipodal vertex pairs, each once with the lower index first. Vertex
+// i + 1 is antipodal to every vertex from the furthest of edge i to the
+// furthest of edge i + 1; each pair shows up in both vertices' ranges and is
+// kept from the lower one. The ranges cover about 2n entries in total.
+template <class Point, class Accessor, class Alloc>
+inline void antipodalPairs(const Point *p, int n, std::vector<std::pair<int, int>, Alloc> *pairs, Accessor get)
+{
+    pairs->clear();
+    if (n < 2) {
+        return;
+    }
+    if (n == 2) {
+        pairs->push_back(std::make_pair(0, 1));
+        return;
+    }
+
+    GeometryVector<int> first, last;
+    calipersFarthest(p, n, &first, &last, get);
+    for (int i = 0; i < n; i++) {
+        int v = (i + 1) % n;
+        int j = first[i];
+        int end = last[v];
+        for (int steps = 0; steps <= n; steps++) {
+            if (v < j) {
+                pairs->push_back(std::make_pair(v, j));
+            }
+            if (j == end) {
+                break;
+            }
+            j = (j + 1) % n;
+        }
+    }
+}
+
+template <class Point, class Accessor>
+inline typename ScalarTraits<typename Accessor::Coord>::Wide calipersDistSq(const Point &a, const Point &b, Accessor)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    Wide dx = static_cast<Wide>(Accessor::X(a)) - Accessor::X(b);
+    Wide dy = static_cast<Wide>(Accessor::Y(a)) - Accessor::Y(b);
+    return dx * dx + dy * dy;
+}
+
+// Largest distance between two hull vertices; the pair goes to a and b
+template <class Point, class Accessor>
+inline typename ScalarTraits<typename Accessor::Coord>::Real hullDiameter(const Point *p, int n, int *a, int *b, Accessor get)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    typedef typename ScalarTraits<typename Accessor::Coord>::Real Real;
+
+    *a = *b = 0;
+    if (n < 2) {
+        return 0;
+    }
+
+    GeometryVector<int> first, last;
+    calipersFarthest(p, n, &first, &last, get);
+    Wide best = 0;
+    for (int i = 0; i < n; i++) {
+        int ends[2] = { i, (i + 1) % n };
+        int far[2] = { first[i], last[i] };
+        for (int e = 0; e < 2; e++) {
+            for (int f = 0; f < 2; f++) {
+                Wide d = calipersDistSq(p[ends[e]], p[far[f]], get);
+                if (d > best) {
+                    best = d;
+                    *a = ends[e];
+                    *b = far[f];
+                }
+            }
+        }
+    }
+    return static_cast<Real>(sqrt(static_cast<double>(best)));
+}
+
+// Minimum width: the smallest distance between an edge's supporting line and
+// the vertex furthest from it
+template <class Point, class Accessor>
+inline typename ScalarTraits<typename Accessor::Coord>::Real hullWidth(const Point *p, int n, int *edge, int *vertex, Accessor get)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Real Real;
+
+    *edge = *vertex = 0;
+    if (n < 3) {
+        return 0;
+    }
+
+    GeometryVector<int> first, last;
+    calipersFarthest(p, n, &first, &last, get);
+    double best = -1.0;
+    for (int i = 0; i < n; i++) {
+        double height = static_cast<double>(calipersHeight(p, n, i, first[i], get));
+        double len = sqrt(static_cast<double>(calipersDistSq(p[i], p[(i + 1) % n], get)));
+        double width = height / len;
+        if (best < 0.0 || width < best) {
+            best = width;
+            *edge = i;
+            *vertex = first[i];
+        }
+    }
+    return static_cast<Real>(best);
+}
+
+// Smallest enclosing rectangle by area or by perimeter. One side of the
+// optimum is flush with a hull edge, so each edge is tried with calipers on
+// the extreme vertices along, above and against it.
+template <class Point, class Accessor>
+inline bool calipersRect(const Point *p, int n, bool perimeter, OrientedRect<typename ScalarTraits<typename Accessor::Coord>::Real> *rect, Accessor get)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    typedef typename ScalarTraits<typename Accessor::Coord>::Real Real;
+
+    if (n < 3) {
+        return false;
+    }
+
+    GeometryVector<int> first, last;
+    calipersFarthest(p, n, &first, &last, get);
+
+    double best = -1.0;
+    int right = 1;
+    int left = first[0];
+    for (int i = 0; i < n; i++) {
+        int i1 = (i + 1) % n;
+        Wide ex = static_cast<Wide>(Accessor::X(p[i1])) - Accessor::X(p[i]);
+        Wide ey = static_cast<Wide>(Accessor::Y(p[i1])) - Accessor::Y(p[i]);
+
+        // Furthest along the edge, then furthest against it
+        if (i == 0) {
+            right = i1;
+        }
+        for (int steps = 0; steps < n; steps++) {
+            int r1 = (right + 1) % n;
+            Wide step = (static_cast<Wide>(Accessor::X(p[r1])) - Accessor::X(p[right])) * ex +
+                (static_cast<Wide>(Accessor::Y(p[r1])) - Accessor::Y(p[right])) * ey;
+            if (step <= 0) {
+                break;
+            }
+            right = r1;
+        }
+        if (i == 0) {
+            left = first[0];
+        }
+        for (int steps = 0; steps < n; steps++) {
+            int l1 = (left + 1) % n;
+            Wide step = (static_cast<Wide>(Accessor::X(p[l1])) - Accessor::X(p[left])) * ex +
+                (static_cast<Wide>(Accessor::Y(p[l1])) - Accessor::Y(p[left])) * ey;
+            if (step >= 0) {
+                break;
+            }
+            left = l1;
+        }
+
+        double len = sqrt(static_cast<double>(ex * ex + ey * ey));
+        double ux = static_cast<double>(ex) / len;
+        double uy = static_cast<double>(ey) / len;
+        double ox = Accessor::X(p[i]);
+        double oy = Accessor::Y(p[i]);
+        double maxU = (Accessor::X(p[right]) - ox) * ux + (Accessor::Y(p[right]) - oy) * uy;
+        double minU = (Accessor::X(p[left]) - ox) * ux + (Accessor::Y(p[left]) - oy) * uy;
+        double height = static_cast<double>(calipersHeight(p, n, i, first[i], get)) / len;
+        double width = maxU - minU;
+        double cost = perimeter ? width + height : width * height;
+        if (best < 0.0 || cost < best) {
+            best = cost;
+            double mid = 0.5 * (maxU + minU);
+            rect->center = MakeHullPoint<Real>(static_cast<Real>(ox + ux * mid - uy * height * 0.5),
+                static_cast<Real>(oy + uy * mid + ux * height * 0.5));
+            rect->axis = MakeHullPoint<Real>(static_cast<Real>(ux), static_cast<Real>(uy));
+            rect->halfWidth = static_cast<Real>(width * 0.5);
+            rect->halfHeight = static_cast<Real>(height * 0.5);
+        }
+    }
+    return true;
+}
+
+template <class Point, class Accessor>
+inline bool minAreaRect(const Point *p, int n, OrientedRect<typename ScalarTraits<typename Accessor::Coord>::Real> *rect, Accessor get)
+{
+    return calipersRect(p, n, false, rect, get);
+}
+
+template <class Point, class Accessor>
+inline bool minPerimeterRect(const Point *p, int n, OrientedRect<typename ScalarTraits<typename Accessor::Coord>::Real> *rect, Accessor get)
+{
+    return calipersRect(p, n, true, rect, get);
+}
+
+#endif
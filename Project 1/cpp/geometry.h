@@ -0,0 +1,59 @@
+#ifndef _GEOMETRY_H
+#define _GEOMETRY_H
+
+#include <cmath>
+
+// Plain 2D vector used by the portable (non Direct2D) geometry code.
+// Layout matches D2D1_POINT_2F so hull points can be copied straight across.
+struct Vec2
+{
+    float x;
+    float y;
+};
+
+inline Vec2 MakeVec2(float x, float y)
+{
+    Vec2 v = { x, y };
+    return v;
+}
+
+inline Vec2 operator+(Vec2 a, Vec2 b) { return MakeVec2(a.x + b.x, a.y + b.y); }
+inline Vec2 operator-(Vec2 a, Vec2 b) { return MakeVec2(a.x - b.x, a.y - b.y); }
+inline Vec2 operator-(Vec2 a)         { return MakeVec2(-a.x, -a.y); }
+inline Vec2 operator*(Vec2 a, float s) { return MakeVec2(a.x * s, a.y * s); }
+inline Vec2 operator*(float s, Vec2 a) { return MakeVec2(a.x * s, a.y * s); }
+
+inline float dot(Vec2 a, Vec2 b)   { return a.x * b.x + a.y * b.y; }
+inline float cross(Vec2 a, Vec2 b) { return a.x * b.y - a.y * b.x; }
+inline float lengthSq(Vec2 a)      { return dot(a, a); }
+inline float length(Vec2 a)        { return sqrtf(dot(a, a)); }
+
+// Counter-clockwise perpendicular
+inline Vec2 perp(Vec2 a) { return MakeVec2(-a.y, a.x); }
+
+// 3D vector for collision meshes
+struct Vec3
+{
+    float x;
+    float y;
+    float z;
+};
+
+inline Vec3 MakeVec3(float x, float y, float z)
+{
+    Vec3 v = { x, y, z };
+    return v;
+}
+
+inline Vec3 operator+(Vec3 a, Vec3 b) { return MakeVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3 operator-(Vec3 a, Vec3 b) { return MakeVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3 operator-(Vec3 a)         { return MakeVec3(-a.x, -a.y, -a.z); }
+inline Vec3 operator*(Vec3 a, float s) { return MakeVec3(a.x * s, a.y * s, a.z * s); }
+inline Vec3 operator*(float s, Vec3 a) { return MakeVec3(a.x * s, a.y * s, a.z * s); }
+
+inline float dot(Vec3 a, Vec3 b)   { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3  cross(Vec3 a, Vec3 b) { return MakeVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline float lengthSq(Vec3 a)      { return dot(a, a); }
+inline float length(Vec3 a)        { return sqrtf(dot(a, a)); }
+
+#endif
@@ -0,0 +1,697 @@
+#ifndef _HULL2D_H
+#define _HULL2D_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+#include "allocaccount.h"
+
+// Portable 2D hull, Minkowski, containment and GJK kernels.
+//
+// Every kernel is a template over the caller's point type and an accessor
+// policy that reads coordinates out of it, so the same source serves float
+// points for interactive work, double points for offline baking, int32
+// fixed-point points for lockstep simulation, and the app's own ellipse
+// objects without copying them. ScalarTraits picks the intermediate types
+// for each scalar. Output vectors may use any allocator; scratch space is
+// taken through GeometryAllocator, so allocaccount.h counts it.
+//
+// Define GEOMETRY_FIXED_POINT to make HullCoord, the app's default scalar,
+// int32 with kFixedShift fractional bits. The integer path is exact, so
+// results are bit-identical across compilers, FMA contraction and
+// optimisation settings. Fixed-point inputs must stay within
+// +/-kFixedCoordLimit: Minkowski results then fit in int32 and every cross or
+// dot product of coordinate differences fits in int64.
+
+// Wide holds products of coordinate differences for the exact predicates.
+// Batch is the lane type of the bulk SIMD-friendly loops: float stays float
+// so a vector register holds twice as many lanes. Real holds constructed
+// values such as intersection points and areas, which are not on the integer
+// grid in the fixed-point build.
+template <class Scalar> struct ScalarTraits;
+
+template <> struct ScalarTraits<float>
+{
+    typedef double  Wide;
+    typedef float   Batch;
+    typedef float   Real;
+};
+
+template <> struct ScalarTraits<double>
+{
+    typedef double  Wide;
+    typedef double  Batch;
+    typedef double  Real;
+};
+
+template <> struct ScalarTraits<int32_t>
+{
+    typedef int64_t Wide;
+    typedef int64_t Batch;
+    typedef double  Real;
+};
+
+template <class Scalar>
+struct HullPointT
+{
+    Scalar x;
+    Scalar y;
+};
+
+// Default accessor, for any point type with x and y members
+template <class Point, class Scalar>
+struct MemberAccessor
+{
+    typedef Scalar Coord;
+
+    static Scalar X(const Point &p) { return p.x; }
+    static Scalar Y(const Point &p) { return p.y; }
+};
+
+template <class Scalar>
+struct HullPointAccessor : public MemberAccessor<HullPointT<Scalar>, Scalar> {};
+
+#ifdef GEOMETRY_FIXED_POINT
+
+typedef int32_t HullCoord;
+
+const int       kFixedShift = 8;
+const float     kFixedOne = static_cast<float>(1 << kFixedShift);
+const HullCoord kFixedCoordLimit = 1 << 29;
+
+// Scaling by a power of two is exact, so the rounding here does not depend
+// on FMA or x87 settings. Out-of-range input (NaN included) asserts in debug
+// builds and is clamped to +/-kFixedCoordLimit otherwise, which keeps the
+// cast defined and the int32/int64 bounds above intact.
+inline HullCoord toHullCoord(float v)
+{
+    double scaled = floor(static_cast<double>(v) * kFixedOne + 0.5);
+    assert(scaled >= -kFixedCoordLimit && scaled <= kFixedCoordLimit && "coordinate outside +/-kFixedCoordLimit");
+    if (!(scaled >= -kFixedCoordLimit)) {
+        return -kFixedCoordLimit;
+    }
+    if (scaled > kFixedCoordLimit) {
+        return kFixedCoordLimit;
+    }
+    return static_cast<HullCoord>(scaled);
+}
+
+inline float fromHullCoord(HullCoord v)
+{
+    return static_cast<float>(v) / kFixedOne;
+}
+
+inline float fromHullReal(double v)
+{
+    return static_cast<float>(v / kFixedOne);
+}
+
+#else
+
+typedef float   HullCoord;
+
+inline HullCoord toHullCoord(float v) { return v; }
+inline float fromHullCoord(HullCoord v) { return v; }
+inline float fromHullReal(float v) { return v; }
+
+#endif
+
+typedef HullPointT<HullCoord> HullPoint;
+typedef ScalarTraits<HullCoord>::Real HullReal;
+
+const int kHullGJKMaxIterations = 64;
+
+template <class Scalar>
+inline HullPointT<Scalar> MakeHullPoint(Scalar x, Scalar y)
+{
+    HullPointT<Scalar> p = { x, y };
+    return p;
+}
+
+// Twice the signed area of triangle oab, positive when b is left of oa
+template <class Wide, class Scalar>
+inline Wide orientWide(Scalar ox, Scalar oy, Scalar ax, Scalar ay, Scalar bx, Scalar by)
+{
+    return (static_cast<Wide>(ax) - ox) * (static_cast<Wide>(by) - oy) -
+        (static_cast<Wide>(ay) - oy) * (static_cast<Wide>(bx) - ox);
+}
+
+template <class Scalar>
+inline typename ScalarTraits<Scalar>::Wide orient(HullPointT<Scalar> o, HullPointT<Scalar> a, HullPointT<Scalar> b)
+{
+    return orientWide<typename ScalarTraits<Scalar>::Wide>(o.x, o.y, a.x, a.y, b.x, b.y);
+}
+
+template <class Point, class Accessor>
+inline typename ScalarTraits<typename Accessor::Coord>::Wide orient(const Point &o, const Point &a, const Point &b, Accessor)
+{
+    return orientWide<typename ScalarTraits<typename Accessor::Coord>::Wide>(
+        Accessor::X(o), Accessor::Y(o), Accessor::X(a), Accessor::Y(a), Accessor::X(b), Accessor::Y(b));
+}
+
+// Sort key for the monotone chain. Equal points fall back to their index so
+// the output never depends on the standard library's sort.
+template <class Point, class Accessor>
+struct HullIndexLess
+{
+    const Point *points;
+
+    bool operator()(int i, int j) const
+    {
+        if (Accessor::X(points[i]) != Accessor::X(points[j])) return Accessor::X(points[i]) < Accessor::X(points[j]);
+        if (Accessor::Y(points[i]) != Accessor::Y(points[j])) return Accessor::Y(points[i]) < Accessor::Y(points[j]);
+        return i < j;
+    }
+};
+
+// Partition predicate: point strictly right of a->b
+template <class Point, class Accessor>
+struct QuickHullRightOf
+{
+    const Point *points;
+    int a;
+    int b;
+
+    QuickHullRightOf(const Point *points, int a, int b) : points(points), a(a), b(b) {}
+
+    bool operator()(int i) const { return orient(points[a], points[b], points[i], Accessor()) < 0; }
+};
+
+// Andrew's monotone chain over indices already in HullIndexLess order.
+// Writes the indices of the hull vertices in counter-clockwise (positive
+// area) order, dropping collinear and duplicate points. Fewer than three
+// distinct points give a degenerate hull.
+template <class Point, class Accessor, class Alloc>
+inline void convexHullSorted(const Point *points, const int *order, int n, std::vector<int, Alloc> *hull, Accessor get)
+{
+    hull->clear();
+    if (n <= 0) {
+        return;
+    }
+
+    std::vector<int, Alloc> &h = *hull;
+    h.resize(2 * n);
+    int k = 0;
+
+    // Lower chain
+    for (int i = 0; i < n; i++) {
+        while (k >= 2 && orient(points[h[k - 2]], points[h[k - 1]], points[order[i]], get) <= 0) {
+            k--;
+        }
+        h[k++] = order[i];
+    }
+
+    // Upper chain
+    int lower = k + 1;
+    for (int i = n - 2; i >= 0; i--) {
+        while (k >= lower && orient(points[h[k - 2]], points[h[k - 1]], points[order[i]], get) <= 0) {
+            k--;
+        }
+        h[k++] = order[i];
+    }
+
+    // The last point repeats the first
+    h.resize(k > 1 ? k - 1 : k);
+    if (h.size() == 2 && Accessor::X(points[h[0]]) == Accessor::X(points[h[1]]) && Accessor::Y(points[h[0]]) == Accessor::Y(points[h[1]])) {
+        h.resize(1);
+    }
+}
+
+// Convex hull by Andrew's monotone chain, see convexHullSorted
+template <class Point, class Accessor, class Alloc>
+inline void convexHull(const Point *points, int n, std::vector<int, Alloc> *hull, Accessor get)
+{
+    hull->clear();
+    if (n <= 0) {
+        return;
+    }
+
+    GeometryVector<int> order(n);
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    HullIndexLess<Point, Accessor> less = { points };
+    std::sort(order.begin(), order.end(), less);
+    convexHullSorted(points, &order[0], n, hull, get);
+}
+
+template <class Scalar, class Alloc>
+inline void convexHull(const HullPointT<Scalar> *points, int n, std::vector<int, Alloc> *hull)
+{
+    convexHull(points, n, hull, HullPointAccessor<Scalar>());
+}
+
+// Hull of k counter-clockwise hulls stored back to back, hull i being the
+// count[i] points from first[i]. Writes indices into points like convexHull.
+// Each hull splits at its lexicographic extremes into a lower and an upper
+// run that are already in sorted order. The runs merge pairwise in a
+// balanced tree and one monotone-chain pass finishes, with no comparison
+// sort: O(H log k) for H vertices in all, and linear for two hulls.
+template <class Point, class Accessor, class Alloc>
+inline void mergeHulls(const Point *points, const int *first, const int *count, int k, std::vector<int, Alloc> *hull, Accessor get)
+{
+    HullIndexLess<Point, Accessor> less = { points };
+    GeometryVector<int> order;
+    GeometryVector<size_t> runs;
+    for (int i = 0; i < k; i++) {
+        int n = count[i];
+        if (n <= 0) {
+            continue;
+        }
+        int f = first[i];
+        int lo = f;
+        int hi = f;
+        for (int j = f + 1; j < f + n; j++) {
+            lo = less(j, lo) ? j : lo;
+            hi = less(hi, j) ? j : hi;
+        }
+
+        // Counter-clockwise from lo to hi is the lower run; clockwise from lo
+        // to hi, without either end, is the upper run in the same order
+        runs.push_back(order.size());
+        for (int j = lo;; j = j + 1 < f + n ? j + 1 : f) {
+            order.push_back(j);
+            if (j == hi) {
+                break;
+            }
+        }
+        runs.push_back(order.size());
+        for (int j = lo > f ? lo - 1 : f + n - 1; j != hi && j != lo; j = j > f ? j - 1 : f + n - 1) {
+            order.push_back(j);
+        }
+    }
+    runs.push_back(order.size());
+
+    GeometryVector<int> merged(order.size());
+    while (runs.size() > 2) {
+        GeometryVector<size_t> next;
+        for (size_t r = 0; r + 1 < runs.size(); r += 2) {
+            next.push_back(runs[r]);
+            size_t mid = runs[r + 1];
+            size_t end = r + 2 < runs.size() ? runs[r + 2] : mid;
+            std::merge(order.begin() + runs[r], order.begin() + mid, order.begin() + mid, order.begin() + end, merged.begin() + runs[r], less);
+        }
+        next.push_back(order.size());
+        order.swap(merged);
+        runs.swap(next);
+    }
+    convexHullSorted(points, order.empty() ? NULL : &order[0], static_cast<int>(order.size()), hull, get);
+}
+
+template <class Scalar, class Alloc>
+inline void mergeHulls(const HullPointT<Scalar> *points, const int *first, const int *count, int k, std::vector<int, Alloc> *hull)
+{
+    mergeHulls(points, first, count, k, hull, HullPointAccessor<Scalar>());
+}
+
+// One side of QuickHull: work[begin, end) holds the points strictly right of
+// a->b. Appends the hull vertices between a and b, in order, to hull. Points
+// tied on distance lie on a line parallel to a->b; the one furthest towards b
+// is a true vertex, and any remaining tie goes to the lowest index so the
+// result does not depend on the order std::partition leaves behind.
+template <class Point, class Accessor, class Alloc>
+inline void quickHullSide(const Point *points, int a, int b, int *begin, int *end, std::vector<int, Alloc> *hull, Accessor get)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    if (begin == end) {
+        return;
+    }
+
+    Wide abx = static_cast<Wide>(Accessor::X(points[b])) - Accessor::X(points[a]);
+    Wide aby = static_cast<Wide>(Accessor::Y(points[b])) - Accessor::Y(points[a]);
+    int c = -1;
+    Wide best = 0;
+    Wide bestAlong = 0;
+    for (int *i = begin; i != end; ++i) {
+        Wide dist = -orient(points[a], points[b], points[*i], get);
+        Wide along = abx * Accessor::X(points[*i]) + aby * Accessor::Y(points[*i]);
+        if (c == -1 || dist > best || (dist == best && (along > bestAlong || (along == bestAlong && *i < c)))) {
+            c = *i;
+            best = dist;
+            bestAlong = along;
+        }
+    }
+
+    // Points right of a->c, then points right of c->b; the rest are inside
+    int *mid = std::partition(begin, end, QuickHullRightOf<Point, Accessor>(points, a, c));
+    int *last = std::partition(mid, end, QuickHullRightOf<Point, Accessor>(points, c, b));
+    quickHullSide(points, a, c, begin, mid, hull, get);
+    hull->push_back(c);
+    quickHullSide(points, c, b, mid, last, hull, get);
+}
+
+// QuickHull over the first n points. Each side is filled in as the recursion
+// unwinds, so the indices come out in counter-clockwise (positive area) order
+// with no angular sort and no shared state. Collinear points are dropped.
+template <class Point, class Accessor, class Alloc>
+inline void quickHull(const Point *points, int n, std::vector<int, Alloc> *hull, Accessor get)
+{
+    hull->clear();
+    if (n <= 0) {
+        return;
+    }
+
+    // Extreme points in x, ties broken on y so they are true hull vertices
+    int left = 0;
+    int right = 0;
+    for (int i = 1; i < n; i++) {
+        HullIndexLess<Point, Accessor> less = { points };
+        if (less(i, left)) {
+            left = i;
+        }
+        if (less(right, i)) {
+            right = i;
+        }
+    }
+    hull->push_back(left);
+    if (Accessor::X(points[left]) == Accessor::X(points[right]) && Accessor::Y(points[left]) == Accessor::Y(points[right])) {
+        return;
+    }
+
+    GeometryVector<int> work(n);
+    for (int i = 0; i < n; i++) {
+        work[i] = i;
+    }
+    int *first = &work[0];
+    int *below = std::partition(first, first + n, QuickHullRightOf<Point, Accessor>(points, left, right));
+    int *above = std::partition(below, first + n, QuickHullRightOf<Point, Accessor>(points, right, left));
+    quickHullSide(points, left, right, first, below, hull, get);
+    hull->push_back(right);
+    quickHullSide(points, right, left, below, above, hull, get);
+}
+
+template <class Scalar, class Alloc>
+inline void quickHull(const HullPointT<Scalar> *points, int n, std::vector<int, Alloc> *hull)
+{
+    quickHull(points, n, hull, HullPointAccessor<Scalar>());
+}
+
+// Index of the bottom-most (then left-most) vertex, where the edge merge starts
+template <class Point, class Accessor>
+inline int hullBottomVertex(const Point *p, int n, Accessor)
+{
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        if (Accessor::Y(p[i]) < Accessor::Y(p[best]) ||
+            (Accessor::Y(p[i]) == Accessor::Y(p[best]) && Accessor::X(p[i]) < Accessor::X(p[best]))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Minkowski sum (sign = 1) or difference b - a (sign = -1) of two
+// counter-clockwise convex polygons in O(n + m), merging their edges in
+// angular order. Negating a convex polygon keeps its winding, so the
+// difference is the sum with a reflected through the origin; the bottom
+// vertex of -a is the top vertex of a.
+template <class Point, class Accessor, class Alloc>
+inline void minkowskiMerge(const Point *a, int na, const Point *b, int nb, int sign, std::vector<HullPointT<typename Accessor::Coord>, Alloc> *out, Accessor get)
+{
+    typedef typename Accessor::Coord Scalar;
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+
+    out->clear();
+    if (na <= 0 || nb <= 0) {
+        return;
+    }
+
+    int ia = 0;
+    if (sign > 0) {
+        ia = hullBottomVertex(a, na, get);
+    }
+    else {
+        for (int i = 1; i < na; i++) {
+            if (Accessor::Y(a[i]) > Accessor::Y(a[ia]) ||
+                (Accessor::Y(a[i]) == Accessor::Y(a[ia]) && Accessor::X(a[i]) > Accessor::X(a[ia]))) {
+                ia = i;
+            }
+        }
+    }
+    int ib = hullBottomVertex(b, nb, get);
+    int ca = 0;
+    int cb = 0;
+    while (ca < na || cb < nb) {
+        const Point &pa = a[(ia + ca) % na];
+        const Point &pb = b[(ib + cb) % nb];
+        Scalar ax = sign > 0 ? Accessor::X(pa) : -Accessor::X(pa);
+        Scalar ay = sign > 0 ? Accessor::Y(pa) : -Accessor::Y(pa);
+        out->push_back(MakeHullPoint<Scalar>(ax + Accessor::X(pb), ay + Accessor::Y(pb)));
+
+        const Point &na1 = a[(ia + ca + 1) % na];
+        const Point &nb1 = b[(ib + cb + 1) % nb];
+        Wide eax = (static_cast<Wide>(Accessor::X(na1)) - Accessor::X(pa)) * sign;
+        Wide eay = (static_cast<Wide>(Accessor::Y(na1)) - Accessor::Y(pa)) * sign;
+        Wide ebx = static_cast<Wide>(Accessor::X(nb1)) - Accessor::X(pb);
+        Wide eby = static_cast<Wide>(Accessor::Y(nb1)) - Accessor::Y(pb);
+        Wide turn = eax * eby - eay * ebx;
+        if (cb >= nb || (ca < na && turn > 0)) {
+            ca++;
+        }
+        else if (ca >= na || turn < 0) {
+            cb++;
+        }
+        else {
+            ca++;
+            cb++;
+        }
+    }
+}
+
+template <class Point, class Accessor, class Alloc>
+inline void minkowskiSum(const Point *a, int na, const Point *b, int nb, std::vector<HullPointT<typename Accessor::Coord>, Alloc> *out, Accessor get)
+{
+    minkowskiMerge(a, na, b, nb, 1, out, get);
+}
+
+template <class Scalar, class Alloc>
+inline void minkowskiSum(const HullPointT<Scalar> *a, int na, const HullPointT<Scalar> *b, int nb, std::vector<HullPointT<Scalar>, Alloc> *out)
+{
+    minkowskiMerge(a, na, b, nb, 1, out, HullPointAccessor<Scalar>());
+}
+
+// Minkowski difference b - a, matching the group 2 minus group 1 convention
+// of the drawing code
+template <class Point, class Accessor, class Alloc>
+inline void minkowskiDifference(const Point *a, int na, const Point *b, int nb, std::vector<HullPointT<typename Accessor::Coord>, Alloc> *out, Accessor get)
+{
+    minkowskiMerge(a, na, b, nb, -1, out, get);
+}
+
+template <class Scalar, class Alloc>
+inline void minkowskiDifference(const HullPointT<Scalar> *a, int na, const HullPointT<Scalar> *b, int nb, std::vector<HullPointT<Scalar>, Alloc> *out)
+{
+    minkowskiMerge(a, na, b, nb, -1, out, HullPointAccessor<Scalar>());
+}
+
+// Strict interior test against a counter-clockwise hull
+template <class Point, class Accessor>
+inline bool hullContains(const Point *hull, int n, typename Accessor::Coord x, typename Accessor::Coord y, Accessor)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    if (n < 3) {
+        return false;
+    }
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        Wide side = orientWide<Wide>(Accessor::X(hull[j]), Accessor::Y(hull[j]), Accessor::X(hull[i]), Accessor::Y(hull[i]), x, y);
+        if (side <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class Scalar>
+inline bool hullContains(const HullPointT<Scalar> *hull, int n, HullPointT<Scalar> p)
+{
+    return hullContains(hull, n, p.x, p.y, HullPointAccessor<Scalar>());
+}
+
+// Containment for many points at once. Points are stored as separate x and y
+// arrays and the inner loop runs over points with no branches, so it
+// vectorises at the width of ScalarTraits::Batch (8 floats per AVX register,
+// 32x32->64 bit integer multiplies in the fixed-point build).
+template <class Scalar>
+inline void hullContainsBatch(const HullPointT<Scalar> *hull, int n, const Scalar *xs, const Scalar *ys, int count, uint8_t *inside)
+{
+    typedef typename ScalarTraits<Scalar>::Batch Batch;
+    for (int k = 0; k < count; k++) {
+        inside[k] = n >= 3 ? 1 : 0;
+    }
+    for (int i = 0, j = n - 1; i < n && n >= 3; j = i++) {
+        Batch ox = hull[j].x;
+        Batch oy = hull[j].y;
+        Batch ex = static_cast<Batch>(hull[i].x) - ox;
+        Batch ey = static_cast<Batch>(hull[i].y) - oy;
+        for (int k = 0; k < count; k++) {
+            Batch side = ex * (ys[k] - oy) - ey * (xs[k] - ox);
+            inside[k] &= static_cast<uint8_t>(side > 0);
+        }
+    }
+}
+
+template <class Wide>
+struct WidePoint
+{
+    Wide x;
+    Wide y;
+};
+
+template <class Wide> inline Wide wideDot(WidePoint<Wide> a, WidePoint<Wide> b) { return a.x * b.x + a.y * b.y; }
+template <class Wide> inline Wide wideCross(WidePoint<Wide> a, WidePoint<Wide> b) { return a.x * b.y - a.y * b.x; }
+
+template <class Wide>
+inline WidePoint<Wide> wideSub(WidePoint<Wide> a, WidePoint<Wide> b)
+{
+    WidePoint<Wide> p = { a.x - b.x, a.y - b.y };
+    return p;
+}
+
+// Perpendicular of e pointing to the side of p
+template <class Wide>
+inline WidePoint<Wide> widePerpToward(WidePoint<Wide> e, WidePoint<Wide> p)
+{
+    WidePoint<Wide> n = { -e.y, e.x };
+    if (wideDot(n, p) < 0) {
+        n.x = -n.x;
+        n.y = -n.y;
+    }
+    return n;
+}
+
+template <class Point, class Accessor>
+inline WidePoint<typename ScalarTraits<typename Accessor::Coord>::Wide> gjkHullSupport(const Point *a, int na, const Point *b, int nb,
+    WidePoint<typename ScalarTraits<typename Accessor::Coord>::Wide> d, Accessor)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    int ia = 0;
+    int ib = 0;
+    Wide bestA = d.x * Accessor::X(a[0]) + d.y * Accessor::Y(a[0]);
+    Wide bestB = -(d.x * Accessor::X(b[0]) + d.y * Accessor::Y(b[0]));
+    for (int i = 1; i < na; i++) {
+        Wide temp = d.x * Accessor::X(a[i]) + d.y * Accessor::Y(a[i]);
+        if (temp > bestA) {
+            bestA = temp;
+            ia = i;
+        }
+    }
+    for (int i = 1; i < nb; i++) {
+        Wide temp = -(d.x * Accessor::X(b[i]) + d.y * Accessor::Y(b[i]));
+        if (temp > bestB) {
+            bestB = temp;
+            ib = i;
+        }
+    }
+    WidePoint<Wide> p = { static_cast<Wide>(Accessor::X(a[ia])) - Accessor::X(b[ib]), static_cast<Wide>(Accessor::Y(a[ia])) - Accessor::Y(b[ib]) };
+    return p;
+}
+
+// Support of the difference of two point sets by linear scan
+template <class Point, class Accessor>
+struct GJKPointSetSupport
+{
+    const Point *a;
+    int         na;
+    const Point *b;
+    int         nb;
+
+    WidePoint<typename ScalarTraits<typename Accessor::Coord>::Wide> operator()(WidePoint<typename ScalarTraits<typename Accessor::Coord>::Wide> d) const
+    {
+        return gjkHullSupport(a, na, b, nb, d, Accessor());
+    }
+};
+
+// Boolean GJK on the Minkowski difference given by a support functor, which
+// maps a direction to the WidePoint of A - B furthest along it. Touching
+// counts as overlap. In the fixed-point build every test is an exact integer
+// sign.
+template <class Wide, class Support>
+inline bool gjkOverlapWith(const Support &support)
+{
+    typedef WidePoint<Wide> WP;
+
+    WP simplex[3];
+    WP d = { 1, 0 };
+    simplex[0] = support(d);
+    int count = 1;
+    d.x = -simplex[0].x;
+    d.y = -simplex[0].y;
+
+    for (int iter = 0; iter < kHullGJKMaxIterations; iter++) {
+        if (d.x == 0 && d.y == 0) {
+            return true;
+        }
+        WP p = support(d);
+        if (wideDot(p, d) < 0) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            if (simplex[i].x == p.x && simplex[i].y == p.y) {
+                // No progress, the origin sits on the boundary
+                return wideDot(p, d) == 0;
+            }
+        }
+        simplex[count++] = p;
+
+        WP origin = { 0, 0 };
+        WP ao = wideSub(origin, p);
+        if (count == 2) {
+            WP ab = wideSub(simplex[0], p);
+            if (wideCross(ab, ao) == 0) {
+                if (wideDot(ab, ao) >= 0 && wideDot(wideSub(p, simplex[0]), simplex[0]) <= 0) {
+                    return true;
+                }
+                simplex[0] = p;
+                count = 1;
+                d = ao;
+            }
+            else {
+                d = widePerpToward(ab, ao);
+            }
+            continue;
+        }
+
+        // Triangle: keep the edge whose outer side holds the origin
+        WP ab = wideSub(simplex[1], p);
+        WP ac = wideSub(simplex[0], p);
+        WP abOut = widePerpToward(ab, wideSub(origin, ac));
+        WP acOut = widePerpToward(ac, wideSub(origin, ab));
+        if (wideDot(abOut, ao) > 0) {
+            simplex[0] = simplex[1];
+            simplex[1] = p;
+            count = 2;
+            d = abOut;
+        }
+        else if (wideDot(acOut, ao) > 0) {
+            simplex[1] = p;
+            count = 2;
+            d = acOut;
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Boolean GJK on two convex point sets
+template <class Point, class Accessor>
+inline bool gjkOverlap(const Point *a, int na, const Point *b, int nb, Accessor)
+{
+    if (na <= 0 || nb <= 0) {
+        return false;
+    }
+    GJKPointSetSupport<Point, Accessor> support = { a, na, b, nb };
+    return gjkOverlapWith<typename ScalarTraits<typename Accessor::Coord>::Wide>(support);
+}
+
+template <class Scalar>
+inline bool gjkOverlap(const HullPointT<Scalar> *a, int na, const HullPointT<Scalar> *b, int nb)
+{
+    return gjkOverlap(a, na, b, nb, HullPointAccessor<Scalar>());
+}
+
+#endif
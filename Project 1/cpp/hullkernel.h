@@ -0,0 +1,287 @@
+#ifndef _HULLKERNEL_H
+#define _HULLKERNEL_H
+
+#include <cmath>
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+#include "hull2d.h"
+
+// Fixed-memory approximate hull of an unbounded point stream (an epsilon
+// kernel). For each of k fixed directions the summary keeps the point
+// furthest along it, so memory is O(k) however many points go in, and the
+// kept points' hull K sits inside the true hull H.
+//
+// Error bound: H also lies inside P, the intersection of the k support
+// half-planes, and P is K plus one triangle per pair of neighbouring
+// directions, between their two extreme points and the corner of P. So the
+// Hausdorff distance from K to H is at most the largest distance from a
+// corner of P to its opposite kept segment. ErrorBound computes exactly that
+// from the summary alone. In the worst case, a flat vertex hiding between
+// two directions, it reaches (diameter / 2) tan(pi / k); on curved
+// boundaries it shrinks like diameter / k^2.
+//
+// Directions are integer vectors of length about 2^15 and every comparison
+// is an exact Wide dot product, with ties going to the lexicographically
+// smaller point, so a summary does not depend on insertion order. Two
+// summaries with the same k merge by keeping the further point per
+// direction, which gives exactly the summary of the union. Partial summaries
+// from threads, chunks or machines combine in any order.
+
+const int       kHullKernelDirections = 64;
+const double    kHullKernelDirectionScale = 32768.0;
+const int       kHullKernelBlock = 1024;
+
+template <class Scalar>
+class HullKernel
+{
+public:
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+
+    explicit HullKernel(int directions = kHullKernelDirections)
+    {
+        Reset(directions);
+    }
+
+    // Direction count whose worst-case error is at most epsilon times the
+    // diameter
+    static int DirectionsFor(double epsilon)
+    {
+        int k = 3;
+        while (0.5 * tan(3.14159265358979 / k) > epsilon && k < (1 << 20)) {
+            k *= 2;
+        }
+        return k;
+    }
+
+    void Reset(int directions)
+    {
+        if (directions < 3) {
+            directions = 3;
+        }
+        dirX.resize(directions);
+        dirY.resize(directions);
+        support.assign(directions, std::numeric_limits<Wide>::lowest());
+        extreme.resize(directions);
+        for (int j = 0; j < directions; j++) {
+            double a = 2.0 * 3.14159265358979 * j / directions;
+            dirX[j] = static_cast<Wide>(floor(cos(a) * kHullKernelDirectionScale + 0.5));
+            dirY[j] = static_cast<Wide>(floor(sin(a) * kHullKernelDirectionScale + 0.5));
+        }
+        count = 0;
+    }
+
+    void Insert(Scalar x, Scalar y)
+    {
+        int k = Directions();
+        for (int j = 0; j < k; j++) {
+            Keep(j, dirX[j] * x + dirY[j] * y, MakeHullPoint<Scalar>(x, y));
+        }
+        count++;
+    }
+
+    // Structure-of-arrays batch, taken in blocks that stay in L1 while every
+    // direction runs over them. Points inside a disk that lies strictly
+    // within the kept hull cannot move any extreme and are dropped first;
+    // once the stream has filled out its hull that is nearly all of them.
+    void InsertBatch(const Scalar *xs, const Scalar *ys, int n)
+    {
+        for (int start = 0; start < n; start += kHullKernelBlock) {
+            InsertBlock(xs + start, ys + start, n - start < kHullKernelBlock ? n - start : kHullKernelBlock);
+        }
+    }
+
+    // Fold another summary into this one; false if the direction sets differ
+    bool Merge(const HullKernel &other)
+    {
+        if (other.Directions() != Directions()) {
+            return false;
+        }
+        if (other.count == 0) {
+            return true;
+        }
+        for (int j = 0; j < Directions(); j++) {
+            Keep(j, other.support[j], other.extreme[j]);
+        }
+        count += other.count;
+        return true;
+    }
+
+    // Approximate hull in counter-clockwise order
+    void Vertices(std::vector<HullPointT<Scalar> > *out) const
+    {
+        out->clear();
+        if (count == 0) {
+            return;
+        }
+        std::vector<int> index;
+        convexHull(&extreme[0], Directions(), &index);
+        for (size_t i = 0; i < index.size(); i++) {
+            out->push_back(extreme[index[i]]);
+        }
+    }
+
+    // Upper bound on the Hausdorff distance between the approximate hull and
+    // the hull of every point inserted, from the corners of the support
+    // polygon P
+    double ErrorBound() const
+    {
+        if (count == 0) {
+            return 0.0;
+        }
+        double worst = 0.0;
+        int k = Directions();
+        for (int j = 0; j < k; j++) {
+            int l = (j + 1) % k;
+            double ax = static_cast<double>(dirX[j]), ay = static_cast<double>(dirY[j]);
+            double bx = static_cast<double>(dirX[l]), by = static_cast<double>(dirY[l]);
+            double ha = static_cast<double>(support[j]), hb = static_cast<double>(support[l]);
+            double det = ax * by - ay * bx;
+            if (det <= 0.0) {
+                continue;
+            }
+            double cx = (ha * by - hb * ay) / det;
+            double cy = (ax * hb - bx * ha) / det;
+            double d = SegmentDistance(cx, cy, extreme[j], extreme[l]);
+            worst = d > worst ? d : worst;
+        }
+        return worst;
+    }
+
+    // The a priori bound for the current diameter, from the kept points
+    double WorstCaseBound() const
+    {
+        double diameter = 0.0;
+        int k = Directions();
+        for (int j = 0; j < k && count > 0; j++) {
+            for (int l = j + 1; l < k; l++) {
+                double dx = static_cast<double>(extreme[j].x) - extreme[l].x;
+                double dy = static_cast<double>(extreme[j].y) - extreme[l].y;
+                double d = sqrt(dx * dx + dy * dy);
+                diameter = d > diameter ? d : diameter;
+            }
+        }
+        return 0.5 * diameter * tan(3.14159265358979 / k);
+    }
+
+    int Directions() const { return static_cast<int>(dirX.size()); }
+    uint64_t Count() const { return count; }
+    size_t Bytes() const { return Directions() * (2 * sizeof(Wide) + sizeof(Wide) + sizeof(HullPointT<Scalar>)); }
+    const HullPointT<Scalar> &Extreme(int j) const { return extreme[j]; }
+
+private:
+    // Per direction, one pass finds the largest dot product (a plain max
+    // reduction) and a second pass only runs if that reaches the current
+    // extreme
+    void InsertBlock(const Scalar *xs, const Scalar *ys, int n)
+    {
+        Scalar fx[kHullKernelBlock];
+        Scalar fy[kHullKernelBlock];
+        double cx, cy, r2;
+        InnerDisk(&cx, &cy, &r2);
+        int m = 0;
+        for (int i = 0; i < n; i++) {
+            double dx = xs[i] - cx;
+            double dy = ys[i] - cy;
+            fx[m] = xs[i];
+            fy[m] = ys[i];
+            m += dx * dx + dy * dy >= r2 ? 1 : 0;
+        }
+        count += n;
+        if (m == 0) {
+            return;
+        }
+
+        int k = Directions();
+        for (int j = 0; j < k; j++) {
+            Wide ux = dirX[j];
+            Wide uy = dirY[j];
+            Wide best = ux * fx[0] + uy * fy[0];
+            for (int i = 1; i < m; i++) {
+                Wide d = ux * fx[i] + uy * fy[i];
+                best = d > best ? d : best;
+            }
+            if (best < support[j]) {
+                continue;
+            }
+            for (int i = 0; i < m; i++) {
+                if (ux * fx[i] + uy * fy[i] == best) {
+                    Keep(j, best, MakeHullPoint<Scalar>(fx[i], fy[i]));
+                }
+            }
+        }
+    }
+
+    // Disk about the mean of the kept points, inside their hull by a small
+    // margin. The kept points in direction order run counter-clockwise round
+    // the hull, so the radius is the least distance to the lines through
+    // neighbours. r2 is negative when there is no such disk.
+    void InnerDisk(double *cx, double *cy, double *r2) const
+    {
+        *cx = *cy = 0.0;
+        *r2 = -1.0;
+        if (count == 0) {
+            return;
+        }
+        int k = Directions();
+        for (int j = 0; j < k; j++) {
+            *cx += static_cast<double>(extreme[j].x) / k;
+            *cy += static_cast<double>(extreme[j].y) / k;
+        }
+        double r = -1.0;
+        for (int j = 0; j < k; j++) {
+            const HullPointT<Scalar> &a = extreme[j];
+            const HullPointT<Scalar> &b = extreme[(j + 1) % k];
+            double ex = static_cast<double>(b.x) - a.x;
+            double ey = static_cast<double>(b.y) - a.y;
+            double len = sqrt(ex * ex + ey * ey);
+            if (len == 0.0) {
+                continue;
+            }
+            double d = (ex * (*cy - a.y) - ey * (*cx - a.x)) / len;
+            if (d <= 0.0) {
+                return;
+            }
+            r = r < 0.0 || d < r ? d : r;
+        }
+        if (r > 0.0) {
+            r *= 1.0 - 1e-6;
+            *r2 = r * r;
+        }
+    }
+
+    // Take p as the extreme for direction j if it is further along, or as far
+    // and lexicographically smaller. Supports start at the lowest Wide, so
+    // the first point always gets in.
+    void Keep(int j, Wide d, HullPointT<Scalar> p)
+    {
+        const HullPointT<Scalar> &e = extreme[j];
+        if (d > support[j] || (d == support[j] && (p.x < e.x || (p.x == e.x && p.y < e.y)))) {
+            support[j] = d;
+            extreme[j] = p;
+        }
+    }
+
+    static double SegmentDistance(double px, double py, HullPointT<Scalar> a, HullPointT<Scalar> b)
+    {
+        double ex = static_cast<double>(b.x) - a.x;
+        double ey = static_cast<double>(b.y) - a.y;
+        double wx = px - a.x;
+        double wy = py - a.y;
+        double len = ex * ex + ey * ey;
+        double t = len > 0.0 ? (wx * ex + wy * ey) / len : 0.0;
+        t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+        double dx = wx - t * ex;
+        double dy = wy - t * ey;
+        return sqrt(dx * dx + dy * dy);
+    }
+
+    std::vector<Wide>                   dirX;
+    std::vector<Wide>                   dirY;
+    std::vector<Wide>                   support;
+    std::vector<HullPointT<Scalar> >    extreme;
+    uint64_t                            count;
+};
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef _HULLSHARD_H
+#define _HULLSHARD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "hull2d.h"
+
+// Hull summaries for computing one hull over shards of points.
+//
+// A shard's points reduce to their hull, which is all that has to leave the
+// shard: the hull of the union is the hull of the partial hulls. A summary is
+// that hull in a compact little-endian form,
+//
+//   offset  size  field
+//        0     4  magic "HSUM"
+//        4     2  version (1)
+//        6     1  scalar kind: 0 float, 1 double, 2 int32
+//        7     1  zero
+//        8     4  vertex count h
+//       12     4  zero
+//       16     8  number of source points the hull covers
+//       24  h*2s  vertices x0 y0 x1 y1 ... in counter-clockwise order
+//
+// so a shard of any size costs 24 + 2 h sizeof(Scalar) bytes. Summaries
+// merge with mergeHulls, so partial hulls can be reduced in a tree.
+
+const uint32_t  kHullSummaryMagic = 0x4D555348;
+const uint16_t  kHullSummaryVersion = 1;
+const size_t    kHullSummaryHeader = 24;
+const int       kHullShardFanIn = 4;
+
+template <class Scalar> struct HullSummaryKind;
+template <> struct HullSummaryKind<float> { enum { Value = 0 }; };
+template <> struct HullSummaryKind<double> { enum { Value = 1 }; };
+template <> struct HullSummaryKind<int32_t> { enum { Value = 2 }; };
+
+template <class Scalar>
+struct HullSummary
+{
+    std::vector<HullPointT<Scalar> >    vertices;
+    uint64_t                            sourceCount;
+};
+
+// Little-endian byte order whatever the host's
+inline void putLE(uint64_t v, int bytes, uint8_t *out)
+{
+    for (int i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+inline uint64_t getLE(const uint8_t *in, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return v;
+}
+
+template <class Scalar>
+inline void putScalar(Scalar s, uint8_t *out)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &s, sizeof(Scalar));
+    putLE(bits, sizeof(Scalar), out);
+}
+
+template <class Scalar>
+inline Scalar getScalar(const uint8_t *in)
+{
+    uint64_t bits = getLE(in, sizeof(Scalar));
+    Scalar s;
+    memcpy(&s, &bits, sizeof(Scalar));
+    return s;
+}
+
+// Bytes a summary of h vertices takes
+template <class Scalar>
+inline size_t hullSummaryBytes(size_t h)
+{
+    return kHullSummaryHeader + 2 * sizeof(Scalar) * h;
+}
+
+template <class Scalar>
+inline void serializeHull(const HullSummary<Scalar> &summary, std::vector<uint8_t> *out)
+{
+    size_t h = summary.vertices.size();
+    out->assign(hullSummaryBytes<Scalar>(h), 0);
+    uint8_t *p = &(*out)[0];
+    putLE(kHullSummaryMagic, 4, p);
+    putLE(kHullSummaryVersion, 2, p + 4);
+    p[6] = static_cast<uint8_t>(HullSummaryKind<Scalar>::Value);
+    putLE(h, 4, p + 8);
+    putLE(summary.sourceCount, 8, p + 16);
+    p += kHullSummaryHeader;
+    for (size_t i = 0; i < h; i++) {
+        putScalar(summary.vertices[i].x, p);
+        putScalar(summary.vertices[i].y, p + sizeof(Scalar));
+        p += 2 * sizeof(Scalar);
+    }
+}
+
+// Checks the header against Scalar and the length. Returns the vertex count,
+// or -1 if the header is not a summary of this kind (h is needed before the
+// rest of a message can be read).
+template <class Scalar>
+inline int64_t hullSummaryCount(const uint8_t *data, size_t bytes)
+{
+    if (bytes < kHullSummaryHeader || getLE(data, 4) != kHullSummaryMagic || getLE(data + 4, 2) != kHullSummaryVersion) {
+        return -1;
+    }
+    if (data[6] != HullSummaryKind<Scalar>::Value || data[7] != 0 || getLE(data + 12, 4) != 0) {
+        return -1;
+    }
+    return static_cast<int64_t>(getLE(data + 8, 4));
+}
+
+// Returns false on a malformed or truncated summary
+template <class Scalar>
+inline bool deserializeHull(const uint8_t *data, size_t bytes, HullSummary<Scalar> *summary)
+{
+    int64_t h = hullSummaryCount<Scalar>(data, bytes);
+    if (h < 0 || bytes != hullSummaryBytes<Scalar>(static_cast<size_t>(h))) {
+        return false;
+    }
+    summary->sourceCount = getLE(data + 16, 8);
+    summary->vertices.resize(static_cast<size_t>(h));
+    const uint8_t *p = data + kHullSummaryHeader;
+    for (int64_t i = 0; i < h; i++) {
+        summary->vertices[i] = MakeHullPoint<Scalar>(getScalar<Scalar>(p), getScalar<Scalar>(p + sizeof(Scalar)));
+        p += 2 * sizeof(Scalar);
+    }
+    return true;
+}
+
+// Summary of a shard of raw points
+template <class Scalar>
+inline void summarizeHull(const HullPointT<Scalar> *points, int n, HullSummary<Scalar> *summary)
+{
+    std::vector<int> index;
+    convexHull(points, n, &index);
+    summary->vertices.resize(index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        summary->vertices[i] = points[index[i]];
+    }
+    summary->sourceCount = n > 0 ? static_cast<uint64_t>(n) : 0;
+}
+
+// Fold k summaries into one with mergeHulls
+template <class Scalar>
+inline void mergeHullSummaries(const HullSummary<Scalar> *parts, int k, HullSummary<Scalar> *out)
+{
+    std::vector<HullPointT<Scalar> > points;
+    std::vector<int> first(k);
+    std::vector<int> count(k);
+    uint64_t sources = 0;
+    for (int i = 0; i < k; i++) {
+        first[i] = static_cast<int>(points.size());
+        count[i] = static_cast<int>(parts[i].vertices.size());
+        points.insert(points.end(), parts[i].vertices.begin(), parts[i].vertices.end());
+        sources += parts[i].sourceCount;
+    }
+    std::vector<int> index;
+    if (k > 0) {
+        mergeHulls(points.empty() ? NULL : &points[0], &first[0], &count[0], k, &index);
+    }
+    out->vertices.resize(index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+        out->vertices[i] = points[index[i]];
+    }
+    out->sourceCount = sources;
+}
+
+#ifndef _WIN32
+
+// Local coordinator and workers over pipes. Each worker is a forked process
+// that hulls one contiguous shard of the points (inherited, not copied), so
+// only summaries cross process boundaries. Workers form a tree with fanIn
+// children each: a worker merges its children's summaries into its own and
+// sends one summary to its parent, and worker 0 answers the coordinator.
+//
+// The workers allocate as they hull and merge. A forked child has only the
+// thread that forked it, so a lock that another thread of the parent held at
+// the fork (in malloc, say) is never released in the child. Call
+// shardedHull only while the process has a single thread: before starting a
+// NarrowPhaseBatch with more than one thread or a SceneSaver, or after they
+// are gone.
+
+inline bool writeFully(int fd, const uint8_t *data, size_t bytes)
+{
+    while (bytes > 0) {
+        ssize_t done = write(fd, data, bytes);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return false;
+        }
+        data += done;
+        bytes -= static_cast<size_t>(done);
+    }
+    return true;
+}
+
+inline bool readFully(int fd, uint8_t *data, size_t bytes)
+{
+    while (bytes > 0) {
+        ssize_t done = read(fd, data, bytes);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return false;
+        }
+        data += done;
+        bytes -= static_cast<size_t>(done);
+    }
+    return true;
+}
+
+// One summary message from a pipe: the header, then the vertices it announces
+template <class Scalar>
+inline bool readHullSummary(int fd, HullSummary<Scalar> *summary, size_t *bytes)
+{
+    std::vector<uint8_t> buffer(kHullSummaryHeader);
+    if (!readFully(fd, &buffer[0], kHullSummaryHeader)) {
+        return false;
+    }
+    int64_t h = hullSummaryCount<Scalar>(&buffer[0], kHullSummaryHeader);
+    if (h < 0) {
+        return false;
+    }
+    buffer.resize(hullSummaryBytes<Scalar>(static_cast<size_t>(h)));
+    if (buffer.size() > kHullSummaryHeader && !readFully(fd, &buffer[kHullSummaryHeader], buffer.size() - kHullSummaryHeader)) {
+        return false;
+    }
+    *bytes += buffer.size();
+    return deserializeHull(&buffer[0], buffer.size(), summary);
+}
+
+template <class Scalar>
+inline bool writeHullSummary(int fd, const HullSummary<Scalar> &summary)
+{
+    std::vector<uint8_t> buffer;
+    serializeHull(summary, &buffer);
+    return writeFully(fd, &buffer[0], buffer.size());
+}
+
+// Hull of n points computed by that many worker processes. Returns false if
+// a worker could not be started or a summary was lost. bytes, if given,
+// receives the size of the summary the coordinator read. Single-threaded
+// callers only; see above.
+template <class Scalar>
+inline bool shardedHull(const HullPointT<Scalar> *points, int n, int workers, HullSummary<Scalar> *out, size_t *bytes = NULL, int fanIn = kHullShardFanIn)
+{
+    workers = workers < 1 ? 1 : workers;
+    fanIn = fanIn < 1 ? 1 : fanIn;
+    std::vector<int> readEnd(workers, -1);
+    std::vector<int> writeEnd(workers, -1);
+    std::vector<pid_t> pids(workers, -1);
+    bool ok = true;
+    for (int w = 0; w < workers && ok; w++) {
+        int fds[2];
+        ok = pipe(fds) == 0;
+        if (ok) {
+            readEnd[w] = fds[0];
+            writeEnd[w] = fds[1];
+        }
+    }
+
+    for (int w = 0; w < workers && ok; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            ok = false;
+            break;
+        }
+        if (pid > 0) {
+            pids[w] = pid;
+            continue;
+        }
+
+        // Worker w keeps its own write end and its children's read ends, so
+        // a child that dies shows up as end of file rather than a hang
+        int firstChild = w * fanIn + 1;
+        int lastChild = w * fanIn + fanIn;
+        for (int c = 0; c < workers; c++) {
+            if (c != w) {
+                close(writeEnd[c]);
+            }
+            if (c < firstChild || c > lastChild) {
+                close(readEnd[c]);
+            }
+        }
+
+        // Own shard, then each child's summary, then one message up
+        int begin = static_cast<int>(static_cast<int64_t>(n) * w / workers);
+        int end = static_cast<int>(static_cast<int64_t>(n) * (w + 1) / workers);
+        std::vector<HullSummary<Scalar> > parts(1);
+        summarizeHull(points + begin, end - begin, &parts[0]);
+        bool good = true;
+        size_t received = 0;
+        for (int c = firstChild; c <= lastChild && c < workers && good; c++) {
+            parts.push_back(HullSummary<Scalar>());
+            good = readHullSummary(readEnd[c], &parts.back(), &received);
+        }
+        HullSummary<Scalar> merged;
+        mergeHullSummaries(&parts[0], static_cast<int>(parts.size()), &merged);
+        good = good && writeHullSummary(writeEnd[w], merged);
+        _exit(good ? 0 : 1);
+    }
+
+    for (int w = 0; w < workers; w++) {
+        if (writeEnd[w] >= 0) {
+            close(writeEnd[w]);
+        }
+    }
+    size_t received = 0;
+    ok = ok && readHullSummary(readEnd[0], out, &received);
+    for (int w = 0; w < workers; w++) {
+        if (readEnd[w] >= 0) {
+            close(readEnd[w]);
+        }
+        int status = 0;
+        if (pids[w] > 0 && (waitpid(pids[w], &status, 0) != pids[w] || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+            ok = false;
+        }
+    }
+    if (bytes != NULL) {
+        *bytes = received;
+    }
+    return ok;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef _INPUTTRACE_H
+#define _INPUTTRACE_H
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "allocaccount.h"
+#include "recompute.h"
+#include "scenemodel.h"
+#include "scenesnapshot.h"
+
+// Recorded input for replaying the window's interaction without a window.
+//
+// A trace holds the pick, drag, release, wheel and key events the window
+// received, in order, with view-space positions in DIPs so it replays at any
+// DPI. Whenever the scene is replaced (a button, a new seed, F9) the new
+// scene follows as a full snapshot frame, so replay starts from exactly what
+// the window had.
+//
+// File: a 16-byte header (magic "ITRC", version 1, then zero), then records
+// of 32 bytes, little-endian:
+//    0  4  kind
+//    4  4  code: the virtual key of a key event
+//    8  8  microseconds since recording started
+//   16  4  x
+//   20  4  y
+//   24  4  wheel delta
+//   28  4  payload bytes that follow: one full scene frame for a scene event
+// A record cut short at the end of the file is ignored.
+
+const uint32_t  kTraceMagic = 0x43525449;
+const uint16_t  kTraceVersion = 1;
+const size_t    kTraceHeader = 16;
+const size_t    kTraceRecord = 32;
+
+enum TraceEventKind
+{
+    TraceScene,         // The scene was replaced
+    TracePick,          // Left button down
+    TraceDrag,          // Mouse move with the left button held
+    TraceRelease,       // Left button up
+    TraceWheel,
+    TraceKey,
+    TraceEventKindCount
+};
+
+struct TraceEvent
+{
+    uint32_t    kind;
+    uint32_t    code;       // Virtual key, or for a scene event the index into InputTrace::scenes
+    int64_t     time;       // Microseconds
+    float       x;
+    float       y;
+    int32_t     delta;
+};
+
+struct InputTrace
+{
+    std::vector<TraceEvent>     events;
+    std::vector<SceneSnapshot>  scenes;
+};
+
+inline const char *traceEventName(uint32_t kind)
+{
+    static const char *names[] = { "scene", "pick", "drag", "release", "wheel", "key" };
+    return kind < TraceEventKindCount ? names[kind] : "unknown";
+}
+
+inline void encodeTraceRecord(const TraceEvent &e, uint32_t payload, uint8_t *out)
+{
+    uint32_t bits;
+    putLE(e.kind, 4, out);
+    putLE(e.code, 4, out + 4);
+    putLE(static_cast<uint64_t>(e.time), 8, out + 8);
+    memcpy(&bits, &e.x, 4);
+    putLE(bits, 4, out + 16);
+    memcpy(&bits, &e.y, 4);
+    putLE(bits, 4, out + 20);
+    putLE(static_cast<uint32_t>(e.delta), 4, out + 24);
+    putLE(payload, 4, out + 28);
+}
+
+inline void decodeTraceRecord(const uint8_t *in, TraceEvent *e, uint32_t *payload)
+{
+    uint32_t bits;
+    e->kind = static_cast<uint32_t>(getLE(in, 4));
+    e->code = static_cast<uint32_t>(getLE(in + 4, 4));
+    e->time = static_cast<int64_t>(getLE(in + 8, 8));
+    bits = static_cast<uint32_t>(getLE(in + 16, 4));
+    memcpy(&e->x, &bits, 4);
+    bits = static_cast<uint32_t>(getLE(in + 20, 4));
+    memcpy(&e->y, &bits, 4);
+    e->delta = static_cast<int32_t>(getLE(in + 24, 4));
+    *payload = static_cast<uint32_t>(getLE(in + 28, 4));
+}
+
+// Appends events to a trace file as they happen. Every call is a no-op
+// while no file is open, so the window can record unconditionally.
+class InputTraceWriter
+{
+public:
+    InputTraceWriter() : file(NULL), skew(0) {}
+    ~InputTraceWriter() { Close(); }
+
+    bool Open(const char *path)
+    {
+        Close();
+        file = fopen(path, "wb");
+        if (file == NULL) {
+            return false;
+        }
+        uint8_t header[kTraceHeader] = {};
+        putLE(kTraceMagic, 4, header);
+        putLE(kTraceVersion, 2, header + 4);
+        start = std::chrono::steady_clock::now();
+        skew = 0;
+        return Write(header, kTraceHeader);
+    }
+
+    void Close()
+    {
+        if (file != NULL) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    bool Recording() const { return file != NULL; }
+
+    // Move the trace's clock forward, for synthetic traces that stand in for
+    // time passing between events
+    void Advance(int64_t us) { skew += us; }
+
+    void Record(TraceEventKind kind, float x, float y, int32_t delta = 0, uint32_t code = 0)
+    {
+        if (file == NULL) {
+            return;
+        }
+        TraceEvent e = { static_cast<uint32_t>(kind), code, Now(), x, y, delta };
+        uint8_t record[kTraceRecord];
+        encodeTraceRecord(e, 0, record);
+        Write(record, kTraceRecord);
+    }
+
+    void RecordScene(const SceneSnapshot &scene)
+    {
+        if (file == NULL) {
+            return;
+        }
+        std::vector<uint8_t> frame;
+        encodeSceneFrame(scene, NULL, 1, &frame);
+        TraceEvent e = { TraceScene, 0, Now(), 0.0f, 0.0f, 0 };
+        uint8_t record[kTraceRecord];
+        encodeTraceRecord(e, static_cast<uint32_t>(frame.size()), record);
+        Write(record, kTraceRecord);
+        Write(&frame[0], frame.size());
+    }
+
+private:
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() + skew;
+    }
+
+    // A failed write stops the recording rather than leaving a torn record
+    bool Write(const uint8_t *data, size_t bytes)
+    {
+        if (fwrite(data, 1, bytes, file) != bytes) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    FILE                                    *file;
+    std::chrono::steady_clock::time_point   start;
+    int64_t                                 skew;       // Microseconds added by Advance
+};
+
+// Returns false if the file is not a trace. Events after a torn record or a
+// scene frame that does not decode are dropped.
+inline bool readInputTrace(const char *path, InputTrace *trace)
+{
+    trace->events.clear();
+    trace->scenes.clear();
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    bool ok = fseek(f, 0, SEEK_END) == 0;
+    long size = ok ? ftell(f) : -1;
+    ok = size >= static_cast<long>(kTraceHeader) && fseek(f, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = fread(&data[0], 1, data.size(), f) == data.size();
+    }
+    fclose(f);
+    if (!ok || getLE(&data[0], 4) != kTraceMagic || getLE(&data[4], 2) != kTraceVersion) {
+        return false;
+    }
+
+    size_t offset = kTraceHeader;
+    while (data.size() - offset >= kTraceRecord) {
+        TraceEvent e;
+        uint32_t payload;
+        decodeTraceRecord(&data[offset], &e, &payload);
+        offset += kTraceRecord;
+        if (payload > data.size() - offset || e.kind >= TraceEventKindCount) {
+            break;
+        }
+        if (e.kind == TraceScene) {
+            SceneSnapshot scene;
+            if (!decodeSceneFrames(&data[offset], payload, &scene)) {
+                break;
+            }
+            e.code = static_cast<uint32_t>(trace->scenes.size());
+            trace->scenes.push_back(scene);
+        }
+        offset += payload;
+        trace->events.push_back(e);
+    }
+    return true;
+}
+
+// q in [0, 1]; 0 with no samples
+inline double tracePercentile(const std::vector<double> &samples, double q)
+{
+    std::vector<double> sorted(samples);
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+// Per-kind compute latency of a replay, in microseconds, and the most
+// geometry memory any one event of the kind had live at once
+struct TraceLatency
+{
+    TraceLatency()
+    {
+        for (int k = 0; k < TraceEventKindCount; k++) {
+            peakBytes[k] = 0;
+        }
+    }
+
+    std::vector<double>     samples[TraceEventKindCount];
+    uint64_t                peakBytes[TraceEventKindCount];
+
+    double Percentile(int kind, double q) const { return tracePercentile(samples[kind], q); }
+};
+
+// Feed each event to the model and bring it up to date, as the window did
+// before recomputes were scheduled: every edit rebuilds the caches before
+// the next draw. The time of both is the event's latency; the memory both
+// allocate is its peak.
+inline void replayInputTrace(const InputTrace &trace, SceneModel *model, TraceLatency *latency)
+{
+    for (size_t i = 0; i < trace.events.size(); i++) {
+        const TraceEvent &e = trace.events[i];
+        auto start = std::chrono::steady_clock::now();
+        AllocationScope query;
+        switch (e.kind) {
+        case TraceScene:
+            model->Load(trace.scenes[e.code]);
+            break;
+
+        case TracePick:
+            model->Pick(e.x, e.y);
+            break;
+
+        case TraceDrag:
+            model->Drag(e.x, e.y);
+            break;
+
+        case TraceRelease:
+            model->Release();
+            break;
+
+        case TraceWheel:
+            model->Wheel(e.delta);
+            break;
+
+        case TraceKey:
+            model->Key(e.code);
+            break;
+        }
+        if (model->TakeEdits()) {
+            model->Invalidate();
+        }
+        model->Update();
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        latency->samples[e.kind].push_back(us);
+        uint64_t peak = query.PeakBytes();
+        latency->peakBytes[e.kind] = peak > latency->peakBytes[e.kind] ? peak : latency->peakBytes[e.kind];
+    }
+}
+
+// What a scheduled replay did
+struct ScheduleReplay
+{
+    ScheduleReplay() : events(0), edits(0), recomputes(0), coalesced(0) {}
+
+    uint64_t                events;
+    uint64_t                edits;
+    uint64_t                recomputes;
+    uint64_t                coalesced;
+    std::vector<double>     waits;      // Trace microseconds from the oldest edit a recompute covered to its start
+    std::vector<double>     compute;    // Microseconds each recompute took
+};
+
+// Feed each event to the model as the window does with a scheduler: edits
+// wait for the scheduler's next slot and the last result stands in until
+// then, while a replaced scene is computed at once. The trace's timestamps
+// are the clock, so the schedule does not depend on how fast this machine
+// replays. The timer the window arms is simulated by running any slot that
+// falls before the next event.
+inline void replayScheduled(const InputTrace &trace, SceneModel *model, RecomputeScheduler *scheduler, ScheduleReplay *out)
+{
+    auto recompute = [&](int64_t at) {
+        if (scheduler->Pending()) {
+            out->waits.push_back(static_cast<double>(at - scheduler->Oldest()));
+        }
+        auto start = std::chrono::steady_clock::now();
+        scheduler->Begin(at);
+        model->Invalidate();
+        model->Update();
+        out->compute.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    int64_t now = 0;
+    for (size_t i = 0; i < trace.events.size(); i++) {
+        const TraceEvent &e = trace.events[i];
+        int64_t wait = scheduler->Wait(now);
+        if (wait >= 0 && now + wait <= e.time) {
+            recompute(now + wait);
+        }
+        now = e.time > now ? e.time : now;
+        switch (e.kind) {
+        case TraceScene:
+            model->Load(trace.scenes[e.code]);
+            break;
+
+        case TracePick:
+            model->Pick(e.x, e.y);
+            break;
+
+        case TraceDrag:
+            model->Drag(e.x, e.y);
+            break;
+
+        case TraceRelease:
+            model->Release();
+            break;
+
+        case TraceWheel:
+            model->Wheel(e.delta);
+            break;
+
+        case TraceKey:
+            model->Key(e.code);
+            break;
+        }
+        if (model->TakeEdits()) {
+            scheduler->Edit(now);
+        }
+        if (!model->Valid() || scheduler->Due(now)) {
+            recompute(now);
+        }
+        else {
+            model->Update();
+        }
+        out->events++;
+    }
+    int64_t wait = scheduler->Wait(now);
+    if (wait >= 0) {
+        recompute(now + wait);
+    }
+    out->edits = scheduler->Edits();
+    out->recomputes = scheduler->Runs();
+    out->coalesced = scheduler->Coalesced();
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef _INTERSECTION2D_H
+#define _INTERSECTION2D_H
+
+#include <vector>
+
+#include "hull2d.h"
+
+// Intersection of two counter-clockwise convex polygons in O(n + m) by
+// O'Rourke's edge chasing: advance along whichever polygon's edge is "behind"
+// the other, and emit crossings plus the vertices of whichever polygon is
+// currently inside. Sign tests use the exact Wide predicates from hull2d.h;
+// only the crossing points themselves are computed in Real.
+
+enum ConvexInside
+{
+    kInsideUnknown,
+    kInsideP,
+    kInsideQ
+};
+
+// Sign of the edge crossing test
+enum SegmentCrossing
+{
+    kCrossNone,
+    kCrossProper,   // interiors cross at one point
+    kCrossVertex,   // an endpoint lies on the other segment
+    kCrossOverlap   // collinear and overlapping
+};
+
+template <class Wide>
+inline int wideSign(Wide v)
+{
+    return v > 0 ? 1 : (v < 0 ? -1 : 0);
+}
+
+// Crossing of segments ab and cd. Fills p when the segments meet at a point.
+template <class Point, class Accessor>
+inline SegmentCrossing segmentCrossing(const Point &a, const Point &b, const Point &c, const Point &d,
+    HullPointT<typename ScalarTraits<typename Accessor::Coord>::Real> *p, Accessor)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    typedef typename ScalarTraits<typename Accessor::Coord>::Real Real;
+
+    Wide rx = static_cast<Wide>(Accessor::X(b)) - Accessor::X(a);
+    Wide ry = static_cast<Wide>(Accessor::Y(b)) - Accessor::Y(a);
+    Wide sx = static_cast<Wide>(Accessor::X(d)) - Accessor::X(c);
+    Wide sy = static_cast<Wide>(Accessor::Y(d)) - Accessor::Y(c);
+    Wide qx = static_cast<Wide>(Accessor::X(c)) - Accessor::X(a);
+    Wide qy = static_cast<Wide>(Accessor::Y(c)) - Accessor::Y(a);
+
+    Wide denom = rx * sy - ry * sx;
+    Wide tNum = qx * sy - qy * sx;
+    Wide uNum = qx * ry - qy * rx;
+    if (denom == 0) {
+        if (uNum != 0) {
+            return kCrossNone;
+        }
+        // Collinear: overlap if the projections of c and d onto ab meet [0, |r|^2]
+        Wide len = rx * rx + ry * ry;
+        Wide pc = qx * rx + qy * ry;
+        Wide pd = (static_cast<Wide>(Accessor::X(d)) - Accessor::X(a)) * rx + (static_cast<Wide>(Accessor::Y(d)) - Accessor::Y(a)) * ry;
+        if ((pc < 0 && pd < 0) || (pc > len && pd > len)) {
+            return kCrossNone;
+        }
+        return kCrossOverlap;
+    }
+    if (denom < 0) {
+        denom = -denom;
+        tNum = -tNum;
+        uNum = -uNum;
+    }
+    if (tNum < 0 || tNum > denom || uNum < 0 || uNum > denom) {
+        return kCrossNone;
+    }
+
+    Real t = static_cast<Real>(tNum) / static_cast<Real>(denom);
+    p->x = static_cast<Real>(Accessor::X(a)) + static_cast<Real>(rx) * t;
+    p->y = static_cast<Real>(Accessor::Y(a)) + static_cast<Real>(ry) * t;
+    if (tNum == 0 || tNum == denom || uNum == 0 || uNum == denom) {
+        return kCrossVertex;
+    }
+    return kCrossProper;
+}
+
+template <class Real, class Alloc>
+inline void appendRegionPoint(std::vector<HullPointT<Real>, Alloc> *out, Real x, Real y)
+{
+    if (!out->empty() && out->back().x == x && out->back().y == y) {
+        return;
+    }
+    out->push_back(MakeHullPoint(x, y));
+}
+
+// Closed containment, boundary counts as inside
+template <class Point, class Accessor>
+inline bool hullContainsClosed(const Point *hull, int n, const Point &p, Accessor get)
+{
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        if (orient(hull[j], hull[i], p, get) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Intersection polygon of the CCW convex polygons p and q, counter-clockwise
+// with no repeated points. Returns false when the overlap has no area.
+template <class Point, class Accessor, class Alloc>
+inline bool convexIntersection(const Point *p, int n, const Point *q, int m,
+    std::vector<HullPointT<typename ScalarTraits<typename Accessor::Coord>::Real>, Alloc> *out, Accessor get)
+{
+    typedef typename ScalarTraits<typename Accessor::Coord>::Wide Wide;
+    typedef typename ScalarTraits<typename Accessor::Coord>::Real Real;
+
+    out->clear();
+    if (n < 3 || m < 3) {
+        return false;
+    }
+
+    int a = 0;
+    int b = 0;
+    int aa = 0;
+    int ba = 0;
+    ConvexInside inside = kInsideUnknown;
+    do {
+        int a1 = (a + n - 1) % n;
+        int b1 = (b + m - 1) % m;
+        Wide ax = static_cast<Wide>(Accessor::X(p[a])) - Accessor::X(p[a1]);
+        Wide ay = static_cast<Wide>(Accessor::Y(p[a])) - Accessor::Y(p[a1]);
+        Wide bx = static_cast<Wide>(Accessor::X(q[b])) - Accessor::X(q[b1]);
+        Wide by = static_cast<Wide>(Accessor::Y(q[b])) - Accessor::Y(q[b1]);
+        int turn = wideSign(ax * by - ay * bx);
+        int aHB = wideSign(orient(q[b1], q[b], p[a], get));
+        int bHA = wideSign(orient(p[a1], p[a], q[b], get));
+
+        HullPointT<Real> hit;
+        SegmentCrossing code = segmentCrossing(p[a1], p[a], q[b1], q[b], &hit, get);
+        if (code == kCrossProper || code == kCrossVertex) {
+            // Count a full lap of both polygons from the first crossing
+            if (inside == kInsideUnknown && out->empty()) {
+                aa = 0;
+                ba = 0;
+            }
+            appendRegionPoint(out, hit.x, hit.y);
+            if (aHB > 0) {
+                inside = kInsideP;
+            }
+            else if (bHA > 0) {
+                inside = kInsideQ;
+            }
+        }
+
+        // Edges overlap head to head, the polygons only share that segment
+        if (code == kCrossOverlap && ax * bx + ay * by < 0) {
+            out->clear();
+            return false;
+        }
+        // Parallel and separated
+        if (code == kCrossNone && turn == 0 && aHB < 0 && bHA < 0) {
+            out->clear();
+            return false;
+        }
+
+        bool advanceA;
+        if (turn == 0 && aHB == 0 && bHA == 0) {
+            // Collinear, advance the one that is not inside
+            advanceA = inside != kInsideP;
+        }
+        else if (turn >= 0) {
+            advanceA = bHA > 0;
+        }
+        else {
+            advanceA = aHB <= 0;
+        }
+
+        if (advanceA) {
+            if (inside == kInsideP) {
+                appendRegionPoint(out, static_cast<Real>(Accessor::X(p[a])), static_cast<Real>(Accessor::Y(p[a])));
+            }
+            aa++;
+            a = (a + 1) % n;
+        }
+        else {
+            if (inside == kInsideQ) {
+                appendRegionPoint(out, static_cast<Real>(Accessor::X(q[b])), static_cast<Real>(Accessor::Y(q[b])));
+            }
+            ba++;
+            b = (b + 1) % m;
+        }
+    } while ((aa < n || ba < m) && aa < 2 * n && ba < 2 * m);
+
+    if (inside == kInsideUnknown) {
+        // No crossing: one polygon holds the other, or they are apart
+        out->clear();
+        const Point *inner = NULL;
+        int count = 0;
+        if (hullContainsClosed(q, m, p[0], get)) {
+            inner = p;
+            count = n;
+        }
+        else if (hullContainsClosed(p, n, q[0], get)) {
+            inner = q;
+            count = m;
+        }
+        for (int i = 0; i < count; i++) {
+            out->push_back(MakeHullPoint(static_cast<Real>(Accessor::X(inner[i])), static_cast<Real>(Accessor::Y(inner[i]))));
+        }
+    }
+
+    // The walk closes on the point it started from
+    while (out->size() > 1 && out->back().x == out->front().x && out->back().y == out->front().y) {
+        out->pop_back();
+    }
+    if (out->size() < 3) {
+        out->clear();
+        return false;
+    }
+    return true;
+}
+
+template <class Scalar, class Alloc>
+inline bool convexIntersection(const HullPointT<Scalar> *p, int n, const HullPointT<Scalar> *q, int m,
+    std::vector<HullPointT<typename ScalarTraits<Scalar>::Real>, Alloc> *out)
+{
+    return convexIntersection(p, n, q, m, out, HullPointAccessor<Scalar>());
+}
+
+// Signed area and centroid of a simple polygon, accumulated in double
+template <class Real>
+inline Real polygonAreaCentroid(const HullPointT<Real> *poly, int n, HullPointT<Real> *centroid)
+{
+    double area = 0.0;
+    double cx = 0.0;
+    double cy = 0.0;
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        double w = static_cast<double>(poly[j].x) * poly[i].y - static_cast<double>(poly[i].x) * poly[j].y;
+        area += w;
+        cx += (static_cast<double>(poly[j].x) + poly[i].x) * w;
+        cy += (static_cast<double>(poly[j].y) + poly[i].y) * w;
+    }
+    area *= 0.5;
+    if (area != 0.0) {
+        centroid->x = static_cast<Real>(cx / (6.0 * area));
+        centroid->y = static_cast<Real>(cy / (6.0 * area));
+    }
+    else {
+        centroid->x = centroid->y = 0;
+    }
+    return static_cast<Real>(area);
+}
+
+// One polygon against many. Shape i of the batch is
+// points[first[i], first[i] + count[i]); its overlap area and centroid go to
+// area[i] and centroid[i] (zero when the shapes do not overlap). A bounding
+// box test skips most non-overlapping shapes before the edge walk.
+template <class Point, class Accessor>
+inline void convexIntersectionBatch(const Point *p, int n, const Point *points, const int *first, const int *count, int shapes,
+    typename ScalarTraits<typename Accessor::Coord>::Real *area,
+    HullPointT<typename ScalarTraits<typename Accessor::Coord>::Real> *centroid, Accessor get)
+{
+    typedef typename Accessor::Coord Scalar;
+    typedef typename ScalarTraits<Scalar>::Real Real;
+
+    if (n <= 0) {
+        for (int s = 0; s < shapes; s++) {
+            area[s] = 0;
+            centroid[s] = MakeHullPoint<Real>(0, 0);
+        }
+        return;
+    }
+
+    Scalar minX = Accessor::X(p[0]), maxX = minX;
+    Scalar minY = Accessor::Y(p[0]), maxY = minY;
+    for (int i = 1; i < n; i++) {
+        minX = Accessor::X(p[i]) < minX ? Accessor::X(p[i]) : minX;
+        maxX = Accessor::X(p[i]) > maxX ? Accessor::X(p[i]) : maxX;
+        minY = Accessor::Y(p[i]) < minY ? Accessor::Y(p[i]) : minY;
+        maxY = Accessor::Y(p[i]) > maxY ? Accessor::Y(p[i]) : maxY;
+    }
+
+    GeometryVector<HullPointT<Real> > region;
+    for (int s = 0; s < shapes; s++) {
+        area[s] = 0;
+        centroid[s] = MakeHullPoint<Real>(0, 0);
+
+        const Point *q = points + first[s];
+        int m = count[s];
+        bool apart = m <= 0;
+        if (!apart) {
+            Scalar qMinX = Accessor::X(q[0]), qMaxX = qMinX;
+            Scalar qMinY = Accessor::Y(q[0]), qMaxY = qMinY;
+            for (int i = 1; i < m; i++) {
+                qMinX = Accessor::X(q[i]) < qMinX ? Accessor::X(q[i]) : qMinX;
+                qMaxX = Accessor::X(q[i]) > qMaxX ? Accessor::X(q[i]) : qMaxX;
+                qMinY = Accessor::Y(q[i]) < qMinY ? Accessor::Y(q[i]) : qMinY;
+                qMaxY = Accessor::Y(q[i]) > qMaxY ? Accessor::Y(q[i]) : qMaxY;
+            }
+            apart = qMaxX < minX || qMinX > maxX || qMaxY < minY || qMinY > maxY;
+        }
+        if (apart) {
+            continue;
+        }
+
+        if (convexIntersection(p, n, q, m, &region, get)) {
+            area[s] = polygonAreaCentroid(&region[0], static_cast<int>(region.size()), &centroid[s]);
+        }
+    }
+}
+
+template <class Scalar>
+inline void convexIntersectionBatch(const HullPointT<Scalar> *p, int n, const HullPointT<Scalar> *points, const int *first, const int *count, int shapes,
+    typename ScalarTraits<Scalar>::Real *area, HullPointT<typename ScalarTraits<Scalar>::Real> *centroid)
+{
+    convexIntersectionBatch(p, n, points, first, count, shapes, area, centroid, HullPointAccessor<Scalar>());
+}
+
+#endif
@@ -2,14 +2,25 @@
 #include <Windowsx.h>
 #include <d2d1.h>
 
-#include <list>
+#include <cmath>
 #include <memory>
+#include <vector>
 using namespace std;
 
 #pragma comment(lib, "d2d1")
 
 #include "basewin.h"
 #include "resource.h"
+#include "allocaccount.h"
+#include "calipers.h"
+#include "hull2d.h"
+#include "inputtrace.h"
+#include "narrowphase.h"
+#include "recompute.h"
+#include "scenemodel.h"
+#include "scenesnapshot.h"
+#include "stageprofile.h"
+#include "workload.h"
 
 template <class T> void SafeRelease(T **ppT)
 {
@@ -50,12 +61,17 @@ public:
 float DPIScale::scaleX = 1.0f;
 float DPIScale::scaleY = 1.0f;
 
+const char kScenePath[] = "scene.snap";
+const char kTracePath[] = "input.trace";
+const char kProfilePath[] = "profile.json";
+const char kAllocationsPath[] = "allocations.json";
+const UINT_PTR kRecomputeTimer = 1;
+
 struct MyEllipse
 {
     D2D1_ELLIPSE    ellipse;
     D2D1_COLOR_F    color;
     int             group;
-           
 
     void Draw(ID2D1RenderTarget *pRT, ID2D1SolidColorBrush *pBrush)
     {
@@ -64,25 +80,36 @@ struct MyEllipse
         pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Black));
         pRT->DrawEllipse(ellipse, pBrush, 1.0f);
     }
+};
 
-    void ChangeColor(D2D1_COLOR_F newColor) {
-        color = newColor;
-    }
+// World-to-view transform of the model's view. Zoom and pan only change
+// this, the points stay in world space and are mapped at draw time by the
+// render target.
+struct ViewTransform
+{
+    float           scale;
+    D2D1_POINT_2F   pan;        // View space translation
+    D2D1_POINT_2F   center;     // World space zoom pivot
 
-    BOOL HitTest(float x, float y)
+    void Set(const SceneView &v)
     {
-        const float a = ellipse.radiusX;
-        const float b = ellipse.radiusY;
-        const float x1 = x - ellipse.point.x;
-        const float y1 = y - ellipse.point.y;
-        const float d = ((x1 * x1) / (a * a)) + ((y1 * y1) / (b * b));
-        return d <= 1.0f;
+        scale = v.scale;
+        pan = D2D1::Point2F(v.panX, v.panY);
+        center = D2D1::Point2F(v.pivotX, v.pivotY);
     }
-};
 
-// Global Variables
-shared_ptr<MyEllipse> innerPoint; // Point inside convex hull
+    D2D1::Matrix3x2F Matrix() const
+    {
+        return D2D1::Matrix3x2F::Scale(scale, scale, center) * D2D1::Matrix3x2F::Translation(pan.x, pan.y);
+    }
 
+    D2D1_POINT_2F WorldToView(D2D1_POINT_2F p) const
+    {
+        return D2D1::Point2F(
+            (p.x - center.x) * scale + center.x + pan.x,
+            (p.y - center.y) * scale + center.y + pan.y);
+    }
+};
 
 class MainWindow : public BaseWindow<MainWindow>
 {
@@ -92,59 +119,41 @@ class MainWindow : public BaseWindow<MainWindow>
         DragMode
     };
 
-    enum Screen
-    {
-        MinkowskiSum,
-        MinkowskiDifference,
-        GJK,
-        QuickHull,
-        PointConvexHull
-    };
-
     HCURSOR                 hCursor;
 
     ID2D1Factory            *pFactory;
     ID2D1HwndRenderTarget   *pRenderTarget;
     ID2D1SolidColorBrush    *pBrush;
-    D2D1_POINT_2F           ptMouse;
 
     Mode                    mode;
-    Screen                  screen;
-    size_t                  nextColor;
- 
-
-    list<shared_ptr<MyEllipse>>             ellipses;
-    list<shared_ptr<MyEllipse>>::iterator   selection;
-
-    list<shared_ptr<MyEllipse>>             hull1;
-    list<shared_ptr<MyEllipse>>             hull2;
-    list<shared_ptr<MyEllipse>>             group1;
-    list<shared_ptr<MyEllipse>>             group2;
-    int                                     group;
-
-    float                                   scale;
-    float                                   centerX;
-    float                                   centerY;
-    MyEllipse                               orgin;
-     
-    shared_ptr<MyEllipse> Selection() 
-    { 
-        if (selection == ellipses.end()) 
-        { 
-            return nullptr;
-        }
-        else
-        {
-            return (*selection);
-        }
-    }
 
-    void    ClearSelection() { selection = ellipses.end(); }
-    HRESULT InsertEllipse(float x, float y, float radius, D2D1::ColorF color, int group);
+    // The points, the cached hulls and everything computed from them. Input
+    // is forwarded to it and OnPaint draws its results, so the window runs
+    // the same code a replay does.
+    SceneModel                              model;
+
+    // The model's view, taken at the start of each paint
+    ViewTransform                           view;
+
+    // Writes scene snapshots in the background, F5 to save and F9 to restore
+    SceneSaver                              saver;
+
+    // Workload the buttons seed scenes from: R steps the seed, D the
+    // distribution, + and - scale the point counts by ten
+    WorkloadDistribution                    sceneDistribution;
+    uint64_t                                sceneSeed;
+    int                                     sceneScale;
+
+    // F8 starts and stops recording input to kTracePath for headless replay
+    InputTraceWriter                        trace;
+
+    // Paces rebuilding the caches after edits to once per display frame;
+    // until then the model keeps its hulls and the last result is drawn
+    RecomputeScheduler                      recompute;
+
+    void    EditScene() { if (model.TakeEdits()) { recompute.Edit(recomputeClock()); } }
 
-    BOOL    HitTest(float x, float y);
     void    SetMode(Mode m);
-    void    MoveSelection(float x, float y);
     HRESULT CreateGraphicsResources();
     void    DiscardGraphicsResources();
     void    OnPaint();
@@ -154,28 +163,35 @@ class MainWindow : public BaseWindow<MainWindow>
     void    OnMouseMove(int pixelX, int pixelY, DWORD flags);
     void    OnKeyDown(UINT vkey);
     void    OnMouseWheel(int n);
+    D2D1_POINT_2F GroupOffset(int g);
+    D2D1_POINT_2F MinkowskiOffset();
+    void    SetGroupTransform(D2D1_POINT_2F offset);
+    void    DrawPoint(const ScenePoint &p, D2D1_COLOR_F color);
+    void    DrawHull(const GeometryVector<ScenePoint> &hull, D2D1_POINT_2F offset, D2D1_COLOR_F color, bool vertices);
     void    CreateButtons();
+    void    NewScene(SceneScreen screen, SceneSnapshot *scene, int *width, int *height);
+    void    SeedGroup(SceneSnapshot *scene, int group, float left, float top, float right, float bottom, int count, float radius, D2D1::ColorF color);
+    void    ReseedScreen();
+    bool    RestoreScene(const SceneSnapshot &scene);
+    void    SaveScene();
+    void    LoadScene();
+    void    TraceScene();
+    void    ToggleTrace();
     void    QuickHullButton();
     void    MinkowskiSumButton();
     void    MinkowskiDifferenceButton();
     void    PointConvexHullButton();
     void    GJKButton();
-    void    QuickHullAlgorithm(list<shared_ptr<MyEllipse>> ellipses, int n, list<shared_ptr<MyEllipse>> *hull);
-    void    MinkowskiSumAlgorithm(list<shared_ptr<MyEllipse>> group1, list<shared_ptr<MyEllipse>> group2, list<shared_ptr<MyEllipse>>* hull);
-    void    MinkowskiDifferenceAlgorithm(list<shared_ptr<MyEllipse>> group1, list<shared_ptr<MyEllipse>> group2, list<shared_ptr<MyEllipse>>* hull);
-    void    PointConvexHullAlgorithm(list<shared_ptr<MyEllipse>> ellipses);
-    void    GJKAlgorithm(list<shared_ptr<MyEllipse>> ellipses);
     void    QuickHullDraw();
-    void    MinkowskiSumDraw();
-    void    MinkowskiDifferenceDraw();
+    void    MinkowskiDraw();
     void    PointConvexHullDraw();
     void    GJKDraw();
 
 
 public:
 
-    MainWindow() : pFactory(NULL), pRenderTarget(NULL), pBrush(NULL), 
-        ptMouse(D2D1::Point2F()), nextColor(0), selection(ellipses.end())
+    MainWindow() : pFactory(NULL), pRenderTarget(NULL), pBrush(NULL), saver(kScenePath),
+        sceneDistribution(UniformSquare), sceneSeed(kWorkloadSeed), sceneScale(1)
     {
     }
 
@@ -213,16 +229,6 @@ void MainWindow::DiscardGraphicsResources()
     SafeRelease(&pBrush);
 }
 
-bool AngleComparison(shared_ptr<MyEllipse> p1, shared_ptr<MyEllipse> p2) {
-    double p1x = p1->ellipse.point.x;
-    double p2x = p2->ellipse.point.x;
-    double p1y = p1->ellipse.point.y;
-    double p2y = p2->ellipse.point.y;
-    double angle1 = atan2(p1y - innerPoint->ellipse.point.y, p1x - innerPoint->ellipse.point.x);
-    double angle2 = atan2(p2y - innerPoint->ellipse.point.y, p2x - innerPoint->ellipse.point.x);
-    return (angle1 < angle2);
-}
-
 void MainWindow::OnPaint()
 {
     HRESULT hr = CreateGraphicsResources();
@@ -230,88 +236,120 @@ void MainWindow::OnPaint()
     {
         PAINTSTRUCT ps;
         BeginPaint(m_hwnd, &ps);
+        STAGE_SCOPE(paint, StagePaint, model.PointCount());
+        view.Set(model.View());
      
         pRenderTarget->BeginDraw();
 
+        pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
         pRenderTarget->Clear( D2D1::ColorF(D2D1::ColorF::SkyBlue));
 
-        // Draw a grid background.
-        RECT rect;
-        GetWindowRect(m_hwnd, &rect);
-        int width = static_cast<int>(rect.right - rect.left);
-        int height = static_cast<int>(rect.bottom - rect.top);
-
-        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::DarkGray));
-        for (int x = 220; x < width; x += (20*scale))
-        { 
-                pRenderTarget->DrawLine(
-                    D2D1::Point2F(static_cast<FLOAT>(x), 0.0f),
-                    D2D1::Point2F(static_cast<FLOAT>(x), rect.bottom),
-                    pBrush,
-                    0.5f
-                );
+        // Draw a grid background in view space, aligned to the origin axes
+        {
+            STAGE_SCOPE(grid, StageGrid, 0);
+            RECT rect;
+            GetWindowRect(m_hwnd, &rect);
+            int width = static_cast<int>(rect.right - rect.left);
+            int height = static_cast<int>(rect.bottom - rect.top);
+            const float spacing = 20 * view.scale;
+            const D2D1_POINT_2F axes = view.WorldToView(D2D1::Point2F(model.CenterX(), model.CenterY()));
+
+            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::DarkGray));
+            for (float x = 220 + fmodf(fmodf(axes.x - 220, spacing) + spacing, spacing); x < width; x += spacing)
+            { 
+                    pRenderTarget->DrawLine(
+                        D2D1::Point2F(x, 0.0f),
+                        D2D1::Point2F(x, rect.bottom),
+                        pBrush,
+                        0.5f
+                    );
           
-        }
+            }
        
-        for (int y = 0; y < height; y += (20*scale))
-        {
+            for (float y = fmodf(fmodf(axes.y, spacing) + spacing, spacing); y < height; y += spacing)
+            {
+                    pRenderTarget->DrawLine(
+                        D2D1::Point2F(220.0f, y),
+                        D2D1::Point2F(rect.right, y),
+                        pBrush,
+                        0.5f
+                    );
+            
+            }
                 pRenderTarget->DrawLine(
-                    D2D1::Point2F(220.0f, static_cast<FLOAT>(y)),
-                    D2D1::Point2F(rect.right, static_cast<FLOAT>(y)),
+                    D2D1::Point2F(axes.x, 0.0f),
+                    D2D1::Point2F(axes.x, rect.bottom),
                     pBrush,
-                    0.5f
+                    5.0f
+                 );
+                pRenderTarget->DrawLine(
+                    D2D1::Point2F(220.0f, axes.y),
+                    D2D1::Point2F(rect.right, axes.y),
+                    pBrush,
+                    5.0f
                 );
-            
         }
-            pRenderTarget->DrawLine(
-                D2D1::Point2F(static_cast<FLOAT>(centerX), 0.0f),
-                D2D1::Point2F(static_cast<FLOAT>(centerX), rect.bottom),
-                pBrush,
-                5.0f
-             );
-            pRenderTarget->DrawLine(
-                D2D1::Point2F(220.0f, static_cast<FLOAT>(centerY)),
-                D2D1::Point2F(rect.right, static_cast<FLOAT>(centerY)),
-                pBrush,
-                5.0f
-            );
-            //centerY = height/2 - ((height/2)%20y;
-        
-        for (auto i = ellipses.begin(); i != ellipses.end(); ++i)
+
+        // Everything below is drawn in world coordinates
         {
-            // Redraw Circles
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Black));
-            if ((*i)->group == 1)
-                (*i)->ChangeColor(D2D1::ColorF(D2D1::ColorF::Red));
-            else if ((*i)->group == 2)
-                (*i)->ChangeColor(D2D1::ColorF(D2D1::ColorF::Blue));
-            (*i)->Draw(pRenderTarget, pBrush);
+            STAGE_SCOPE(drawPoints, StageDrawPoints, model.PointCount());
+            const GeometryVector<ScenePoint> &points = model.Points();
+            int drawnGroup = -1;
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                if (points[i].group != drawnGroup) {
+                    drawnGroup = points[i].group;
+                    SetGroupTransform(GroupOffset(drawnGroup));
+                }
+
+                // Groups 1 and 2 are always red and blue
+                if (points[i].group == 1)
+                    DrawPoint(points[i], D2D1::ColorF(D2D1::ColorF::Red));
+                else if (points[i].group == 2)
+                    DrawPoint(points[i], D2D1::ColorF(D2D1::ColorF::Blue));
+                else
+                    DrawPoint(points[i], D2D1::ColorF(points[i].r, points[i].g, points[i].b, points[i].a));
+            }
         }
 
-        // Determine algorithm to use to represent on screen
-        switch (screen) {
-        case QuickHull:
-            QuickHullDraw();
-            break;
-
-        case MinkowskiSum:
-            MinkowskiSumDraw();
-            break;
-
-        case MinkowskiDifference:
-            MinkowskiDifferenceDraw();
-            break;
-
-        case PointConvexHull:
-            PointConvexHullDraw();
-            break;
+        // Edits are rebuilt at the scheduler's next slot, and the last result
+        // is drawn until then with a timer set for the slot. A scene that was
+        // replaced is rebuilt at once.
+        const int64_t now = recomputeClock();
+        if (!model.Valid() || recompute.Due(now)) {
+            model.Invalidate();
+            recompute.Begin(now);
+        }
+        else if (recompute.Pending()) {
+            SetTimer(m_hwnd, kRecomputeTimer, static_cast<UINT>((recompute.Wait(now) + 999) / 1000), NULL);
+        }
 
-        case GJK:
-            GJKDraw();
-            break;
+        // Bring the model up to date and draw the current screen's result
+        {
+            STAGE_SCOPE(overlay, StageDrawOverlay, model.PointCount());
+            model.Update();
+            switch (model.Screen()) {
+            case SceneQuickHull:
+                QuickHullDraw();
+                break;
+
+            case SceneMinkowskiSum:
+            case SceneMinkowskiDifference:
+                MinkowskiDraw();
+                break;
+
+            case ScenePointConvexHull:
+                PointConvexHullDraw();
+                break;
+
+            case SceneGJK:
+                GJKDraw();
+                break;
 
+            }
         }
 
+        pRenderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
         hr = pRenderTarget->EndDraw();
         if (FAILED(hr) || hr == D2DERR_RECREATE_TARGET)
         {
@@ -323,524 +361,122 @@ void MainWindow::OnPaint()
 }
 
 void MainWindow::QuickHullDraw() {
-    hull1.clear();
-    shared_ptr<MyEllipse> prev;
-    QuickHullAlgorithm(ellipses, ellipses.size(), &hull1);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-    pRenderTarget->DrawLine(
-        hull1.front()->ellipse.point,
-        hull1.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull1.front();
-    for (auto i = hull1.begin(); i != hull1.end(); ++i)
-    {
-        // Redraw Convex hull circles
-        (*i)->ChangeColor(D2D1::ColorF(D2D1::ColorF::Blue));
-        (*i)->Draw(pRenderTarget, pBrush);
-
-        // Redraw lines of convex hull
-        if (i != hull1.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
+    DrawHull(model.Hull1(), GroupOffset(1), D2D1::ColorF(D2D1::ColorF::White), true);
+
+    // Tightest oriented box, found by rotating calipers
+    if (model.BoxValid()) {
+        HullPointT<HullReal> corners[4];
+        model.Box().Corners(corners);
+        SetGroupTransform(GroupOffset(1));
+        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Gray));
+        for (int k = 0, l = 3; k < 4; l = k++) {
             pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
+                D2D1::Point2F(fromHullReal(corners[l].x), fromHullReal(corners[l].y)),
+                D2D1::Point2F(fromHullReal(corners[k].x), fromHullReal(corners[k].y)),
                 pBrush,
-                3.0f
+                1.0f / view.scale
             );
         }
-        prev = *i;
     }
 }
 
-void MainWindow::MinkowskiSumDraw() {
-    
-    // Divide ellipses into two groups
-    group1.clear();
-    group2.clear();
-    hull1.clear();
-    hull2.clear();
-    list<shared_ptr<MyEllipse>> hull3;
-    list<shared_ptr<MyEllipse>> hull4;
-    shared_ptr<MyEllipse> prev;
-
-    for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-        if ((*i)->group == 1) {
-            group1.push_back(*i);
-        }
-        else if ((*i)->group == 2) {
-            group2.push_back(*i);
-        }
-    }
-
-    // Draw first set of convex hulls
-    QuickHullAlgorithm(group1, group1.size(), &hull1);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-    pRenderTarget->DrawLine(
-        hull1.front()->ellipse.point,
-        hull1.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull1.front();
-    for (auto i = hull1.begin(); i != hull1.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull1.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    // Draw second set of convex hulls
-    QuickHullAlgorithm(group2, group2.size(), &hull2);
-    pRenderTarget->DrawLine(
-        hull2.front()->ellipse.point,
-        hull2.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull2.front();
-    for (auto i = hull2.begin(); i != hull2.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull2.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    MinkowskiSumAlgorithm(hull1, hull2, &hull3);
-    QuickHullAlgorithm(hull3, hull3.size(), &hull4);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Red));
-    pRenderTarget->DrawLine(
-        hull4.front()->ellipse.point,
-        hull4.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull4.front();
-    for (auto i = hull4.begin(); i != hull4.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull4.begin()) {
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-}
-
-void MainWindow::MinkowskiDifferenceDraw() {
-    // Divide ellipses into two groups
-    group1.clear();
-    group2.clear();
-    hull1.clear();
-    hull2.clear();
-    list<shared_ptr<MyEllipse>> hull3;
-    list<shared_ptr<MyEllipse>> hull4;
-    shared_ptr<MyEllipse> prev;
-
-    for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-        if ((*i)->group == 1) {
-            group1.push_back(*i);
-        }
-        else if ((*i)->group == 2) {
-            group2.push_back(*i);
-        }
-    }
-
-    // Draw first set of convex hulls
-    QuickHullAlgorithm(group1, group1.size(), &hull1);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-    pRenderTarget->DrawLine(
-        hull1.front()->ellipse.point,
-        hull1.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull1.front();
-    for (auto i = hull1.begin(); i != hull1.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull1.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    // Draw second set of convex hulls
-    QuickHullAlgorithm(group2, group2.size(), &hull2);
-    pRenderTarget->DrawLine(
-        hull2.front()->ellipse.point,
-        hull2.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull2.front();
-    for (auto i = hull2.begin(); i != hull2.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull2.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    MinkowskiDifferenceAlgorithm(hull1, hull2, &hull3);
-    QuickHullAlgorithm(hull3, hull3.size(), &hull4);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Red));
-    pRenderTarget->DrawLine(
-        hull4.front()->ellipse.point,
-        hull4.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull4.front();
-    for (auto i = hull4.begin(); i != hull4.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull4.begin()) {
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-}
-
-// Returns the side of point p with respect to line joining p1 and p2
-int findSide(shared_ptr<MyEllipse> p1, shared_ptr<MyEllipse> p2, shared_ptr<MyEllipse> p) {
-    int val = (p->ellipse.point.y - p1->ellipse.point.y) * (p2->ellipse.point.x - p1->ellipse.point.x) -
-        (p2->ellipse.point.y - p1->ellipse.point.y) * (p->ellipse.point.x - p1->ellipse.point.x);
-
-    if (val > 0)
-        return 1;
-    if (val < 0)
-        return -1;
-    return 0;
-}
-
-// Retruns whether or not a point is within a convex hull
- bool convexHullContains(list<shared_ptr<MyEllipse>> hull, float x, float y) {
-    if (hull.empty()) {
-        return false;
-    }
-    shared_ptr<MyEllipse> prev = hull.front();
-    shared_ptr<MyEllipse> ellipse = shared_ptr<MyEllipse>(new MyEllipse());
-    ellipse->ellipse.point = D2D1::Point2F(x, y);
-    for (auto i = ++(hull.begin()); i != hull.end(); ++i) {
-        if (findSide(prev, *i, ellipse) <= 0) {
-            return false;
-        }
-        prev = *i;
-    }
-
-    if (findSide(hull.back(), hull.front(), ellipse) <= 0)
-        return false;
-
-    return true;
+// Both Minkowski screens draw the two hulls and the hull of their sum or
+// difference
+void MainWindow::MinkowskiDraw() {
+    DrawHull(model.Hull1(), GroupOffset(1), D2D1::ColorF(D2D1::ColorF::White), false);
+    DrawHull(model.Hull2(), GroupOffset(2), D2D1::ColorF(D2D1::ColorF::White), false);
+    DrawHull(model.Result(), MinkowskiOffset(), D2D1::ColorF(D2D1::ColorF::Red), false);
 }
 
 void MainWindow::PointConvexHullDraw() {
-    hull1.clear();
-    group1.clear();
-    for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-        if ((*i)->group == 1) {
-            group1.push_back(*i);
-        }
-    }
-    shared_ptr<MyEllipse> prev;
-    QuickHullAlgorithm(group1, group1.size() - 1, &hull1);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-    pRenderTarget->DrawLine(
-        hull1.front()->ellipse.point,
-        hull1.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull1.front();
-    for (auto i = hull1.begin(); i != hull1.end(); ++i)
-    {
-        // Redraw Convex hull circles
-        (*i)->ChangeColor(D2D1::ColorF(D2D1::ColorF::Blue));
-        (*i)->Draw(pRenderTarget, pBrush);
+    DrawHull(model.Hull1(), GroupOffset(1), D2D1::ColorF(D2D1::ColorF::White), true);
 
-        // Redraw lines of convex hull
-        if (i != hull1.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
+    // The last point is tested against the hull with both drag offsets applied
+    const GeometryVector<ScenePoint> &points = model.Points();
+    if (!points.empty()) {
+        SetGroupTransform(GroupOffset(points.back().group));
+        DrawPoint(points.back(), D2D1::ColorF(model.Inside() ? D2D1::ColorF::Red : D2D1::ColorF::Blue));
     }
-    if (convexHullContains(hull1, ellipses.back()->ellipse.point.x, ellipses.back()->ellipse.point.y))
-        ellipses.back()->ChangeColor(D2D1::ColorF(D2D1::ColorF::Red));
-    else
-        ellipses.back()->ChangeColor(D2D1::ColorF(D2D1::ColorF::Blue));
-    ellipses.back()->Draw(pRenderTarget, pBrush);
 }
 
 void MainWindow::GJKDraw() {
-    // Divide ellipses into two groups
-    group1.clear();
-    group2.clear();
-    hull1.clear();
-    hull2.clear();
-    list<shared_ptr<MyEllipse>> hull3;
-    list<shared_ptr<MyEllipse>> hull4;
-    shared_ptr<MyEllipse> prev;
-
-    for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-        if ((*i)->group == 1) {
-            group1.push_back(*i);
-        }
-        else if ((*i)->group == 2) {
-            group2.push_back(*i);
-        }
-    }
-
-    // Draw first set of convex hulls
-    QuickHullAlgorithm(group1, group1.size(), &hull1);
-    pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-    pRenderTarget->DrawLine(
-        hull1.front()->ellipse.point,
-        hull1.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull1.front();
-    for (auto i = hull1.begin(); i != hull1.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull1.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    // Draw second set of convex hulls
-    QuickHullAlgorithm(group2, group2.size(), &hull2);
-    pRenderTarget->DrawLine(
-        hull2.front()->ellipse.point,
-        hull2.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull2.front();
-    for (auto i = hull2.begin(); i != hull2.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull2.begin()) {
-            pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::White));
-            pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
-                pBrush,
-                3.0f
-            );
-        }
-        prev = *i;
-    }
-
-    MinkowskiDifferenceAlgorithm(hull1, hull2, &hull3);
-    QuickHullAlgorithm(hull3, hull3.size(), &hull4);
-
-    if (convexHullContains(hull4, centerX, centerY))
-        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Green));
-    else
-        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Red));
-
-    pRenderTarget->DrawLine(
-        hull4.front()->ellipse.point,
-        hull4.back()->ellipse.point,
-        pBrush,
-        3.0f
-    );
-    prev = hull4.front();
-    for (auto i = hull4.begin(); i != hull4.end(); ++i)
-    {
-        // Redraw lines of convex hull
-        if (i != hull4.begin()) {
+    DrawHull(model.Hull1(), GroupOffset(1), D2D1::ColorF(D2D1::ColorF::White), false);
+    DrawHull(model.Hull2(), GroupOffset(2), D2D1::ColorF(D2D1::ColorF::White), false);
+
+    // The groups overlap when the difference holds the origin
+    DrawHull(model.Result(), MinkowskiOffset(), D2D1::ColorF(model.Inside() ? D2D1::ColorF::Green : D2D1::ColorF::Red), false);
+
+    // Last swept contact, with its normal from group 1 towards group 2
+    if (model.ImpactValid()) {
+        const Vec2 &point = model.Impact().point;
+        const Vec2 &normal = model.Impact().normal;
+        SetGroupTransform(D2D1::Point2F());
+        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Orange));
+        pRenderTarget->FillEllipse(D2D1::Ellipse(D2D1::Point2F(point.x, point.y), 4.0f / view.scale, 4.0f / view.scale), pBrush);
+        pRenderTarget->DrawLine(
+            D2D1::Point2F(point.x, point.y),
+            D2D1::Point2F(point.x + normal.x * 30.0f / view.scale, point.y + normal.y * 30.0f / view.scale),
+            pBrush,
+            2.0f / view.scale
+        );
+    }
+
+    // Outline the region the two groups share, in group 1's frame
+    const GeometryVector<HullPointT<HullReal>> &region = model.Region();
+    if (!region.empty()) {
+        SetGroupTransform(GroupOffset(1));
+        pBrush->SetColor(D2D1::ColorF(D2D1::ColorF::Yellow));
+        for (size_t i = 0, j = region.size() - 1; i < region.size(); j = i++) {
             pRenderTarget->DrawLine(
-                prev->ellipse.point,
-                (*i)->ellipse.point,
+                D2D1::Point2F(fromHullReal(region[j].x), fromHullReal(region[j].y)),
+                D2D1::Point2F(fromHullReal(region[i].x), fromHullReal(region[i].y)),
                 pBrush,
-                3.0f
+                3.0f / view.scale
             );
         }
-        prev = *i;
     }
-    
 }
 
-int lineDist(shared_ptr<MyEllipse> p1, shared_ptr<MyEllipse> p2, shared_ptr<MyEllipse> p) {
-    return abs((p->ellipse.point.y - p1->ellipse.point.y) * (p2->ellipse.point.x - p1->ellipse.point.x) -
-        (p2->ellipse.point.y - p1->ellipse.point.y) * (p->ellipse.point.x - p1->ellipse.point.x));
+D2D1_POINT_2F MainWindow::GroupOffset(int g) {
+    return D2D1::Point2F(model.OffsetX(g), model.OffsetY(g));
 }
 
-shared_ptr<MyEllipse> getValue(list<shared_ptr<MyEllipse>> ellipses, int n) {
-    if (ellipses.empty() || n < 0 || n >= ellipses.size()) {
-        return nullptr;
-    }
-    list<shared_ptr<MyEllipse>>::iterator it = ellipses.begin();
-    advance(it, n);
-    return *it;
+D2D1_POINT_2F MainWindow::MinkowskiOffset() {
+    D2D1_POINT_2F offset;
+    model.MinkowskiOffset(&offset.x, &offset.y);
+    return offset;
 }
 
-bool Contains(list<shared_ptr<MyEllipse>> a, shared_ptr<MyEllipse> ellipse) {
-    for (auto i = a.begin(); i != a.end(); ++i) {
-        if (*i == ellipse) {
-            return true;
-        }
-    }
-    return false;
+void MainWindow::SetGroupTransform(D2D1_POINT_2F offset) {
+    pRenderTarget->SetTransform(D2D1::Matrix3x2F::Translation(offset.x, offset.y) * view.Matrix());
 }
 
-void quickHull(list<shared_ptr<MyEllipse>> a, int n, shared_ptr<MyEllipse> p1, shared_ptr<MyEllipse> p2, int side, list<shared_ptr<MyEllipse>> *hull) {
-    int ind = -1;
-    int max_dist = 0;
-
-    // find point with max distance from line and also with side of line
-    for (int i = 0; i < n; i++) {
-        int temp = lineDist(p1, p2, getValue(a, i));
-        if (findSide(p1, p2, getValue(a, i)) == side && temp > max_dist) {
-            ind = i;
-            max_dist = temp;
-        }
-    }
-
-    // If not point is found, add end of line to convex hull
-    if (ind == -1) {
-        if (!Contains(*hull, p1))
-            hull->push_back(p1);
-        if (!Contains(*hull, p2))
-            hull->push_back(p2);
-        return;
-    }
-
-    quickHull(a, n, getValue(a, ind), p1, -findSide(getValue(a, ind), p1, p2), hull);
-    quickHull(a, n, getValue(a, ind), p2, -findSide(getValue(a, ind), p2, p1), hull);
-
+void MainWindow::DrawPoint(const ScenePoint &p, D2D1_COLOR_F color) {
+    MyEllipse ellipse = { D2D1::Ellipse(D2D1::Point2F(p.x, p.y), p.radius, p.radius), color, p.group };
+    ellipse.Draw(pRenderTarget, pBrush);
 }
 
-// Algorithm implementations
-void MainWindow::QuickHullAlgorithm(list<shared_ptr<MyEllipse>> a, int n, list<shared_ptr<MyEllipse>> *hull) {
-    if (n < 3) {
+// Outline a closed hull at the given offset, drawing its vertices in blue
+// over the points if asked
+void MainWindow::DrawHull(const GeometryVector<ScenePoint> &hull, D2D1_POINT_2F offset, D2D1_COLOR_F color, bool vertices) {
+    if (hull.empty()) {
         return;
     }
-
-    // Finding point with min and max x coordinate
-    int min_x = 0;
-    int max_x = 0;
-    for (int i = 1; i < n; i++) {
-        if (getValue(a, i)->ellipse.point.x < getValue(a, min_x)->ellipse.point.x) {
-            min_x = i;
-        }
-        if (getValue(a, i)->ellipse.point.x > getValue(a, max_x)->ellipse.point.x) {
-            max_x = i;
-        }
-    }
-
-    // Recursively find convex hull points of both sides of line joining a[min_x] and a[max_x]
-    quickHull(a, n, getValue(a, min_x), getValue(a, max_x), 1, hull);
-    quickHull(a, n, getValue(a, min_x), getValue(a, max_x), -1, hull);
-
-    innerPoint = hull->front();
-    for (auto i = ++(hull->begin()); i != hull->end(); ++i) {
-        if ((*i)->ellipse.point.y > innerPoint->ellipse.point.y) {
-            innerPoint = *i;
-        }
-        else if ((*i)->ellipse.point.y == innerPoint->ellipse.point.y) {
-            if ((*i)->ellipse.point.x < innerPoint->ellipse.point.x) {
-                innerPoint = *i;
-            }
-        }
-    }
-    hull->sort(AngleComparison);
-}
-
-
-void MainWindow::MinkowskiSumAlgorithm(list<shared_ptr<MyEllipse>> group1, list<shared_ptr<MyEllipse>> group2, list<shared_ptr<MyEllipse>> *hull) {
-    for (auto i = group1.begin(); i != group1.end(); ++i) {
-        for (auto j = group2.begin(); j != group2.end(); ++j) {
-            shared_ptr<MyEllipse> ellipse = *(hull->insert(
-                hull->end(),
-                shared_ptr<MyEllipse>(new MyEllipse())));
-
-            ellipse->ellipse.point = D2D1::Point2F((float)((*i)->ellipse.point.x) + (float)((*j)->ellipse.point.x) - centerX, (float)((*i)->ellipse.point.y) + (float)((*j)->ellipse.point.y) - centerY);
-            ellipse->ellipse.radiusX = ellipse->ellipse.radiusY = 0.0f;
-            ellipse->color = D2D1::ColorF(D2D1::ColorF::Black);
-            ellipse->group = 3;
-        }
-    }
-}
-
-void MainWindow::MinkowskiDifferenceAlgorithm(list<shared_ptr<MyEllipse>> group1, list<shared_ptr<MyEllipse>> group2, list<shared_ptr<MyEllipse>>* hull) {
-    for (auto i = group1.begin(); i != group1.end(); ++i) {
-        for (auto j = group2.begin(); j != group2.end(); ++j) {
-            shared_ptr<MyEllipse> ellipse = *(hull->insert(
-                hull->end(),
-                shared_ptr<MyEllipse>(new MyEllipse())));
-
-            ellipse->ellipse.point = D2D1::Point2F((float)((*j)->ellipse.point.x) - (float)((*i)->ellipse.point.x) + centerX, (float)((*j)->ellipse.point.y) - (float)((*i)->ellipse.point.y) + centerY);
-            ellipse->ellipse.radiusX = ellipse->ellipse.radiusY = 0.0f;
-            ellipse->color = D2D1::ColorF(D2D1::ColorF::Black);
-            ellipse->group = 3;
+    SetGroupTransform(offset);
+    for (size_t i = 0, j = hull.size() - 1; i < hull.size(); j = i++) {
+        if (vertices) {
+            DrawPoint(hull[i], D2D1::ColorF(D2D1::ColorF::Blue));
         }
+        pBrush->SetColor(color);
+        pRenderTarget->DrawLine(
+            D2D1::Point2F(hull[j].x, hull[j].y),
+            D2D1::Point2F(hull[i].x, hull[i].y),
+            pBrush,
+            3.0f / view.scale
+        );
     }
 }
 
-void MainWindow::PointConvexHullAlgorithm(list<shared_ptr<MyEllipse>> ellipses) {
-    
-}
-
-void MainWindow::GJKAlgorithm(list<shared_ptr<MyEllipse>> ellipses) {
-
-}
-
 
 void MainWindow::Resize()
 {
@@ -862,76 +498,23 @@ void MainWindow::OnLButtonDown(int pixelX, int pixelY, DWORD flags)
     const float dipX = DPIScale::PixelsToDipsX(pixelX);
     const float dipY = DPIScale::PixelsToDipsY(pixelY);
 
-    /*
-    if (mode == DrawMode)
-    {
-        POINT pt = { pixelX, pixelY };
-
-        if (DragDetect(m_hwnd, pt))
-        {
-            SetCapture(m_hwnd);
-        
-            // Start a new ellipse.
-            InsertEllipse(dipX, dipY);
-        }
-    }
-    */
-        ClearSelection();
-
-        // Select a ellipse to move
-        if (HitTest(dipX, dipY))
-        {
-            SetCapture(m_hwnd);
-
-            ptMouse = Selection()->ellipse.point;
-            ptMouse.x -= dipX;
-            ptMouse.y -= dipY;
-
-            SetMode(DragMode);
-        }
-        else if (convexHullContains(hull1, pixelX, pixelY))
-        {
-            SetCapture(m_hwnd);
-              
-            if (screen == QuickHull)
-                group = 0;
-            else
-                group = 1;
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-
-            SetMode(DragMode);
-        }
-        else if (convexHullContains(hull2, pixelX, pixelY))
-        {
-            SetCapture(m_hwnd);
-
-            group = 2;
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
+    trace.Record(TracePick, dipX, dipY);
 
-            SetMode(DragMode);
-        }
-        else if (!convexHullContains(hull1, pixelX, pixelY)&& !convexHullContains(hull2, pixelX, pixelY)) {
-            SetCapture(m_hwnd);
-            group = 10;
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-
-            SetMode(DragMode);
-        }
+    // Select a point to move, or else start dragging the hull under the
+    // cursor or the view
+    model.Pick(dipX, dipY);
+    SetCapture(m_hwnd);
+    SetMode(DragMode);
 
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
 void MainWindow::OnLButtonUp()
 {
-    /*
-    if ((mode == DrawMode) && Selection())
-    {
-        ClearSelection();
-        InvalidateRect(m_hwnd, NULL, FALSE);
-    }
-    */
+    trace.Record(TraceRelease, 0.0f, 0.0f);
     if (mode == DragMode)
     {
+        model.Release();
         SetMode(SelectMode);
     }
     ReleaseCapture(); 
@@ -945,56 +528,12 @@ void MainWindow::OnMouseMove(int pixelX, int pixelY, DWORD flags)
 
     if ((flags & MK_LBUTTON))
     { 
-        if (Selection()) {
-            /*
-            if (mode == DrawMode)
-            {
-                // Resize the ellipse.
-                const float width = (dipX - ptMouse.x) / 2;
-                const float height = (dipY - ptMouse.y) / 2;
-                const float x1 = ptMouse.x + width;
-                const float y1 = ptMouse.y + height;
+        trace.Record(TraceDrag, dipX, dipY);
 
-                Selection()->ellipse = D2D1::Ellipse(D2D1::Point2F(x1, y1), width, height);
-            }
-            */
-            if (mode == DragMode)
-            {
-                // Move the ellipse.
-                Selection()->ellipse.point.x = dipX + ptMouse.x;
-                Selection()->ellipse.point.y = dipY + ptMouse.y;
-            }
-        }
-        else if (group == 0) {
-            for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-                (*i)->ellipse.point.x += pixelX - ptMouse.x;
-                (*i)->ellipse.point.y += pixelY - ptMouse.y;
-            }
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-        }
-        else if (group == 1) {
-            for (auto i = group1.begin(); i != group1.end(); ++i) {
-                (*i)->ellipse.point.x += pixelX - ptMouse.x;
-                (*i)->ellipse.point.y += pixelY - ptMouse.y;
-            }
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-        }
-        else if (group == 2) {
-            for (auto i = group2.begin(); i != group2.end(); ++i) {
-                (*i)->ellipse.point.x += pixelX - ptMouse.x;
-                (*i)->ellipse.point.y += pixelY - ptMouse.y;
-            }
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-        }
-        else if (group == 10){
-            centerX += pixelX - ptMouse.x;
-            centerY += pixelY - ptMouse.y;
-            for (auto i = ellipses.begin(); i != ellipses.end(); ++i) {
-                (*i)->ellipse.point.x += pixelX - ptMouse.x;
-                (*i)->ellipse.point.y += pixelY - ptMouse.y;
-            }
-            ptMouse = D2D1::Point2F(pixelX, pixelY);
-        }
+        // Moving a point is an edit; dragging a group or panning only moves
+        // the model's offsets and view
+        model.Drag(dipX, dipY);
+        EditScene();
         InvalidateRect(m_hwnd, NULL, FALSE);
     }
 }
@@ -1002,78 +541,67 @@ void MainWindow::OnMouseMove(int pixelX, int pixelY, DWORD flags)
 
 void MainWindow::OnKeyDown(UINT vkey)
 {
+    if (vkey != VK_F8 && vkey != VK_F7 && vkey != VK_F6) {
+        trace.Record(TraceKey, 0.0f, 0.0f, 0, vkey);
+    }
     switch (vkey)
     {
     case VK_BACK:
     case VK_DELETE:
-        if ((mode == SelectMode) && Selection())
-        {
-            ellipses.erase(selection);
-            ClearSelection();
-            SetMode(SelectMode);
-            InvalidateRect(m_hwnd, NULL, FALSE);
-        };
+    case VK_LEFT:
+    case VK_RIGHT:
+    case VK_UP:
+    case VK_DOWN:
+        model.Key(vkey);
+        EditScene();
+        InvalidateRect(m_hwnd, NULL, FALSE);
         break;
 
-    case VK_LEFT:
-        MoveSelection(-1, 0);
+    case VK_F5:
+        SaveScene();
         break;
 
-    case VK_RIGHT:
-        MoveSelection(1, 0);
+    case VK_F9:
+        LoadScene();
         break;
 
-    case VK_UP:
-        MoveSelection(0, -1);
+    case VK_F8:
+        ToggleTrace();
         break;
 
-    case VK_DOWN:
-        MoveSelection(0, 1);
+#ifdef GEOMETRY_PROFILE
+    case VK_F7:
+        writeChromeTrace(kProfilePath);
         break;
-    }
-}
+#endif
 
-HRESULT MainWindow::InsertEllipse(float x, float y, float radius, D2D1::ColorF color, int group)
-{
-    try
-    {
-        selection = ellipses.insert(
-            ellipses.end(), 
-            shared_ptr<MyEllipse>(new MyEllipse()));
-
-        Selection()->ellipse.point = ptMouse = D2D1::Point2F(x, y);
-        Selection()->ellipse.radiusX = Selection()->ellipse.radiusY = radius; 
-        Selection()->color = color;
-        Selection()->group = group;
-    }
-    catch (std::bad_alloc)
-    {
-        return E_OUTOFMEMORY;
-    }
-    return S_OK;
-}
+#ifdef GEOMETRY_ALLOC_ACCOUNTING
+    case VK_F6:
+        writeAllocations(kAllocationsPath);
+        break;
+#endif
 
+    case 'R':
+        sceneSeed++;
+        ReseedScreen();
+        break;
 
-BOOL MainWindow::HitTest(float x, float y)
-{
-    for (auto i = ellipses.rbegin(); i != ellipses.rend(); ++i)
-    {
-        if ((*i)->HitTest(x, y))
-        {
-            selection = (++i).base();
-            return TRUE;
-        }
-    }
-    return FALSE;
-}
+    case 'D':
+        sceneDistribution = static_cast<WorkloadDistribution>((sceneDistribution + 1) % WorkloadDistributionCount);
+        ReseedScreen();
+        break;
 
-void MainWindow::MoveSelection(float x, float y)
-{
-    if ((mode == SelectMode) && Selection())
-    {
-        Selection()->ellipse.point.x += x;
-        Selection()->ellipse.point.y += y;
-        InvalidateRect(m_hwnd, NULL, FALSE);
+    case VK_ADD:
+    case VK_OEM_PLUS:
+        sceneScale = sceneScale < 10000 ? sceneScale * 10 : sceneScale;
+        ReseedScreen();
+        break;
+
+    case VK_SUBTRACT:
+    case VK_OEM_MINUS:
+        sceneScale = sceneScale > 1 ? sceneScale / 10 : sceneScale;
+        ReseedScreen();
+        break;
     }
 }
 
@@ -1097,127 +625,189 @@ void MainWindow::SetMode(Mode m)
     SetCursor(hCursor);
 }
 
-// All button funtions clears all previous circles and creates new circles for given algorithm
-// Initializes circles for quick hull
-void MainWindow::QuickHullButton() {
+// Returns false, leaving the scene alone, if the snapshot names no screen
+bool MainWindow::RestoreScene(const SceneSnapshot &scene) {
+    if (scene.view.screen < SceneMinkowskiSum || scene.view.screen > ScenePointConvexHull) {
+        return false;
+    }
+    model.Load(scene);
+    InvalidateRect(m_hwnd, NULL, FALSE);
+    return true;
+}
+
+// Hands a copy of the scene to the saver thread and returns at once
+void MainWindow::SaveScene() {
+    SceneSnapshot scene;
+    model.Capture(&scene);
+    saver.Save(move(scene));
+}
+
+void MainWindow::LoadScene() {
+    saver.Flush();
+    SceneSnapshot scene;
+    if (loadScene(kScenePath, &scene)) {
+        RestoreScene(scene);
+        TraceScene();
+    }
+}
+
+// Record the scene that replaced the last one, so a replay starts from it
+void MainWindow::TraceScene() {
+    if (trace.Recording()) {
+        SceneSnapshot scene;
+        model.Capture(&scene);
+        trace.RecordScene(scene);
+    }
+}
+
+void MainWindow::ToggleTrace() {
+    if (trace.Recording()) {
+        trace.Close();
+    }
+    else if (trace.Open(kTracePath)) {
+        TraceScene();
+    }
+}
+
+// Starts an empty scene for the given screen, with its axes at the middle
+// of the drawing area, and returns the window's size
+void MainWindow::NewScene(SceneScreen screen, SceneSnapshot *scene, int *width, int *height) {
     RECT rect;
     GetWindowRect(m_hwnd, &rect);
-    screen = QuickHull;
-    ellipses.clear();
-    int width = static_cast<int>(rect.right - rect.left);
-    int height = static_cast<int>(rect.bottom - rect.top);
-    centerX = (width + 220) / 2 - (((width + 220) / 2) % 20);
-    centerY = height / 2 - ((height / 2) % 20);
-    for (int i = 0; i < 15; i++) {
-        float xcoord = rand() % (rect.right - rect.left - 300) + 250;
-        float ycoord = rand() % (rect.bottom - rect.top - 150) + 50;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 1);
+    *width = static_cast<int>(rect.right - rect.left);
+    *height = static_cast<int>(rect.bottom - rect.top);
+    scene->view.screen = screen;
+    scene->view.centerX = static_cast<float>((*width + 220) / 2 - (((*width + 220) / 2) % 20));
+    scene->view.centerY = static_cast<float>(*height / 2 - ((*height / 2) % 20));
+    scene->view.scale = 1.0f;
+    scene->view.panX = scene->view.panY = 0.0f;
+    scene->view.pivotX = scene->view.centerX;
+    scene->view.pivotY = scene->view.centerY;
+    scene->points.clear();
+    scene->hull1.clear();
+    scene->hull2.clear();
+    scene->derived.clear();
+    scene->cacheValid = false;
+}
+
+void addScenePoint(SceneSnapshot *scene, float x, float y, float radius, D2D1_COLOR_F color, int group) {
+    ScenePoint p = { x, y, radius, color.r, color.g, color.b, color.a, group };
+    scene->points.push_back(p);
+}
+
+// Adds count times sceneScale points of one group, drawn from the current
+// workload inside the given rectangle. The same seed always gives the same
+// scene, and each group gets its own stream of points.
+void MainWindow::SeedGroup(SceneSnapshot *scene, int group, float left, float top, float right, float bottom, int count, float radius, D2D1::ColorF color) {
+    WorkloadSpec spec = makeWorkload(sceneDistribution, static_cast<uint64_t>(count) * sceneScale, sceneSeed * 4 + group);
+    spec.minX = left;
+    spec.minY = top;
+    spec.maxX = right;
+    spec.maxY = bottom;
+    WorkloadGenerator generator(spec);
+    float xs[kWorkloadChunk];
+    float ys[kWorkloadChunk];
+    for (int n = generator.Next(xs, ys, NULL, kWorkloadChunk); n > 0; n = generator.Next(xs, ys, NULL, kWorkloadChunk)) {
+        for (int i = 0; i < n; i++) {
+            addScenePoint(scene, xs[i], ys[i], radius, color, group);
+        }
+    }
+}
+
+// Rebuild the current screen after the workload settings change
+void MainWindow::ReseedScreen() {
+    switch (model.Screen()) {
+    case SceneQuickHull:
+        QuickHullButton();
+        break;
+
+    case SceneMinkowskiSum:
+        MinkowskiSumButton();
+        break;
+
+    case SceneMinkowskiDifference:
+        MinkowskiDifferenceButton();
+        break;
+
+    case ScenePointConvexHull:
+        PointConvexHullButton();
+        break;
+
+    case SceneGJK:
+        GJKButton();
+        break;
     }
+    TraceScene();
+}
+
+// All button funtions replace the scene with new circles for given algorithm
+// Initializes circles for quick hull
+void MainWindow::QuickHullButton() {
+    SceneSnapshot scene;
+    int width, height;
+    NewScene(SceneQuickHull, &scene, &width, &height);
+    SeedGroup(&scene, 1, 250.0f, 50.0f, 250.0f + (width - 300), 50.0f + (height - 150), 15, 10.0f, D2D1::ColorF(D2D1::ColorF::Red));
+    model.Load(scene);
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
 // Initializes circles for Minkowski Sum
 void MainWindow::MinkowskiSumButton() {
-    RECT rect;
-    screen = MinkowskiSum;
-    GetWindowRect(m_hwnd, &rect);
-    ellipses.clear();
-    int width = static_cast<int>(rect.right - rect.left);
-    int height = static_cast<int>(rect.bottom - rect.top);
-    centerX = (width + 220) / 2 - (((width + 220) / 2) % 20);
-    centerY = height / 2 - ((height / 2) % 20);
+    SceneSnapshot scene;
+    int width, height;
+    NewScene(SceneMinkowskiSum, &scene, &width, &height);
     // Convex hull for group 1
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300)/2) + 250;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150)/2) + 50;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 1);
-    }
+    SeedGroup(&scene, 1, 250.0f, 50.0f, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Red));
 
     // Convex hull for group 2
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300)/2) + 250 + (rect.right - rect.left - 300) / 2;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150)/2) + 50 + (rect.bottom - rect.top - 150) / 2;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue), 2);
-    }
+    SeedGroup(&scene, 2, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 250.0f + (width - 300), 50.0f + (height - 150), 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue));
+    model.Load(scene);
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
 // Initializes circles for Minkowski Difference
 void MainWindow::MinkowskiDifferenceButton() {
-    RECT rect;
-    screen = MinkowskiDifference;
-    GetWindowRect(m_hwnd, &rect);
-    ellipses.clear(); 
-    int width = static_cast<int>(rect.right - rect.left);
-    int height = static_cast<int>(rect.bottom - rect.top);
-    centerX = (width + 220) / 2 - (((width + 220) / 2) % 20);
-    centerY = height / 2 - ((height / 2) % 20);
+    SceneSnapshot scene;
+    int width, height;
+    NewScene(SceneMinkowskiDifference, &scene, &width, &height);
 
     // Convex hull for group 1
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300) / 2) + 250;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150) / 2) + 50;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 1);
-    }
+    SeedGroup(&scene, 1, 250.0f, 50.0f, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Red));
 
     // Convex hull for group 2
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300) / 2) + 250 + (rect.right - rect.left - 300) / 2;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150) / 2) + 50 + (rect.bottom - rect.top - 150) / 2;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue), 2);
-    }
+    SeedGroup(&scene, 2, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 250.0f + (width - 300), 50.0f + (height - 150), 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue));
+    model.Load(scene);
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
 // Initializes circles for Point Convex Hull
 void MainWindow::PointConvexHullButton() {
-    RECT rect;
-    screen = PointConvexHull;
-    GetWindowRect(m_hwnd, &rect);
-    ellipses.clear();
-    int width = static_cast<int>(rect.right - rect.left);
-    int height = static_cast<int>(rect.bottom - rect.top);
-    centerX = (width + 220) / 2 - (((width + 220) / 2) % 20);
-    centerY = height / 2 - ((height / 2) % 20);
-
-    for (int i = 0; i < 15; i++) {
-        float xcoord = rand() % (rect.right - rect.left - 300) + 250;
-        float ycoord = rand() % (rect.bottom - rect.top - 150) + 50;
-        InsertEllipse(xcoord, ycoord, 0.0f, D2D1::ColorF(D2D1::ColorF::Red), 1);
-    }
+    SceneSnapshot scene;
+    int width, height;
+    NewScene(ScenePointConvexHull, &scene, &width, &height);
 
-    InsertEllipse(centerX, centerY, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 0);
+    SeedGroup(&scene, 1, 250.0f, 50.0f, 250.0f + (width - 300), 50.0f + (height - 150), 15, 0.0f, D2D1::ColorF(D2D1::ColorF::Red));
 
+    addScenePoint(&scene, scene.view.centerX, scene.view.centerY, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 0);
+
+    model.Load(scene);
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
 // Initializes circles for GJK
 void MainWindow::GJKButton() {
-    RECT rect;
-    screen = GJK;
-    GetWindowRect(m_hwnd, &rect);
-    ellipses.clear();
-    int width = static_cast<int>(rect.right - rect.left);
-    int height = static_cast<int>(rect.bottom - rect.top);
-    centerX = (width + 220) / 2 - (((width + 220) / 2) % 20);
-    centerY = height / 2 - ((height / 2) % 20);
+    SceneSnapshot scene;
+    int width, height;
+    NewScene(SceneGJK, &scene, &width, &height);
     // Convex hull for group 1
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300) / 2) + 250;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150) / 2) + 50;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Red), 1);
-    }
+    SeedGroup(&scene, 1, 250.0f, 50.0f, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Red));
 
     // Convex hull for group 2
-    for (int i = 0; i < 6; i++) {
-        float xcoord = rand() % ((rect.right - rect.left - 300) / 2) + 250 + (rect.right - rect.left - 300) / 2;
-        float ycoord = rand() % ((rect.bottom - rect.top - 150) / 2) + 50 + (rect.bottom - rect.top - 150) / 2;
-        InsertEllipse(xcoord, ycoord, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue), 2);
-    }
+    SeedGroup(&scene, 2, 250.0f + (width - 300) / 2, 50.0f + (height - 150) / 2, 250.0f + (width - 300), 50.0f + (height - 150), 6, 10.0f, D2D1::ColorF(D2D1::ColorF::Blue));
+    model.Load(scene);
     InvalidateRect(m_hwnd, NULL, FALSE);
 }
 
-
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int nCmdShow)
 {
     MainWindow win;
@@ -1256,7 +846,6 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         CreateButtons();
         DPIScale::Initialize(pFactory);
-        scale = 1.0;
         SetMode(SelectMode);
         return 0;
 
@@ -1274,6 +863,14 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         Resize();
         return 0;
 
+    case WM_TIMER:
+        // The scheduler's slot for pending edits has come
+        if (wParam == kRecomputeTimer) {
+            KillTimer(m_hwnd, kRecomputeTimer);
+            InvalidateRect(m_hwnd, NULL, FALSE);
+        }
+        return 0;
+
     case WM_LBUTTONDOWN:
         OnLButtonDown(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), (DWORD)wParam);
         return 0;
@@ -1287,8 +884,12 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
 
     case WM_COMMAND:
+        // Keep the scene being left, F9 brings it back
+        if (model.PointCount() > 0) {
+            SaveScene();
+        }
+
         // Change page on associated button press
-        scale = 1.0f;
         if (LOWORD(wParam) == BTN_QUICK_HULL) {
             QuickHullButton();
         }
@@ -1304,6 +905,7 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         else if (LOWORD(wParam) == BTN_GJK) {
             GJKButton();
         }
+        TraceScene();
         return 0;
 
     case WM_SETCURSOR:
@@ -1396,37 +998,12 @@ void MainWindow::CreateButtons() {
 }
 
 void MainWindow::OnMouseWheel(int nDelta) {
+    trace.Record(TraceWheel, 0.0f, 0.0f, nDelta);
    
+    // Zoom about the origin axes; only the view changes
     if (abs(nDelta) >= WHEEL_DELTA)
     {
-        if (nDelta >0 && scale<4.0f) { 
-             scale *= 2.0f; 
-            for (auto i = ellipses.begin(); i != ellipses.end(); ++i) 
-            {
-            (*i)->ellipse.radiusY *= 2;
-            (*i)->ellipse.radiusX *= 2;
-            if ((*i)->ellipse.point.x<centerX) (*i)->ellipse.point.x -= (centerX - (*i)->ellipse.point.x);
-            else if ((*i)->ellipse.point.x > centerX) (*i)->ellipse.point.x += ((*i)->ellipse.point.x-centerX);
-            if ((*i)->ellipse.point.y < centerY) (*i)->ellipse.point.y -= (centerY - (*i)->ellipse.point.y);
-            else if ((*i)->ellipse.point.y > centerY) (*i)->ellipse.point.y += ((*i)->ellipse.point.y - centerY);
-            } 
-          
-        }
-        else if(nDelta < 0 && scale>0.25f) { 
-            scale *= 0.5f;
-            for (auto i = ellipses.begin(); i != ellipses.end(); ++i)
-            {
-            (*i)->ellipse.radiusY *= 0.5;
-            (*i)->ellipse.radiusX *= 0.5;
-       
-            if ((*i)->ellipse.point.x < centerX) (*i)->ellipse.point.x += ((centerX - (*i)->ellipse.point.x)/2);
-            else if ((*i)->ellipse.point.x > centerX) (*i)->ellipse.point.x -= (((*i)->ellipse.point.x- centerX)/2);
-            if ((*i)->ellipse.point.y < centerY) (*i)->ellipse.point.y += ((centerY - (*i)->ellipse.point.y)/2);
-            else if ((*i)->ellipse.point.y > centerY) (*i)->ellipse.point.y -= (((*i)->ellipse.point.y - centerY)/2);
-            }
-            
-        }
-        
+        model.Wheel(nDelta);
         InvalidateRect(m_hwnd, NULL, FALSE);
     }
     
@@ -0,0 +1,709 @@
+#ifndef _NARROWPHASE_H
+#define _NARROWPHASE_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "geometry.h"
+
+// Batched GJK/EPA narrow phase.
+//
+// Shapes are convex polygons stored back to back in one flat array, pairs are
+// plain index pairs into that set, and results are written into preallocated
+// structure-of-arrays output. Every pair is computed by the same sequential
+// code into its own output slot, so the results are bit-identical no matter
+// how many threads run the batch or how the chunks get scheduled.
+
+const int   kGJKMaxIterations = 64;
+const int   kEPAMaxIterations = 32;
+const float kGJKTolerance = 1e-6f;         // Relative to the size of the shapes' coordinates
+const float kEPATolerance = 1e-4f;
+const float kTOITolerance = 1e-5f;
+const size_t kNarrowPhaseChunkSize = 256;
+const size_t kCacheLineSize = 64;
+
+// Flat storage for many convex polygons (vertices in CCW order)
+struct ShapeSet
+{
+    std::vector<Vec2>   points;
+    std::vector<int>    first;
+    std::vector<int>    count;
+
+    int AddShape(const Vec2 *p, int n)
+    {
+        first.push_back(static_cast<int>(points.size()));
+        count.push_back(n);
+        points.insert(points.end(), p, p + n);
+        return static_cast<int>(first.size()) - 1;
+    }
+
+    void Clear()
+    {
+        points.clear();
+        first.clear();
+        count.clear();
+    }
+
+    size_t Size() const { return first.size(); }
+    const Vec2 *Points(int shape) const { return &points[first[shape]]; }
+};
+
+struct ShapePair
+{
+    int a;
+    int b;
+};
+
+// Result of a single query. The normal is a unit vector pointing from shape A
+// towards shape B; depth is 0 when the shapes are disjoint and distance is 0
+// when they overlap.
+struct NarrowPhaseResult
+{
+    bool    overlap;
+    float   distance;
+    Vec2    normal;
+    float   depth;
+};
+
+// Structure-of-arrays output for a batch, one slot per pair
+struct NarrowPhaseResults
+{
+    std::vector<uint8_t>    overlap;
+    std::vector<float>      distance;
+    std::vector<float>      normalX;
+    std::vector<float>      normalY;
+    std::vector<float>      depth;
+
+    void Resize(size_t n)
+    {
+        overlap.resize(n);
+        distance.resize(n);
+        normalX.resize(n);
+        normalY.resize(n);
+        depth.resize(n);
+    }
+
+    size_t Size() const { return overlap.size(); }
+};
+
+// First contact of two translating shapes over one step, with shape A moving
+// by va and shape B by vb. time is the fraction of the step in [0, 1]; point
+// is on the contact at that time and the unit normal points from A towards B.
+// Shapes that already overlap hit at time 0 with a zero normal, and gjkQuery
+// gives their depth.
+struct TimeOfImpactResult
+{
+    bool    hit;
+    float   time;
+    Vec2    normal;
+    Vec2    point;
+};
+
+// Structure-of-arrays time-of-impact output, one slot per pair
+struct TimeOfImpactResults
+{
+    std::vector<uint8_t>    hit;
+    std::vector<float>      time;
+    std::vector<float>      normalX;
+    std::vector<float>      normalY;
+    std::vector<float>      pointX;
+    std::vector<float>      pointY;
+
+    void Resize(size_t n)
+    {
+        hit.resize(n);
+        time.resize(n);
+        normalX.resize(n);
+        normalY.resize(n);
+        pointX.resize(n);
+        pointY.resize(n);
+    }
+
+    size_t Size() const { return hit.size(); }
+};
+
+// Per-thread working memory, reused across pairs so a batch does not allocate
+struct NarrowPhaseScratch
+{
+    Vec2                simplex[3];
+    int                 simplexCount;
+    std::vector<Vec2>   polytope;
+    char                pad[kCacheLineSize];    // Keeps neighbouring threads' scratch off each other's cache lines
+
+    NarrowPhaseScratch() : simplexCount(0) { polytope.reserve(kEPAMaxIterations + 3); }
+};
+
+// Vertex of polygon p farthest along direction d
+inline Vec2 supportPoint(const Vec2 *p, int n, Vec2 d)
+{
+    int best = 0;
+    float bestDot = dot(p[0], d);
+    for (int i = 1; i < n; i++) {
+        float temp = dot(p[i], d);
+        if (temp > bestDot) {
+            best = i;
+            bestDot = temp;
+        }
+    }
+    return p[best];
+}
+
+// Support point of the Minkowski difference A - B
+inline Vec2 minkowskiSupport(const Vec2 *a, int na, const Vec2 *b, int nb, Vec2 d)
+{
+    return supportPoint(a, na, d) - supportPoint(b, nb, -d);
+}
+
+// Closest point to the origin on segment ab, t is the parameter along ab
+inline Vec2 closestOnSegment(Vec2 a, Vec2 b, float *t)
+{
+    Vec2 ab = b - a;
+    float len = lengthSq(ab);
+    *t = 0.0f;
+    if (len > 0.0f) {
+        *t = -dot(a, ab) / len;
+        if (*t < 0.0f) *t = 0.0f;
+        if (*t > 1.0f) *t = 1.0f;
+    }
+    return a + ab * (*t);
+}
+
+// Reduce the simplex to the feature closest to the origin and return that
+// closest point in v. Returns true if the simplex encloses the origin.
+inline bool gjkReduceSimplex(Vec2 *s, int *count, Vec2 *v)
+{
+    if (*count == 1) {
+        *v = s[0];
+        return false;
+    }
+
+    if (*count == 3) {
+        float area = cross(s[1] - s[0], s[2] - s[0]);
+        if (area != 0.0f) {
+            float c0 = cross(s[1] - s[0], -s[0]);
+            float c1 = cross(s[2] - s[1], -s[1]);
+            float c2 = cross(s[0] - s[2], -s[2]);
+            if ((c0 >= 0 && c1 >= 0 && c2 >= 0) || (c0 <= 0 && c1 <= 0 && c2 <= 0)) {
+                *v = MakeVec2(0.0f, 0.0f);
+                return true;
+            }
+        }
+
+        // Origin is outside, keep the closest edge
+        int best = 0;
+        float bestT = 0.0f;
+        float bestDist = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            float t;
+            Vec2 p = closestOnSegment(s[i], s[(i + 1) % 3], &t);
+            float dist = lengthSq(p);
+            if (i == 0 || dist < bestDist) {
+                best = i;
+                bestT = t;
+                bestDist = dist;
+                *v = p;
+            }
+        }
+        Vec2 a = s[best];
+        Vec2 b = s[(best + 1) % 3];
+        s[0] = a;
+        s[1] = b;
+        *count = 2;
+        if (bestT <= 0.0f) *count = 1;
+        else if (bestT >= 1.0f) { s[0] = b; *count = 1; }
+        return false;
+    }
+
+    float t;
+    *v = closestOnSegment(s[0], s[1], &t);
+    if (t <= 0.0f) *count = 1;
+    else if (t >= 1.0f) { s[0] = s[1]; *count = 1; }
+    return false;
+}
+
+// Expanding polytope: penetration depth and normal once GJK has enclosed the
+// origin in a triangle
+inline void epaQuery(const Vec2 *a, int na, const Vec2 *b, int nb, NarrowPhaseScratch &scratch, NarrowPhaseResult *out)
+{
+    std::vector<Vec2> &poly = scratch.polytope;
+    poly.assign(scratch.simplex, scratch.simplex + 3);
+    if (cross(poly[1] - poly[0], poly[2] - poly[0]) < 0.0f) {
+        Vec2 temp = poly[1];
+        poly[1] = poly[2];
+        poly[2] = temp;
+    }
+
+    Vec2 normal = MakeVec2(0.0f, 0.0f);
+    float depth = 0.0f;
+    for (int iter = 0; iter < kEPAMaxIterations; iter++) {
+        // Find the polytope edge closest to the origin
+        size_t edge = 0;
+        float minDist = 0.0f;
+        bool found = false;
+        for (size_t i = 0; i < poly.size(); i++) {
+            Vec2 e = poly[(i + 1) % poly.size()] - poly[i];
+            float len = length(e);
+            if (len == 0.0f) {
+                continue;
+            }
+            Vec2 n = MakeVec2(e.y / len, -e.x / len);
+            float dist = dot(n, poly[i]);
+            if (!found || dist < minDist) {
+                edge = i;
+                minDist = dist;
+                normal = n;
+                found = true;
+            }
+        }
+        depth = minDist;
+
+        Vec2 p = minkowskiSupport(a, na, b, nb, normal);
+        if (dot(p, normal) - minDist <= kEPATolerance * (minDist > 1.0f ? minDist : 1.0f)) {
+            break;
+        }
+        poly.insert(poly.begin() + edge + 1, p);
+    }
+
+    out->normal = normal;
+    out->depth = depth;
+}
+
+// Largest squared distance of any vertex of either polygon from the origin.
+// Rounding in the Minkowski points grows with it, so GJK's tolerances do too.
+inline float gjkExtentSq(const Vec2 *a, int na, const Vec2 *b, int nb)
+{
+    float extent = 0.0f;
+    for (int i = 0; i < na; i++) {
+        float temp = lengthSq(a[i]);
+        extent = temp > extent ? temp : extent;
+    }
+    for (int i = 0; i < nb; i++) {
+        float temp = lengthSq(b[i]);
+        extent = temp > extent ? temp : extent;
+    }
+    return extent;
+}
+
+// Full pair query: GJK for overlap and separation distance, EPA for depth
+inline void gjkQuery(const Vec2 *a, int na, const Vec2 *b, int nb, NarrowPhaseScratch &scratch, NarrowPhaseResult *out)
+{
+    Vec2 *s = scratch.simplex;
+    int &count = scratch.simplexCount;
+    const float touching = kGJKTolerance * kGJKTolerance * gjkExtentSq(a, na, b, nb);
+
+    // Start from a true support point so EPA only ever sees boundary vertices
+    Vec2 v = minkowskiSupport(a, na, b, nb, a[0] - b[0]);
+    s[0] = v;
+    count = 1;
+
+    bool enclosed = false;
+    for (int iter = 0; iter < kGJKMaxIterations; iter++) {
+        float vv = dot(v, v);
+        if (vv <= touching) {
+            // Touching, to within rounding at the shapes' scale
+            enclosed = true;
+            break;
+        }
+
+        Vec2 w = minkowskiSupport(a, na, b, nb, -v);
+        if (vv - dot(v, w) <= kGJKTolerance * vv) {
+            break;
+        }
+
+        bool duplicate = false;
+        for (int i = 0; i < count; i++) {
+            if (s[i].x == w.x && s[i].y == w.y) {
+                duplicate = true;
+            }
+        }
+        if (duplicate) {
+            break;
+        }
+
+        s[count++] = w;
+        if (gjkReduceSimplex(s, &count, &v)) {
+            enclosed = true;
+            break;
+        }
+    }
+
+    if (!enclosed) {
+        float dist = length(v);
+        out->overlap = false;
+        out->distance = dist;
+        out->normal = -v * (1.0f / dist);
+        out->depth = 0.0f;
+        return;
+    }
+
+    out->overlap = true;
+    out->distance = 0.0f;
+    if (count == 2) {
+        // Origin lies on a segment, which may be an interior chord; grow it
+        // into a triangle on whichever side still has area
+        Vec2 n = perp(s[1] - s[0]);
+        Vec2 w = minkowskiSupport(a, na, b, nb, n);
+        if (dot(w - s[0], n) <= 0.0f) {
+            w = minkowskiSupport(a, na, b, nb, -n);
+        }
+        if (cross(s[1] - s[0], w - s[0]) != 0.0f) {
+            s[count++] = w;
+        }
+    }
+    if (count == 3) {
+        epaQuery(a, na, b, nb, scratch, out);
+    }
+    else {
+        out->normal = MakeVec2(0.0f, 0.0f);
+        out->depth = 0.0f;
+    }
+}
+
+// Ray-cast simplex vertex: p = a - b on the Minkowski difference and the
+// point a on shape A it came from
+struct TOIVertex
+{
+    Vec2    p;
+    Vec2    a;
+};
+
+// Reduce the ray-cast simplex to the feature of {x - p} closest to the
+// origin, leaving that point in v and the barycentric weights of the kept
+// vertices in w. Returns true if x lies inside the simplex.
+inline bool toiReduceSimplex(TOIVertex *s, int *count, Vec2 x, Vec2 *v, float *w)
+{
+    if (*count == 1) {
+        *v = x - s[0].p;
+        w[0] = 1.0f;
+        return false;
+    }
+
+    if (*count == 3) {
+        Vec2 q0 = x - s[0].p;
+        Vec2 q1 = x - s[1].p;
+        Vec2 q2 = x - s[2].p;
+        float area = cross(q1 - q0, q2 - q0);
+        if (area != 0.0f) {
+            float c0 = cross(q1, q2) / area;
+            float c1 = cross(q2, q0) / area;
+            float c2 = cross(q0, q1) / area;
+            if (c0 >= 0.0f && c1 >= 0.0f && c2 >= 0.0f) {
+                w[0] = c0;
+                w[1] = c1;
+                w[2] = c2;
+                *v = MakeVec2(0.0f, 0.0f);
+                return true;
+            }
+        }
+
+        // Keep the closest edge
+        int best = 0;
+        float bestDist = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            float t;
+            float dist = lengthSq(closestOnSegment(x - s[i].p, x - s[(i + 1) % 3].p, &t));
+            if (i == 0 || dist < bestDist) {
+                best = i;
+                bestDist = dist;
+            }
+        }
+        TOIVertex a = s[best];
+        TOIVertex b = s[(best + 1) % 3];
+        s[0] = a;
+        s[1] = b;
+        *count = 2;
+    }
+
+    float t;
+    *v = closestOnSegment(x - s[0].p, x - s[1].p, &t);
+    if (t <= 0.0f) {
+        *count = 1;
+        w[0] = 1.0f;
+    }
+    else if (t >= 1.0f) {
+        s[0] = s[1];
+        *count = 1;
+        w[0] = 1.0f;
+    }
+    else {
+        w[0] = 1.0f - t;
+        w[1] = t;
+    }
+    return false;
+}
+
+// Time of impact by GJK ray casting: A and B touch at time t when
+// t * (vb - va) lies in A - B, so a ray from the origin along vb - va is cast
+// against the Minkowski difference. The ray parameter only ever grows and is
+// always a lower bound on the true contact time, so stopping early errs on
+// the side of reporting the hit too soon. Each iteration costs two support
+// scans, and disjoint pairs that move apart exit after the first.
+inline void gjkTimeOfImpact(const Vec2 *a, int na, Vec2 va, const Vec2 *b, int nb, Vec2 vb, TimeOfImpactResult *out)
+{
+    Vec2 r = vb - va;
+    TOIVertex s[3];
+    float w[3];
+    int count = 1;
+    s[0].a = a[0];
+    s[0].p = a[0] - b[0];
+    w[0] = 1.0f;
+
+    float lambda = 0.0f;
+    Vec2 x = MakeVec2(0.0f, 0.0f);
+    Vec2 n = MakeVec2(0.0f, 0.0f);
+    Vec2 v = x - s[0].p;
+    float scale = lengthSq(v);
+
+    out->hit = false;
+    out->time = 1.0f;
+    out->normal = MakeVec2(0.0f, 0.0f);
+    out->point = MakeVec2(0.0f, 0.0f);
+    for (int iter = 0; iter < kGJKMaxIterations; iter++) {
+        float vv = dot(v, v);
+        if (vv <= kTOITolerance * kTOITolerance * scale) {
+            break;
+        }
+
+        // Support plane of A - B facing x
+        Vec2 pa = supportPoint(a, na, v);
+        Vec2 p = pa - supportPoint(b, nb, -v);
+        float vw = dot(v, x - p);
+        bool advanced = false;
+        if (vw > 0.0f) {
+            float vr = dot(v, r);
+            if (vr >= 0.0f) {
+                // Separated along v and not closing in
+                return;
+            }
+            lambda -= vw / vr;
+            if (lambda > 1.0f) {
+                return;
+            }
+            x = r * lambda;
+            n = v;
+            advanced = true;
+        }
+
+        bool duplicate = false;
+        for (int i = 0; i < count; i++) {
+            if (s[i].p.x == p.x && s[i].p.y == p.y) {
+                duplicate = true;
+            }
+        }
+        if (duplicate && !advanced) {
+            break;
+        }
+        if (!duplicate) {
+            s[count].p = p;
+            s[count].a = pa;
+            count++;
+            float ww = lengthSq(x - p);
+            if (ww > scale) {
+                scale = ww;
+            }
+        }
+        if (toiReduceSimplex(s, &count, x, &v, w)) {
+            break;
+        }
+    }
+
+    Vec2 point = MakeVec2(0.0f, 0.0f);
+    for (int i = 0; i < count; i++) {
+        point = point + s[i].a * w[i];
+    }
+    float len = length(n);
+    out->hit = true;
+    out->time = lambda;
+    out->normal = len > 0.0f ? n * (1.0f / len) : MakeVec2(0.0f, 0.0f);
+    out->point = point + va * lambda;
+}
+
+// Fixed thread pool that pushes a list of candidate pairs through gjkQuery,
+// or through gjkTimeOfImpact for swept pairs. The calling thread takes part
+// in the work, so a pool of one thread runs the whole batch inline.
+class NarrowPhaseBatch
+{
+public:
+    explicit NarrowPhaseBatch(unsigned threadCount = std::thread::hardware_concurrency())
+        : generation(0), quit(false), busy(0), jobShapes(NULL), jobPairs(NULL), jobCount(0), jobResults(NULL),
+        jobVelocities(NULL), jobImpacts(NULL), nextChunk(0)
+    {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        scratch.resize(threadCount);
+        for (unsigned i = 1; i < threadCount; i++) {
+            workers.push_back(std::thread(&NarrowPhaseBatch::WorkerLoop, this, i));
+        }
+    }
+
+    ~NarrowPhaseBatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    unsigned ThreadCount() const { return static_cast<unsigned>(scratch.size()); }
+
+    // Results must already be sized for at least pairCount entries
+    void Run(const ShapeSet &shapes, const ShapePair *pairs, size_t pairCount, NarrowPhaseResults *results);
+
+    // Time of impact for every pair, with one displacement per shape over the
+    // step. Results must already be sized for at least pairCount entries.
+    void RunTimeOfImpact(const ShapeSet &shapes, const Vec2 *velocities, const ShapePair *pairs, size_t pairCount, TimeOfImpactResults *results);
+
+private:
+    NarrowPhaseBatch(const NarrowPhaseBatch &);
+    NarrowPhaseBatch &operator=(const NarrowPhaseBatch &);
+
+    void Start(const ShapeSet &shapes, const ShapePair *pairs, size_t pairCount);
+    void WorkerLoop(unsigned id);
+    void ProcessChunks(unsigned id);
+
+    std::vector<std::thread>        workers;
+    std::vector<NarrowPhaseScratch> scratch;
+
+    std::mutex                      mutex;
+    std::condition_variable         wake;
+    std::condition_variable         done;
+    unsigned                        generation;
+    bool                            quit;
+    size_t                          busy;
+
+    const ShapeSet                  *jobShapes;
+    const ShapePair                 *jobPairs;
+    size_t                          jobCount;
+    NarrowPhaseResults              *jobResults;
+    const Vec2                      *jobVelocities;
+    TimeOfImpactResults             *jobImpacts;
+    std::atomic<size_t>             nextChunk;
+};
+
+inline void NarrowPhaseBatch::Run(const ShapeSet &shapes, const ShapePair *pairs, size_t pairCount, NarrowPhaseResults *results)
+{
+    assert(results->Size() >= pairCount);
+    if (pairCount == 0) {
+        return;
+    }
+
+    jobResults = results;
+    jobVelocities = NULL;
+    jobImpacts = NULL;
+    Start(shapes, pairs, pairCount);
+}
+
+inline void NarrowPhaseBatch::RunTimeOfImpact(const ShapeSet &shapes, const Vec2 *velocities, const ShapePair *pairs, size_t pairCount, TimeOfImpactResults *results)
+{
+    assert(results->Size() >= pairCount);
+    if (pairCount == 0) {
+        return;
+    }
+
+    jobResults = NULL;
+    jobVelocities = velocities;
+    jobImpacts = results;
+    Start(shapes, pairs, pairCount);
+}
+
+// Hand the job to the workers, take part in it and wait for the rest
+inline void NarrowPhaseBatch::Start(const ShapeSet &shapes, const ShapePair *pairs, size_t pairCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobShapes = &shapes;
+        jobPairs = pairs;
+        jobCount = pairCount;
+        nextChunk = 0;
+        busy = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    ProcessChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+}
+
+inline void NarrowPhaseBatch::WorkerLoop(unsigned id)
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return quit || generation != seen; });
+            if (quit) {
+                return;
+            }
+            seen = generation;
+        }
+
+        ProcessChunks(id);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+inline void NarrowPhaseBatch::ProcessChunks(unsigned id)
+{
+    NarrowPhaseScratch &local = scratch[id];
+    NarrowPhaseResult result;
+
+    for (;;) {
+        size_t begin = nextChunk.fetch_add(1) * kNarrowPhaseChunkSize;
+        if (begin >= jobCount) {
+            return;
+        }
+        size_t end = begin + kNarrowPhaseChunkSize;
+        if (end > jobCount) {
+            end = jobCount;
+        }
+
+        if (jobImpacts != NULL) {
+            TimeOfImpactResult impact;
+            for (size_t i = begin; i < end; i++) {
+                const ShapePair &pair = jobPairs[i];
+                gjkTimeOfImpact(jobShapes->Points(pair.a), jobShapes->count[pair.a], jobVelocities[pair.a],
+                    jobShapes->Points(pair.b), jobShapes->count[pair.b], jobVelocities[pair.b],
+                    &impact);
+
+                jobImpacts->hit[i] = impact.hit ? 1 : 0;
+                jobImpacts->time[i] = impact.time;
+                jobImpacts->normalX[i] = impact.normal.x;
+                jobImpacts->normalY[i] = impact.normal.y;
+                jobImpacts->pointX[i] = impact.point.x;
+                jobImpacts->pointY[i] = impact.point.y;
+            }
+            continue;
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            const ShapePair &pair = jobPairs[i];
+            gjkQuery(jobShapes->Points(pair.a), jobShapes->count[pair.a],
+                jobShapes->Points(pair.b), jobShapes->count[pair.b],
+                local, &result);
+
+            jobResults->overlap[i] = result.overlap ? 1 : 0;
+            jobResults->distance[i] = result.distance;
+            jobResults->normalX[i] = result.normal.x;
+            jobResults->normalY[i] = result.normal.y;
+            jobResults->depth[i] = result.depth;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef _NARROWPHASE3D_H
+#define _NARROWPHASE3D_H
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "geometry.h"
+#include "quickhull3d.h"
+
+// 3D GJK/EPA narrow phase on convex polyhedra.
+//
+// Support points are found by hill-climbing the vertex adjacency graph from
+// the vertex returned by the previous query (kept in a per-pair GJKCache3D),
+// so a support call usually touches a handful of vertices instead of all of
+// them. Three queries are exposed: a boolean overlap test that stops at the
+// first separating direction, a distance query with witness points, and an
+// EPA penetration query. All working memory for EPA lives in EPAScratch3D so
+// repeated queries do not allocate.
+
+const int   kGJK3DMaxIterations = 64;
+const int   kEPA3DMaxIterations = 64;
+const float kGJK3DTolerance = 1e-6f;       // Relative to the size of the support points' coordinates
+const float kEPA3DTolerance = 1e-4f;
+
+// Rigid placement: world = R * local + position, R stored by rows
+struct Pose3
+{
+    Vec3 position;
+    Vec3 row0;
+    Vec3 row1;
+    Vec3 row2;
+
+    static Pose3 Translation(Vec3 p)
+    {
+        Pose3 pose = { p, MakeVec3(1, 0, 0), MakeVec3(0, 1, 0), MakeVec3(0, 0, 1) };
+        return pose;
+    }
+
+    Vec3 Apply(Vec3 p) const { return MakeVec3(dot(row0, p), dot(row1, p), dot(row2, p)) + position; }
+
+    // Transpose rotation, takes a world direction into local space
+    Vec3 InverseRotate(Vec3 d) const { return row0 * d.x + row1 * d.y + row2 * d.z; }
+};
+
+// Convex polyhedron with compressed vertex adjacency for hill-climbing
+struct ConvexPolyhedron
+{
+    std::vector<Vec3>   vertices;
+    std::vector<int>    neighborStart;  // neighbors of v are [neighborStart[v], neighborStart[v + 1])
+    std::vector<int>    neighbors;
+
+    void FromMesh(const HalfEdgeMesh &mesh)
+    {
+        vertices = mesh.vertices;
+        neighborStart.assign(1, 0);
+        neighbors.clear();
+        for (size_t v = 0; v < mesh.vertices.size(); v++) {
+            int first = mesh.vertexEdge[v];
+            int e = first;
+            do {
+                const HullHalfEdge &twin = mesh.edges[mesh.edges[e].twin];
+                neighbors.push_back(twin.vertex);
+                e = twin.next;
+            } while (e != first);
+            neighborStart.push_back(static_cast<int>(neighbors.size()));
+        }
+    }
+
+    // Index of the vertex farthest along d, climbing from start. On a convex
+    // polyhedron a vertex with no better neighbour is a global maximum.
+    int Support(Vec3 d, int start) const
+    {
+        int best = start;
+        float bestDot = dot(vertices[best], d);
+        if (neighbors.empty()) {
+            for (int i = 0; i < static_cast<int>(vertices.size()); i++) {
+                float temp = dot(vertices[i], d);
+                if (temp > bestDot) {
+                    best = i;
+                    bestDot = temp;
+                }
+            }
+            return best;
+        }
+
+        for (;;) {
+            int next = best;
+            for (int k = neighborStart[best]; k < neighborStart[best + 1]; k++) {
+                float temp = dot(vertices[neighbors[k]], d);
+                if (temp > bestDot) {
+                    next = neighbors[k];
+                    bestDot = temp;
+                }
+            }
+            if (next == best) {
+                return best;
+            }
+            best = next;
+        }
+    }
+};
+
+// Warm start for one pair, reuse it across frames
+struct GJKCache3D
+{
+    int startA;
+    int startB;
+
+    GJKCache3D() : startA(0), startB(0) {}
+};
+
+struct SimplexVertex3
+{
+    Vec3 w;     // a - b
+    Vec3 a;
+    Vec3 b;
+};
+
+struct Simplex3
+{
+    SimplexVertex3  v[4];
+    float           bary[4];
+    int             count;
+};
+
+struct EPAFace3
+{
+    int     a, b, c;
+    Vec3    normal;
+    float   dist;
+    bool    live;
+};
+
+struct EPAEdge3
+{
+    int a, b;
+};
+
+struct EPAScratch3D
+{
+    std::vector<SimplexVertex3> vertices;
+    std::vector<EPAFace3>       faces;
+    std::vector<EPAEdge3>       horizon;
+
+    EPAScratch3D()
+    {
+        vertices.reserve(kEPA3DMaxIterations + 4);
+        faces.reserve(2 * kEPA3DMaxIterations + 8);
+        horizon.reserve(64);
+    }
+};
+
+inline SimplexVertex3 supportPair3D(const ConvexPolyhedron &a, const Pose3 &pa, const ConvexPolyhedron &b, const Pose3 &pb, Vec3 d, GJKCache3D *cache)
+{
+    cache->startA = a.Support(pa.InverseRotate(d), cache->startA);
+    cache->startB = b.Support(pb.InverseRotate(-d), cache->startB);
+    SimplexVertex3 s;
+    s.a = pa.Apply(a.vertices[cache->startA]);
+    s.b = pb.Apply(b.vertices[cache->startB]);
+    s.w = s.a - s.b;
+    return s;
+}
+
+// Largest squared distance of a support pair's points from the origin.
+// Rounding in w grows with it, so GJK's and EPA's tolerances do too.
+inline float supportExtentSq3D(const SimplexVertex3 &s)
+{
+    float a = lengthSq(s.a);
+    float b = lengthSq(s.b);
+    return a > b ? a : b;
+}
+
+// Barycentric weights of the point of triangle abc closest to the origin
+inline void closestOnTriangle3D(Vec3 a, Vec3 b, Vec3 c, float *bary)
+{
+    Vec3 ab = b - a;
+    Vec3 ac = c - a;
+    float d1 = -dot(ab, a);
+    float d2 = -dot(ac, a);
+    if (d1 <= 0 && d2 <= 0) {
+        bary[0] = 1; bary[1] = 0; bary[2] = 0;
+        return;
+    }
+    float d3 = -dot(ab, b);
+    float d4 = -dot(ac, b);
+    if (d3 >= 0 && d4 <= d3) {
+        bary[0] = 0; bary[1] = 1; bary[2] = 0;
+        return;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        float v = d1 / (d1 - d3);
+        bary[0] = 1 - v; bary[1] = v; bary[2] = 0;
+        return;
+    }
+    float d5 = -dot(ab, c);
+    float d6 = -dot(ac, c);
+    if (d6 >= 0 && d5 <= d6) {
+        bary[0] = 0; bary[1] = 0; bary[2] = 1;
+        return;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        float w = d2 / (d2 - d6);
+        bary[0] = 1 - w; bary[1] = 0; bary[2] = w;
+        return;
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        bary[0] = 0; bary[1] = 1 - w; bary[2] = w;
+        return;
+    }
+    float denom = 1.0f / (va + vb + vc);
+    bary[1] = vb * denom;
+    bary[2] = vc * denom;
+    bary[0] = 1 - bary[1] - bary[2];
+}
+
+// True if the origin and d lie on opposite sides of plane abc
+inline bool originOutsidePlane(Vec3 a, Vec3 b, Vec3 c, Vec3 d)
+{
+    Vec3 n = cross(b - a, c - a);
+    float signOrigin = -dot(a, n);
+    float signD = dot(d - a, n);
+    return signOrigin * signD < 0.0f;
+}
+
+// Reduce the simplex to the smallest feature holding the point closest to
+// the origin, returning that point in v. Returns true if the tetrahedron
+// encloses the origin. extentSq is the squared size of the support points.
+inline bool gjkReduceSimplex3D(Simplex3 *s, Vec3 *v, float extentSq)
+{
+    SimplexVertex3 *p = s->v;
+    float bary[4] = { 1, 0, 0, 0 };
+
+    if (s->count == 2) {
+        Vec3 ab = p[1].w - p[0].w;
+        float len = lengthSq(ab);
+        float t = len > 0.0f ? -dot(p[0].w, ab) / len : 0.0f;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+        bary[0] = 1 - t;
+        bary[1] = t;
+    }
+    else if (s->count == 3) {
+        closestOnTriangle3D(p[0].w, p[1].w, p[2].w, bary);
+    }
+    else if (s->count == 4) {
+        // Check the faces the origin could be outside of
+        static const int faceIndex[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+        // A flat tetrahedron cannot enclose anything, test all of its faces.
+        // The volume is flat against its edges or within rounding at the
+        // support points' scale.
+        Vec3 e1 = p[1].w - p[0].w;
+        Vec3 e2 = p[2].w - p[0].w;
+        Vec3 e3 = p[3].w - p[0].w;
+        float l1 = length(e1);
+        float l2 = length(e2);
+        float l3 = length(e3);
+        float volume = dot(cross(e1, e2), e3);
+        bool flat = fabsf(volume) <= kGJK3DTolerance * (l1 * l2 * l3 + sqrtf(extentSq) * (l1 * l2 + l2 * l3 + l3 * l1));
+        float bestDist = FLT_MAX;
+        bool outside = false;
+        for (int f = 0; f < 4; f++) {
+            const int *k = faceIndex[f];
+            if (!flat && !originOutsidePlane(p[k[0]].w, p[k[1]].w, p[k[2]].w, p[k[3]].w)) {
+                continue;
+            }
+            outside = true;
+            float faceBary[3];
+            closestOnTriangle3D(p[k[0]].w, p[k[1]].w, p[k[2]].w, faceBary);
+            Vec3 q = p[k[0]].w * faceBary[0] + p[k[1]].w * faceBary[1] + p[k[2]].w * faceBary[2];
+            float dist = lengthSq(q);
+            if (dist < bestDist) {
+                bestDist = dist;
+                bary[k[0]] = faceBary[0];
+                bary[k[1]] = faceBary[1];
+                bary[k[2]] = faceBary[2];
+                bary[k[3]] = 0;
+            }
+        }
+        if (!outside) {
+            *v = MakeVec3(0, 0, 0);
+            return true;
+        }
+    }
+
+    // Drop vertices that no longer contribute
+    int count = 0;
+    *v = MakeVec3(0, 0, 0);
+    for (int i = 0; i < s->count; i++) {
+        if (bary[i] > 0.0f) {
+            *v = *v + p[i].w * bary[i];
+            p[count] = p[i];
+            s->bary[count] = bary[i];
+            count++;
+        }
+    }
+    s->count = count;
+    return false;
+}
+
+// Shared GJK loop. With booleanOnly set it returns as soon as a separating
+// direction shows up instead of converging on the distance. extentSq gets
+// the largest supportExtentSq3D of the support points it visited.
+inline bool gjkRun3D(const ConvexPolyhedron &a, const Pose3 &pa, const ConvexPolyhedron &b, const Pose3 &pb,
+    GJKCache3D *cache, bool booleanOnly, Simplex3 *s, Vec3 *v, float *extentSq)
+{
+    s->v[0] = supportPair3D(a, pa, b, pb, pa.Apply(a.vertices[cache->startA]) - pb.Apply(b.vertices[cache->startB]), cache);
+    s->bary[0] = 1.0f;
+    s->count = 1;
+    *v = s->v[0].w;
+    *extentSq = supportExtentSq3D(s->v[0]);
+
+    for (int iter = 0; iter < kGJK3DMaxIterations; iter++) {
+        float vv = dot(*v, *v);
+        if (vv <= kGJK3DTolerance * kGJK3DTolerance * *extentSq) {
+            // Touching, to within rounding at the shapes' scale
+            return true;
+        }
+
+        SimplexVertex3 w = supportPair3D(a, pa, b, pb, -*v, cache);
+        float extent = supportExtentSq3D(w);
+        *extentSq = extent > *extentSq ? extent : *extentSq;
+        float vw = dot(*v, w.w);
+        if (booleanOnly && vw > 0.0f) {
+            return false;
+        }
+        if (vv - vw <= kGJK3DTolerance * vv) {
+            return false;
+        }
+
+        bool duplicate = false;
+        for (int i = 0; i < s->count; i++) {
+            if (lengthSq(s->v[i].w - w.w) == 0.0f) {
+                duplicate = true;
+            }
+        }
+        if (duplicate) {
+            return false;
+        }
+
+        s->v[s->count++] = w;
+        if (gjkReduceSimplex3D(s, v, *extentSq)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Boolean overlap test
+inline bool gjkOverlap3D(const ConvexPolyhedron &a, const Pose3 &pa, const ConvexPolyhedron &b, const Pose3 &pb, GJKCache3D *cache)
+{
+    Simplex3 s;
+    Vec3 v;
+    float extentSq;
+    return gjkRun3D(a, pa, b, pb, cache, true, &s, &v, &extentSq);
+}
+
+// Separation distance with the closest points on each shape; returns 0 when
+// the shapes overlap
+inline float gjkDistance3D(const ConvexPolyhedron &a, const Pose3 &pa, const ConvexPolyhedron &b, const Pose3 &pb,
+    GJKCache3D *cache, Vec3 *pointA, Vec3 *pointB)
+{
+    Simplex3 s;
+    Vec3 v;
+    float extentSq;
+    if (gjkRun3D(a, pa, b, pb, cache, false, &s, &v, &extentSq)) {
+        return 0.0f;
+    }
+    Vec3 wa = MakeVec3(0, 0, 0);
+    Vec3 wb = MakeVec3(0, 0, 0);
+    for (int i = 0; i < s.count; i++) {
+        wa = wa + s.v[i].a * s.bary[i];
+        wb = wb + s.v[i].b * s.bary[i];
+    }
+    *pointA = wa;
+    *pointB = wb;
+    return length(v);
+}
+
+inline void epaAddFace3D(EPAScratch3D &scratch, int a, int b, int c)
+{
+    const std::vector<SimplexVertex3> &p = scratch.vertices;
+    EPAFace3 face = { a, b, c, MakeVec3(0, 0, 0), FLT_MAX, true };
+    Vec3 n = cross(p[b].w - p[a].w, p[c].w - p[a].w);
+    float len = length(n);
+    if (len > 0.0f) {
+        face.normal = n * (1.0f / len);
+        face.dist = dot(face.normal, p[a].w);
+    }
+    scratch.faces.push_back(face);
+}
+
+// Penetration depth and normal (pointing from A towards B). Returns false if
+// the shapes do not overlap.
+inline bool epaPenetration3D(const ConvexPolyhedron &a, const Pose3 &pa, const ConvexPolyhedron &b, const Pose3 &pb,
+    GJKCache3D *cache, EPAScratch3D &scratch, Vec3 *normal, float *depth)
+{
+    Simplex3 s;
+    Vec3 v;
+    float extentSq;
+    if (!gjkRun3D(a, pa, b, pb, cache, false, &s, &v, &extentSq)) {
+        return false;
+    }
+    // Points closer than this to the simplex's line or plane add no volume
+    const float touching = kGJK3DTolerance * kGJK3DTolerance * extentSq;
+
+    *normal = MakeVec3(0, 0, 0);
+    *depth = 0.0f;
+
+    // Grow a touching or degenerate simplex into a tetrahedron
+    static const Vec3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    if (s.count == 1) {
+        for (int i = 0; i < 6 && s.count == 1; i++) {
+            SimplexVertex3 w = supportPair3D(a, pa, b, pb, axes[i], cache);
+            if (lengthSq(w.w - s.v[0].w) > touching) {
+                s.v[s.count++] = w;
+            }
+        }
+    }
+    if (s.count == 2) {
+        Vec3 dir = s.v[1].w - s.v[0].w;
+        for (int i = 0; i < 6 && s.count == 2; i++) {
+            Vec3 n = cross(dir, axes[i]);
+            if (lengthSq(n) == 0.0f) {
+                continue;
+            }
+            SimplexVertex3 w = supportPair3D(a, pa, b, pb, n, cache);
+            if (lengthSq(cross(dir, w.w - s.v[0].w)) > touching * lengthSq(dir)) {
+                s.v[s.count++] = w;
+            }
+        }
+    }
+    if (s.count == 3) {
+        Vec3 n = cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w);
+        float nn = lengthSq(n);
+        SimplexVertex3 w = supportPair3D(a, pa, b, pb, n, cache);
+        float h = dot(w.w - s.v[0].w, n);
+        if (h * h <= touching * nn) {
+            w = supportPair3D(a, pa, b, pb, -n, cache);
+            h = dot(w.w - s.v[0].w, n);
+        }
+        if (h * h > touching * nn) {
+            s.v[s.count++] = w;
+        }
+    }
+    if (s.count < 4) {
+        // Flat Minkowski difference, the shapes only touch
+        return true;
+    }
+
+    scratch.vertices.assign(s.v, s.v + 4);
+    scratch.faces.clear();
+    if (dot(cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w), s.v[3].w - s.v[0].w) > 0.0f) {
+        SimplexVertex3 temp = scratch.vertices[1];
+        scratch.vertices[1] = scratch.vertices[2];
+        scratch.vertices[2] = temp;
+    }
+    epaAddFace3D(scratch, 0, 1, 2);
+    epaAddFace3D(scratch, 0, 3, 1);
+    epaAddFace3D(scratch, 0, 2, 3);
+    epaAddFace3D(scratch, 1, 3, 2);
+
+    for (int iter = 0; iter < kEPA3DMaxIterations; iter++) {
+        int best = -1;
+        for (size_t f = 0; f < scratch.faces.size(); f++) {
+            if (scratch.faces[f].live && (best == -1 || scratch.faces[f].dist < scratch.faces[best].dist)) {
+                best = static_cast<int>(f);
+            }
+        }
+        if (best == -1) {
+            break;
+        }
+        EPAFace3 closest = scratch.faces[best];
+        *normal = closest.normal;
+        *depth = closest.dist;
+
+        SimplexVertex3 w = supportPair3D(a, pa, b, pb, closest.normal, cache);
+        if (dot(w.w, closest.normal) - closest.dist <= kEPA3DTolerance * (closest.dist > 1.0f ? closest.dist : 1.0f)) {
+            break;
+        }
+
+        // Remove faces that see the new point; their unshared edges form the horizon
+        int index = static_cast<int>(scratch.vertices.size());
+        scratch.vertices.push_back(w);
+        scratch.horizon.clear();
+        for (size_t f = 0; f < scratch.faces.size(); f++) {
+            EPAFace3 &face = scratch.faces[f];
+            if (!face.live || dot(face.normal, w.w - scratch.vertices[face.a].w) <= 0.0f) {
+                continue;
+            }
+            face.live = false;
+            int edges[3][2] = { { face.a, face.b }, { face.b, face.c }, { face.c, face.a } };
+            for (int k = 0; k < 3; k++) {
+                bool shared = false;
+                for (size_t h = 0; h < scratch.horizon.size(); h++) {
+                    if (scratch.horizon[h].a == edges[k][1] && scratch.horizon[h].b == edges[k][0]) {
+                        scratch.horizon[h] = scratch.horizon.back();
+                        scratch.horizon.pop_back();
+                        shared = true;
+                        break;
+                    }
+                }
+                if (!shared) {
+                    EPAEdge3 edge = { edges[k][0], edges[k][1] };
+                    scratch.horizon.push_back(edge);
+                }
+            }
+        }
+        for (size_t h = 0; h < scratch.horizon.size(); h++) {
+            epaAddFace3D(scratch, scratch.horizon[h].a, scratch.horizon[h].b, index);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef _ONLINEHULL_H
+#define _ONLINEHULL_H
+
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "hull2d.h"
+
+// Insert-only convex hull for points that arrive one at a time.
+//
+// The hull is kept as an upper and a lower chain, each a balanced ordered map
+// from x to y. An insert is an O(log n) lookup of the chain segment spanning
+// the new x. Points on or under it leave the chain alone; otherwise the point
+// goes in and neighbours that stop turning clockwise are erased. Every point
+// is erased at most once, so that is amortized O(log n).
+//
+// One thread inserts. Any number of threads may read the last published
+// snapshot at the same time: Publish swaps in a new immutable vertex list, so
+// readers never wait on the writer and never see a half-updated hull.
+
+// Upper chain: the largest y for each x, strictly convex and clockwise from
+// left to right. The lower chain is the upper chain of the mirrored points.
+template <class Scalar>
+class HullChain
+{
+public:
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+    typedef typename std::map<Scalar, Scalar>::const_iterator const_iterator;
+
+    // Whether (x, y) is on or under the chain; false outside its x range
+    bool Covers(Scalar x, Scalar y) const
+    {
+        const_iterator hi = points.lower_bound(x);
+        if (hi == points.end()) {
+            return false;
+        }
+        if (hi->first == x) {
+            return y <= hi->second;
+        }
+        if (hi == points.begin()) {
+            return false;
+        }
+        const_iterator lo = std::prev(hi);
+        return orientWide<Wide>(lo->first, lo->second, hi->first, hi->second, x, y) <= 0;
+    }
+
+    // Returns true if the chain changed
+    bool Insert(Scalar x, Scalar y)
+    {
+        if (Covers(x, y)) {
+            return false;
+        }
+
+        typename std::map<Scalar, Scalar>::iterator it = points.insert(std::make_pair(x, y)).first;
+        it->second = y;
+
+        // Neighbours on either side that no longer turn clockwise
+        for (;;) {
+            typename std::map<Scalar, Scalar>::iterator next = std::next(it);
+            if (next == points.end() || std::next(next) == points.end()) {
+                break;
+            }
+            typename std::map<Scalar, Scalar>::iterator after = std::next(next);
+            if (orientWide<Wide>(it->first, it->second, next->first, next->second, after->first, after->second) < 0) {
+                break;
+            }
+            points.erase(next);
+        }
+        for (;;) {
+            if (it == points.begin() || std::prev(it) == points.begin()) {
+                break;
+            }
+            typename std::map<Scalar, Scalar>::iterator prev = std::prev(it);
+            typename std::map<Scalar, Scalar>::iterator before = std::prev(prev);
+            if (orientWide<Wide>(before->first, before->second, prev->first, prev->second, it->first, it->second) < 0) {
+                break;
+            }
+            points.erase(prev);
+        }
+        return true;
+    }
+
+    void Clear() { points.clear(); }
+    size_t Size() const { return points.size(); }
+    const_iterator begin() const { return points.begin(); }
+    const_iterator end() const { return points.end(); }
+
+private:
+    std::map<Scalar, Scalar>    points;
+};
+
+// A shared_ptr one thread stores and any thread loads. Uses
+// std::atomic<std::shared_ptr> where the library has it (C++20); before that
+// the free std::atomic_load and std::atomic_store overloads, which C++20
+// deprecates but which are the only portable choice in C++14.
+template <class T>
+class AtomicSharedPtr
+{
+public:
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::shared_ptr<T> Load() const { return ptr.load(); }
+    void Store(std::shared_ptr<T> p) { ptr.store(std::move(p)); }
+#else
+    std::shared_ptr<T> Load() const { return std::atomic_load(&ptr); }
+    void Store(std::shared_ptr<T> p) { std::atomic_store(&ptr, std::move(p)); }
+#endif
+
+private:
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<std::shared_ptr<T> >    ptr;
+#else
+    std::shared_ptr<T>                  ptr;
+#endif
+};
+
+// Published hull: vertices in counter-clockwise order from the leftmost,
+// lowest point, with the count of inserts it reflects
+template <class Scalar>
+struct OnlineHullSnapshot
+{
+    std::vector<HullPointT<Scalar> >    vertices;
+    uint64_t                            inserted;
+};
+
+template <class Scalar>
+class OnlineHull
+{
+public:
+    OnlineHull() : inserted(0), changed(false)
+    {
+        published.Store(std::shared_ptr<const OnlineHullSnapshot<Scalar> >(new OnlineHullSnapshot<Scalar>()));
+    }
+
+    // Returns true if the point changed the hull
+    bool Insert(Scalar x, Scalar y)
+    {
+        inserted++;
+        bool up = upper.Insert(x, y);
+        bool down = lower.Insert(x, -y);
+        changed = changed || up || down;
+        return up || down;
+    }
+
+    // Insert a batch and publish once at the end; returns how many changed
+    // the hull
+    template <class Point, class Accessor>
+    int InsertBatch(const Point *p, int n, Accessor)
+    {
+        int grew = 0;
+        for (int i = 0; i < n; i++) {
+            grew += Insert(Accessor::X(p[i]), Accessor::Y(p[i])) ? 1 : 0;
+        }
+        Publish();
+        return grew;
+    }
+
+    int InsertBatch(const HullPointT<Scalar> *p, int n)
+    {
+        return InsertBatch(p, n, HullPointAccessor<Scalar>());
+    }
+
+    // Closed containment against the live chains, writer thread only
+    bool Contains(Scalar x, Scalar y) const
+    {
+        return upper.Covers(x, y) && lower.Covers(x, -y);
+    }
+
+    // Current hull in counter-clockwise order, writer thread only
+    void Vertices(std::vector<HullPointT<Scalar> > *out) const
+    {
+        out->clear();
+        if (upper.Size() == 0) {
+            return;
+        }
+        for (typename HullChain<Scalar>::const_iterator i = lower.begin(); i != lower.end(); ++i) {
+            out->push_back(MakeHullPoint<Scalar>(i->first, -i->second));
+        }
+        typename HullChain<Scalar>::const_iterator i = upper.end();
+        do {
+            --i;
+            AppendDistinct(MakeHullPoint<Scalar>(i->first, i->second), out);
+        } while (i != upper.begin());
+        if (out->size() > 1 && out->back().x == (*out)[0].x && out->back().y == (*out)[0].y) {
+            out->pop_back();
+        }
+    }
+
+    // Make the current hull visible to readers. Cheap when nothing changed.
+    void Publish()
+    {
+        if (!changed && Snapshot()->inserted == inserted) {
+            return;
+        }
+        std::shared_ptr<OnlineHullSnapshot<Scalar> > next(new OnlineHullSnapshot<Scalar>());
+        Vertices(&next->vertices);
+        next->inserted = inserted;
+        published.Store(std::shared_ptr<const OnlineHullSnapshot<Scalar> >(next));
+        changed = false;
+    }
+
+    // Last published hull, from any thread
+    std::shared_ptr<const OnlineHullSnapshot<Scalar> > Snapshot() const
+    {
+        return published.Load();
+    }
+
+    void Clear()
+    {
+        upper.Clear();
+        lower.Clear();
+        inserted = 0;
+        changed = true;
+        Publish();
+    }
+
+    uint64_t Inserted() const { return inserted; }
+
+private:
+    static void AppendDistinct(HullPointT<Scalar> p, std::vector<HullPointT<Scalar> > *out)
+    {
+        if (out->empty() || out->back().x != p.x || out->back().y != p.y) {
+            out->push_back(p);
+        }
+    }
+
+    HullChain<Scalar>                                   upper;
+    HullChain<Scalar>                                   lower;
+    uint64_t                                            inserted;
+    bool                                                changed;
+    AtomicSharedPtr<const OnlineHullSnapshot<Scalar> >  published;
+};
+
+#endif
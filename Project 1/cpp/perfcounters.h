@@ -0,0 +1,273 @@
+#ifndef _PERFCOUNTERS_H
+#define _PERFCOUNTERS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "stageprofile.h"
+
+// Hardware counters around the geometry kernels, from Linux perf_event_open.
+//
+// Define GEOMETRY_PERF_COUNTERS to turn it on. PERF_SCOPE then reads this
+// thread's counters at the start and end of its block and adds the
+// difference to the block's stage; elsewhere, or with it off, PERF_SCOPE
+// expands to nothing. The counters are opened once per thread as one group,
+// so they are scheduled together and read with a single system call, and
+// only user-space work is counted.
+//
+// A counter the machine does not have (virtual machines often have none) or
+// that perf_event_paranoid forbids is reported as unavailable rather than
+// as zero. When the kernel multiplexes the group, counts are scaled by the
+// fraction of time it was running.
+
+enum PerfCounter
+{
+    PerfCycles,
+    PerfInstructions,
+    PerfL1Misses,       // L1 data cache read misses
+    PerfLLCMisses,      // Last-level cache misses
+    PerfBranchMisses,
+    PerfCounterCount
+};
+
+inline const char *perfCounterName(int counter)
+{
+    static const char *names[] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+    return counter >= 0 && counter < PerfCounterCount ? names[counter] : "unknown";
+}
+
+struct PerfSample
+{
+    uint64_t    values[PerfCounterCount];
+};
+
+// Per-stage sums over every thread
+struct PerfStageTotals
+{
+    std::atomic<uint64_t>   calls;
+    std::atomic<uint64_t>   values[PerfCounterCount];
+};
+
+inline PerfStageTotals *perfStageTotals()
+{
+    static PerfStageTotals totals[ProfileStageCount] = {};
+    return totals;
+}
+
+// Counters that opened on some thread, one bit per PerfCounter
+inline std::atomic<uint32_t> &perfAvailable()
+{
+    static std::atomic<uint32_t> available(0);
+    return available;
+}
+
+#ifdef __linux__
+
+// One thread's counter group
+class PerfCounterGroup
+{
+public:
+    PerfCounterGroup() : leader(-1), open(0)
+    {
+        static const uint64_t configs[PerfCounterCount] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        static const uint32_t types[PerfCounterCount] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+        };
+        for (int c = 0; c < PerfCounterCount; c++) {
+            fds[c] = -1;
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[c];
+            attr.config = configs[c];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[c] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fds[c] < 0) {
+                continue;
+            }
+            leader = leader < 0 ? fds[c] : leader;
+            order[open++] = c;
+        }
+        uint32_t bits = 0;
+        for (int k = 0; k < open; k++) {
+            bits |= 1u << order[k];
+        }
+        perfAvailable().fetch_or(bits);
+    }
+
+    ~PerfCounterGroup()
+    {
+        for (int c = 0; c < PerfCounterCount; c++) {
+            if (fds[c] >= 0) {
+                close(fds[c]);
+            }
+        }
+    }
+
+    bool Valid() const { return leader >= 0; }
+
+    // Every counter in the group, scaled for multiplexing; counters that did
+    // not open read as zero
+    bool Read(PerfSample *sample) const
+    {
+        uint64_t data[3 + PerfCounterCount];
+        ssize_t want = static_cast<ssize_t>((3 + open) * sizeof(uint64_t));
+        if (leader < 0 || read(leader, data, sizeof(data)) < want || data[0] != static_cast<uint64_t>(open)) {
+            return false;
+        }
+        double scale = data[2] > 0 && data[2] < data[1] ? static_cast<double>(data[1]) / data[2] : 1.0;
+        memset(sample, 0, sizeof(PerfSample));
+        for (int k = 0; k < open; k++) {
+            sample->values[order[k]] = static_cast<uint64_t>(data[3 + k] * scale);
+        }
+        return true;
+    }
+
+private:
+    int     fds[PerfCounterCount];
+    int     order[PerfCounterCount];    // Counter of each group member, in read order
+    int     leader;
+    int     open;
+};
+
+inline const PerfCounterGroup *perfThreadCounters()
+{
+    static thread_local PerfCounterGroup group;
+    return group.Valid() ? &group : NULL;
+}
+
+// Counts its scope as one call of a stage
+class PerfScope
+{
+public:
+    explicit PerfScope(ProfileStage stage) : stage(stage), group(perfThreadCounters())
+    {
+        if (group != NULL && !group->Read(&start)) {
+            group = NULL;
+        }
+    }
+
+    ~PerfScope()
+    {
+        PerfSample end;
+        if (group == NULL || !group->Read(&end)) {
+            return;
+        }
+        PerfStageTotals &t = perfStageTotals()[stage];
+        t.calls.fetch_add(1, std::memory_order_relaxed);
+        for (int c = 0; c < PerfCounterCount; c++) {
+            uint64_t delta = end.values[c] > start.values[c] ? end.values[c] - start.values[c] : 0;
+            t.values[c].fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    ProfileStage                stage;
+    const PerfCounterGroup      *group;
+    PerfSample                  start;
+};
+
+#endif
+
+// One line per stage that was counted: calls, each counter per call (or n/a
+// if unavailable), and instructions per cycle
+inline void printPerfCounters(FILE *f)
+{
+    uint32_t available = perfAvailable().load();
+    fprintf(f, "%-16s %10s", "stage", "calls");
+    for (int c = 0; c < PerfCounterCount; c++) {
+        fprintf(f, " %14s", perfCounterName(c));
+    }
+    fprintf(f, " %8s\n", "ipc");
+    for (int s = 0; s < ProfileStageCount; s++) {
+        const PerfStageTotals &t = perfStageTotals()[s];
+        uint64_t calls = t.calls.load();
+        if (calls == 0) {
+            continue;
+        }
+        fprintf(f, "%-16s %10llu", profileStageName(s), static_cast<unsigned long long>(calls));
+        for (int c = 0; c < PerfCounterCount; c++) {
+            if (available & (1u << c)) {
+                fprintf(f, " %14.1f", static_cast<double>(t.values[c].load()) / calls);
+            }
+            else {
+                fprintf(f, " %14s", "n/a");
+            }
+        }
+        uint64_t cycles = t.values[PerfCycles].load();
+        if ((available & 3u) == 3u && cycles > 0) {
+            fprintf(f, " %8.2f\n", static_cast<double>(t.values[PerfInstructions].load()) / cycles);
+        }
+        else {
+            fprintf(f, " %8s\n", "n/a");
+        }
+    }
+    if (available == 0) {
+        fprintf(f, "no hardware counters: not Linux, no PMU, or perf_event_paranoid too high\n");
+    }
+}
+
+// The same totals as JSON: per stage the call count and, for each available
+// counter, the total and per-call value. Returns false if the file could not
+// be written.
+inline bool writePerfCounters(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    uint32_t available = perfAvailable().load();
+    fprintf(f, "{\n  \"available\": [");
+    bool first = true;
+    for (int c = 0; c < PerfCounterCount; c++) {
+        if (available & (1u << c)) {
+            fprintf(f, "%s\"%s\"", first ? "" : ", ", perfCounterName(c));
+            first = false;
+        }
+    }
+    fprintf(f, "],\n  \"stages\": [");
+    first = true;
+    for (int s = 0; s < ProfileStageCount; s++) {
+        const PerfStageTotals &t = perfStageTotals()[s];
+        uint64_t calls = t.calls.load();
+        if (calls == 0) {
+            continue;
+        }
+        fprintf(f, "%s\n    {\"stage\": \"%s\", \"calls\": %llu", first ? "" : ",", profileStageName(s), static_cast<unsigned long long>(calls));
+        for (int c = 0; c < PerfCounterCount; c++) {
+            if (available & (1u << c)) {
+                uint64_t v = t.values[c].load();
+                fprintf(f, ", \"%s\": %llu, \"%s_per_call\": %.3f", perfCounterName(c), static_cast<unsigned long long>(v),
+                    perfCounterName(c), static_cast<double>(v) / calls);
+            }
+        }
+        fprintf(f, "}");
+        first = false;
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+#if defined(GEOMETRY_PERF_COUNTERS) && defined(__linux__)
+#define PERF_SCOPE(name, stage)     PerfScope name(stage)
+#else
+#define PERF_SCOPE(name, stage)
+#endif
+
+#endif
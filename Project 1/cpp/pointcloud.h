@@ -0,0 +1,511 @@
+#ifndef _POINTCLOUD_H
+#define _POINTCLOUD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hull2d.h"
+#include "hullshard.h"
+
+// Binary point clouds that are used in place from a memory-mapped file.
+//
+// All fields are little-endian and every block starts on a 64-byte boundary,
+// so once mapped the blocks are ready-made arrays and nothing is parsed:
+// opening costs a header check however large the file, and only the pages a
+// kernel touches are ever read. Points are stored sorted by group, so a group
+// is one contiguous range of each block.
+//
+// Header, 64 bytes:
+//    0  4  magic "PCLD"
+//    4  2  version (1)
+//    6  1  scalar kind as in HullSummaryKind: 0 float, 1 double, 2 int32
+//    7  1  zero
+//    8  8  point count n
+//   16  4  group count g
+//   20  4  zero
+//   24  8  offset of the x block, n scalars
+//   32  8  offset of the y block, n scalars
+//   40  8  offset of the group id block, n uint32
+//   48  8  offset of the group index, g PointCloudGroup entries
+//   56  8  file size
+//
+// The format is mapped as is, so big-endian hosts can neither read nor
+// write it.
+
+const uint32_t  kPointCloudMagic = 0x444C4350;
+const uint16_t  kPointCloudVersion = 1;
+const uint64_t  kPointCloudHeader = 64;
+const uint64_t  kPointCloudAlign = 64;
+const int       kPointCloudChunk = 65536;
+
+// Group index entry, 48 bytes: the group's range of the blocks and its
+// bounding box
+struct PointCloudGroup
+{
+    uint64_t    first;
+    uint64_t    count;
+    double      minX;
+    double      minY;
+    double      maxX;
+    double      maxY;
+};
+
+inline bool hostLittleEndian()
+{
+    const uint16_t one = 1;
+    uint8_t low;
+    memcpy(&low, &one, 1);
+    return low == 1;
+}
+
+inline uint64_t pointCloudAlign(uint64_t offset)
+{
+    return (offset + kPointCloudAlign - 1) / kPointCloudAlign * kPointCloudAlign;
+}
+
+inline bool pointCloudWrite(FILE *f, const void *data, size_t bytes, uint64_t *offset)
+{
+    *offset += bytes;
+    return bytes == 0 || fwrite(data, 1, bytes, f) == bytes;
+}
+
+// Zero padding up to the next block
+inline bool pointCloudPad(FILE *f, uint64_t *offset)
+{
+    static const uint8_t zeros[kPointCloudAlign] = { 0 };
+    return pointCloudWrite(f, zeros, static_cast<size_t>(pointCloudAlign(*offset) - *offset), offset);
+}
+
+// One block of n elements taken through order (NULL for as they are),
+// gathered a chunk at a time
+template <class T>
+inline bool pointCloudWriteBlock(FILE *f, const T *data, const uint64_t *order, uint64_t n, uint64_t *offset)
+{
+    if (order == NULL) {
+        return pointCloudWrite(f, data, static_cast<size_t>(n * sizeof(T)), offset) && pointCloudPad(f, offset);
+    }
+    std::vector<T> buffer(kPointCloudChunk);
+    for (uint64_t start = 0; start < n; start += kPointCloudChunk) {
+        size_t m = static_cast<size_t>(n - start < kPointCloudChunk ? n - start : kPointCloudChunk);
+        for (size_t i = 0; i < m; i++) {
+            buffer[i] = data[order[start + i]];
+        }
+        if (!pointCloudWrite(f, &buffer[0], m * sizeof(T), offset)) {
+            return false;
+        }
+    }
+    return pointCloudPad(f, offset);
+}
+
+// A group id block of n zeros, written from one chunk-sized buffer
+inline bool pointCloudWriteZeros(FILE *f, uint64_t n, uint64_t *offset)
+{
+    std::vector<uint32_t> zeros(static_cast<size_t>(n < kPointCloudChunk ? n : kPointCloudChunk), 0);
+    for (uint64_t start = 0; start < n; start += kPointCloudChunk) {
+        size_t m = static_cast<size_t>(n - start < kPointCloudChunk ? n - start : kPointCloudChunk);
+        if (!pointCloudWrite(f, &zeros[0], m * sizeof(uint32_t), offset)) {
+            return false;
+        }
+    }
+    return pointCloudPad(f, offset);
+}
+
+// Write n points with their group ids (NULL puts everything in group 0).
+// Points already sorted by group are written straight through; otherwise a
+// counting sort orders them first. Returns false on any I/O error, and for a
+// group id of UINT32_MAX, which would leave no room for the group count.
+template <class Scalar>
+inline bool writePointCloud(const char *path, const Scalar *xs, const Scalar *ys, const uint32_t *groups, uint64_t n)
+{
+    if (!hostLittleEndian()) {
+        return false;
+    }
+
+    uint32_t groupCount = n > 0 ? 1 : 0;
+    bool sorted = true;
+    for (uint64_t i = 0; i < n && groups != NULL; i++) {
+        if (groups[i] == UINT32_MAX) {
+            return false;
+        }
+        groupCount = groups[i] >= groupCount ? groups[i] + 1 : groupCount;
+        sorted = sorted && (i == 0 || groups[i - 1] <= groups[i]);
+    }
+
+    std::vector<PointCloudGroup> index(groupCount);
+    for (uint32_t g = 0; g < groupCount; g++) {
+        index[g].first = 0;
+        index[g].count = 0;
+        index[g].minX = index[g].minY = 0.0;
+        index[g].maxX = index[g].maxY = 0.0;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        PointCloudGroup &e = index[groups != NULL ? groups[i] : 0];
+        double x = static_cast<double>(xs[i]);
+        double y = static_cast<double>(ys[i]);
+        if (e.count == 0) {
+            e.minX = e.maxX = x;
+            e.minY = e.maxY = y;
+        }
+        e.minX = x < e.minX ? x : e.minX;
+        e.minY = y < e.minY ? y : e.minY;
+        e.maxX = x > e.maxX ? x : e.maxX;
+        e.maxY = y > e.maxY ? y : e.maxY;
+        e.count++;
+    }
+    uint64_t next = 0;
+    for (uint32_t g = 0; g < groupCount; g++) {
+        index[g].first = next;
+        next += index[g].count;
+    }
+
+    std::vector<uint64_t> order;
+    if (!sorted) {
+        order.resize(static_cast<size_t>(n));
+        std::vector<uint64_t> fill(groupCount);
+        for (uint32_t g = 0; g < groupCount; g++) {
+            fill[g] = index[g].first;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            order[static_cast<size_t>(fill[groups[i]]++)] = i;
+        }
+    }
+    uint64_t xOffset = kPointCloudHeader;
+    uint64_t yOffset = pointCloudAlign(xOffset + n * sizeof(Scalar));
+    uint64_t groupOffset = pointCloudAlign(yOffset + n * sizeof(Scalar));
+    uint64_t indexOffset = pointCloudAlign(groupOffset + n * sizeof(uint32_t));
+    uint64_t fileSize = indexOffset + groupCount * sizeof(PointCloudGroup);
+
+    uint8_t header[kPointCloudHeader] = { 0 };
+    putLE(kPointCloudMagic, 4, header);
+    putLE(kPointCloudVersion, 2, header + 4);
+    header[6] = static_cast<uint8_t>(HullSummaryKind<Scalar>::Value);
+    putLE(n, 8, header + 8);
+    putLE(groupCount, 4, header + 16);
+    putLE(xOffset, 8, header + 24);
+    putLE(yOffset, 8, header + 32);
+    putLE(groupOffset, 8, header + 40);
+    putLE(indexOffset, 8, header + 48);
+    putLE(fileSize, 8, header + 56);
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    const uint64_t *o = order.empty() ? NULL : &order[0];
+    uint64_t offset = 0;
+    bool ok = pointCloudWrite(f, header, sizeof(header), &offset);
+    ok = ok && pointCloudWriteBlock(f, xs, o, n, &offset);
+    ok = ok && pointCloudWriteBlock(f, ys, o, n, &offset);
+    ok = ok && (groups != NULL ? pointCloudWriteBlock(f, groups, o, n, &offset) : pointCloudWriteZeros(f, n, &offset));
+    ok = ok && pointCloudWrite(f, index.empty() ? NULL : &index[0], index.size() * sizeof(PointCloudGroup), &offset);
+    ok = ok && offset == fileSize;
+    return fclose(f) == 0 && ok;
+}
+
+// Read-only mapping of a point cloud file
+class PointCloudFile
+{
+public:
+    PointCloudFile() : base(NULL), size(0)
+    {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+
+    ~PointCloudFile() { Close(); }
+
+    // Map the file and check its header and layout; false if it is not a
+    // point cloud this build can use
+    bool Open(const char *path)
+    {
+        Close();
+        if (!hostLittleEndian() || !Map(path)) {
+            return false;
+        }
+        if (!Valid()) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (base != NULL) {
+            UnmapViewOfFile(base);
+        }
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        if (base != NULL) {
+            munmap(const_cast<uint8_t *>(base), static_cast<size_t>(size));
+        }
+#endif
+        base = NULL;
+        size = 0;
+    }
+
+    bool IsOpen() const { return base != NULL; }
+    int Kind() const { return base[6]; }
+    uint64_t Count() const { return getLE(base + 8, 8); }
+    uint32_t GroupCount() const { return static_cast<uint32_t>(getLE(base + 16, 4)); }
+    uint64_t Bytes() const { return size; }
+
+    // Coordinate blocks, or NULL if the file holds another scalar kind
+    template <class Scalar>
+    const Scalar *X() const
+    {
+        return Kind() == HullSummaryKind<Scalar>::Value ? reinterpret_cast<const Scalar *>(base + getLE(base + 24, 8)) : NULL;
+    }
+
+    template <class Scalar>
+    const Scalar *Y() const
+    {
+        return Kind() == HullSummaryKind<Scalar>::Value ? reinterpret_cast<const Scalar *>(base + getLE(base + 32, 8)) : NULL;
+    }
+
+    const uint32_t *GroupIds() const { return reinterpret_cast<const uint32_t *>(base + getLE(base + 40, 8)); }
+    const PointCloudGroup &Group(uint32_t g) const { return reinterpret_cast<const PointCloudGroup *>(base + getLE(base + 48, 8))[g]; }
+
+private:
+    PointCloudFile(const PointCloudFile &);
+    PointCloudFile &operator=(const PointCloudFile &);
+
+    bool Map(const char *path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        LARGE_INTEGER length;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || static_cast<uint64_t>(length.QuadPart) < kPointCloudHeader) {
+            Close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        base = mapping != NULL ? static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+        size = static_cast<uint64_t>(length.QuadPart);
+#else
+        int fd = open(path, O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < kPointCloudHeader) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+        size = static_cast<uint64_t>(info.st_size);
+        void *view = mmap(NULL, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        base = view != MAP_FAILED ? static_cast<const uint8_t *>(view) : NULL;
+#endif
+        if (base == NULL) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // Header fields against the file's real size, every block aligned and in
+    // bounds, and every group range inside the point count
+    bool Valid() const
+    {
+        if (getLE(base, 4) != kPointCloudMagic || getLE(base + 4, 2) != kPointCloudVersion || Kind() > 2 || base[7] != 0) {
+            return false;
+        }
+        uint64_t n = Count();
+        uint64_t g = GroupCount();
+        uint64_t scalar = Kind() == 1 ? 8 : 4;
+        if (getLE(base + 56, 8) != size || n > size / 4) {
+            return false;
+        }
+        if (!Block(24, n * scalar) || !Block(32, n * scalar) || !Block(40, n * 4) || g > size / sizeof(PointCloudGroup) || !Block(48, g * sizeof(PointCloudGroup))) {
+            return false;
+        }
+        for (uint32_t i = 0; i < g; i++) {
+            const PointCloudGroup &e = Group(i);
+            if (e.first > n || e.count > n - e.first) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Block(int field, uint64_t bytes) const
+    {
+        uint64_t offset = getLE(base + field, 8);
+        return offset >= kPointCloudHeader && offset % kPointCloudAlign == 0 && offset <= size && bytes <= size - offset;
+    }
+
+    const uint8_t   *base;
+    uint64_t        size;
+#ifdef _WIN32
+    HANDLE          file;
+    HANDLE          mapping;
+#endif
+};
+
+// Replace points by their hull vertices in counter-clockwise order
+template <class Scalar>
+inline void hullVerticesOf(std::vector<HullPointT<Scalar> > *points, std::vector<int> *index)
+{
+    convexHull(points->empty() ? NULL : &(*points)[0], static_cast<int>(points->size()), index);
+    std::vector<HullPointT<Scalar> > hull(index->size());
+    for (size_t i = 0; i < index->size(); i++) {
+        hull[i] = (*points)[(*index)[i]];
+    }
+    points->swap(hull);
+}
+
+// Hull of n structure-of-arrays points in one sequential pass, so a mapped
+// file is read front to back once. Each chunk first updates the eight
+// extremes along x, y and the diagonals; points strictly inside their
+// octagon cannot be hull vertices and are dropped, which on most inputs is
+// nearly all of them. Survivors are re-hulled whenever they pile up, so
+// memory stays near the hull size.
+template <class Scalar>
+inline void streamHull(const Scalar *xs, const Scalar *ys, uint64_t n, std::vector<HullPointT<Scalar> > *hull)
+{
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+    hull->clear();
+    if (n == 0) {
+        return;
+    }
+
+    HullPointT<Scalar> extreme[8];
+    for (int j = 0; j < 8; j++) {
+        extreme[j] = MakeHullPoint<Scalar>(xs[0], ys[0]);
+    }
+    std::vector<HullPointT<Scalar> > candidates;
+    std::vector<HullPointT<Scalar> > octagon;
+    std::vector<int> index;
+    size_t limit = 4 * kPointCloudChunk;
+
+    for (uint64_t start = 0; start < n; start += kPointCloudChunk) {
+        int m = static_cast<int>(n - start < kPointCloudChunk ? n - start : kPointCloudChunk);
+        const Scalar *x = xs + start;
+        const Scalar *y = ys + start;
+        for (int i = 0; i < m; i++) {
+            HullPointT<Scalar> p = MakeHullPoint<Scalar>(x[i], y[i]);
+            Wide sum = static_cast<Wide>(p.x) + p.y;
+            Wide diff = static_cast<Wide>(p.x) - p.y;
+            extreme[0] = p.x < extreme[0].x ? p : extreme[0];
+            extreme[1] = sum < static_cast<Wide>(extreme[1].x) + extreme[1].y ? p : extreme[1];
+            extreme[2] = p.y < extreme[2].y ? p : extreme[2];
+            extreme[3] = diff > static_cast<Wide>(extreme[3].x) - extreme[3].y ? p : extreme[3];
+            extreme[4] = p.x > extreme[4].x ? p : extreme[4];
+            extreme[5] = sum > static_cast<Wide>(extreme[5].x) + extreme[5].y ? p : extreme[5];
+            extreme[6] = p.y > extreme[6].y ? p : extreme[6];
+            extreme[7] = diff < static_cast<Wide>(extreme[7].x) - extreme[7].y ? p : extreme[7];
+        }
+
+        convexHull(extreme, 8, &index);
+        octagon.clear();
+        for (size_t j = 0; j < index.size(); j++) {
+            octagon.push_back(extreme[index[j]]);
+        }
+        int k = static_cast<int>(octagon.size());
+        for (int i = 0; i < m; i++) {
+            bool inside = k >= 3;
+            for (int j = 0; j < k && inside; j++) {
+                const HullPointT<Scalar> &a = octagon[j];
+                const HullPointT<Scalar> &b = octagon[j + 1 < k ? j + 1 : 0];
+                inside = orientWide<Wide>(a.x, a.y, b.x, b.y, x[i], y[i]) > 0;
+            }
+            if (!inside) {
+                candidates.push_back(MakeHullPoint<Scalar>(x[i], y[i]));
+            }
+        }
+
+        if (candidates.size() > limit) {
+            hullVerticesOf(&candidates, &index);
+            limit = 2 * candidates.size() + 4 * kPointCloudChunk;
+        }
+    }
+    hullVerticesOf(&candidates, &index);
+    hull->swap(candidates);
+}
+
+// Hull of one group of a mapped cloud, reading only that group's pages
+template <class Scalar>
+inline bool pointCloudHull(const PointCloudFile &cloud, uint32_t g, std::vector<HullPointT<Scalar> > *hull)
+{
+    if (cloud.X<Scalar>() == NULL || g >= cloud.GroupCount()) {
+        return false;
+    }
+    const PointCloudGroup &e = cloud.Group(g);
+    streamHull(cloud.X<Scalar>() + e.first, cloud.Y<Scalar>() + e.first, e.count, hull);
+    return true;
+}
+
+// Minkowski sum (or difference, sign -1) of the hulls of two groups
+template <class Scalar>
+inline bool pointCloudMinkowski(const PointCloudFile &cloud, uint32_t a, uint32_t b, int sign, std::vector<HullPointT<Scalar> > *out)
+{
+    std::vector<HullPointT<Scalar> > ha;
+    std::vector<HullPointT<Scalar> > hb;
+    out->clear();
+    if (!pointCloudHull(cloud, a, &ha) || !pointCloudHull(cloud, b, &hb)) {
+        return false;
+    }
+    if (!ha.empty() && !hb.empty()) {
+        minkowskiMerge(&ha[0], static_cast<int>(ha.size()), &hb[0], static_cast<int>(hb.size()), sign, out, HullPointAccessor<Scalar>());
+    }
+    return true;
+}
+
+// Containment of every point of group g in a counter-clockwise hull, one
+// flag per point in group order. A group whose bounding box misses the
+// hull's is answered from the index without touching its pages.
+template <class Scalar>
+inline bool pointCloudContains(const PointCloudFile &cloud, uint32_t g, const HullPointT<Scalar> *hull, int n, std::vector<uint8_t> *inside)
+{
+    if (cloud.X<Scalar>() == NULL || g >= cloud.GroupCount()) {
+        return false;
+    }
+    const PointCloudGroup &e = cloud.Group(g);
+    inside->assign(static_cast<size_t>(e.count), 0);
+    if (n == 0 || e.count == 0) {
+        return true;
+    }
+    double minX = static_cast<double>(hull[0].x), maxX = minX;
+    double minY = static_cast<double>(hull[0].y), maxY = minY;
+    for (int i = 1; i < n; i++) {
+        double x = static_cast<double>(hull[i].x);
+        double y = static_cast<double>(hull[i].y);
+        minX = x < minX ? x : minX;
+        maxX = x > maxX ? x : maxX;
+        minY = y < minY ? y : minY;
+        maxY = y > maxY ? y : maxY;
+    }
+    if (e.maxX < minX || e.minX > maxX || e.maxY < minY || e.minY > maxY) {
+        return true;
+    }
+    const Scalar *xs = cloud.X<Scalar>() + e.first;
+    const Scalar *ys = cloud.Y<Scalar>() + e.first;
+    for (uint64_t start = 0; start < e.count; start += kPointCloudChunk) {
+        int m = static_cast<int>(e.count - start < kPointCloudChunk ? e.count - start : kPointCloudChunk);
+        hullContainsBatch(hull, n, xs + start, ys + start, m, &(*inside)[static_cast<size_t>(start)]);
+    }
+    return true;
+}
+
+#endif
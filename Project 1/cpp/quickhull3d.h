@@ -0,0 +1,552 @@
+#ifndef _QUICKHULL3D_H
+#define _QUICKHULL3D_H
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "geometry.h"
+
+// 3D QuickHull producing a half-edge (DCEL) mesh.
+//
+// While the hull is being built every face is a triangle and face f owns
+// half-edges 3f, 3f+1 and 3f+2, so next/prev/face are plain arithmetic and
+// all state lives in flat arrays. Points outside a face are kept in that
+// face's conflict list, an intrusive linked list threaded through pointNext.
+// Each step takes the farthest conflict point of a face as the eye, walks the
+// faces it can see to collect the horizon in order, and fans new triangles
+// from the eye to the horizon. Points within the plane tolerance count as on
+// the face, and once the hull is complete adjacent coplanar triangles are
+// merged into polygonal faces.
+
+const float kHullMergeMinCos = 0.0f;
+
+struct HullHalfEdge
+{
+    int vertex;     // Origin vertex
+    int twin;
+    int next;
+    int face;
+};
+
+struct HullFace
+{
+    int     edge;   // First half-edge of the face loop
+    Vec3    normal; // Outward unit normal
+    float   offset; // dot(normal, p) for points on the face
+};
+
+struct HalfEdgeMesh
+{
+    std::vector<Vec3>           vertices;
+    std::vector<int>            vertexEdge;     // One outgoing half-edge per vertex
+    std::vector<HullHalfEdge>   edges;
+    std::vector<HullFace>       faces;
+
+    void Clear()
+    {
+        vertices.clear();
+        vertexEdge.clear();
+        edges.clear();
+        faces.clear();
+    }
+};
+
+// Reusable builder; keeping one around avoids reallocating the working arrays
+// between hulls
+class QuickHull3D
+{
+public:
+    // Negative tolerances are derived from the extent of the input
+    float   distanceTolerance;
+    float   mergeTolerance;
+
+    QuickHull3D() : distanceTolerance(-1.0f), mergeTolerance(-1.0f), points(NULL), eps(0), stamp(0) {}
+
+    // Returns false if the input has fewer than four points or is flat
+    bool Build(const Vec3 *points, int n, HalfEdgeMesh *mesh);
+
+private:
+    struct Face
+    {
+        double  nx, ny, nz;
+        double  offset;
+        int     outside;        // Head of the conflict list, -1 if empty
+        int     farthest;
+        double  farthestDist;
+        int     mark;
+        bool    alive;
+    };
+
+    struct Frame
+    {
+        int edge;
+        int remaining;
+    };
+
+    static int NextEdge(int e) { return (e % 3 == 2) ? e - 2 : e + 1; }
+
+    double Distance(int f, int p) const
+    {
+        const Face &face = faces[f];
+        return face.nx * points[p].x + face.ny * points[p].y + face.nz * points[p].z - face.offset;
+    }
+
+    bool InitialSimplex(int n, int *simplex);
+    int  NewFace(int a, int b, int c);
+    void AddConflict(int f, int p, double dist);
+    void AssignPoint(int p, const int *candidates, int count);
+    void ComputeHorizon(int f, int eye);
+    void AddPoint(int f);
+    void BuildMesh(int n, HalfEdgeMesh *mesh);
+
+    const Vec3          *points;
+    double              eps;
+    double              mergeEps;
+    int                 stamp;
+
+    std::vector<int>    edgeVertex;
+    std::vector<int>    edgeTwin;
+    std::vector<Face>   faces;
+    std::vector<int>    freeFaces;
+    std::vector<int>    pending;
+    std::vector<int>    pointNext;
+
+    std::vector<int>    visible;
+    std::vector<int>    horizon;
+    std::vector<int>    horizonA;
+    std::vector<int>    horizonB;
+    std::vector<int>    horizonTwin;
+    std::vector<Frame>  stack;
+    std::vector<int>    orphans;
+    std::vector<int>    newFaces;
+
+    std::vector<int>    region;
+    std::vector<int>    queue;
+    std::vector<int>    vertexMap;
+    std::vector<int>    edgeOut;
+};
+
+inline int QuickHull3D::NewFace(int a, int b, int c)
+{
+    int f;
+    if (!freeFaces.empty()) {
+        f = freeFaces.back();
+        freeFaces.pop_back();
+    }
+    else {
+        f = static_cast<int>(faces.size());
+        faces.push_back(Face());
+        edgeVertex.resize(3 * faces.size());
+        edgeTwin.resize(3 * faces.size());
+    }
+
+    edgeVertex[3 * f] = a;
+    edgeVertex[3 * f + 1] = b;
+    edgeVertex[3 * f + 2] = c;
+    edgeTwin[3 * f] = edgeTwin[3 * f + 1] = edgeTwin[3 * f + 2] = -1;
+
+    const Vec3 &pa = points[a];
+    const Vec3 &pb = points[b];
+    const Vec3 &pc = points[c];
+    double ux = (double)pb.x - pa.x, uy = (double)pb.y - pa.y, uz = (double)pb.z - pa.z;
+    double vx = (double)pc.x - pa.x, vy = (double)pc.y - pa.y, vz = (double)pc.z - pa.z;
+    double nx = uy * vz - uz * vy;
+    double ny = uz * vx - ux * vz;
+    double nz = ux * vy - uy * vx;
+    double len = sqrt(nx * nx + ny * ny + nz * nz);
+    if (len > 0.0) {
+        nx /= len;
+        ny /= len;
+        nz /= len;
+    }
+
+    Face &face = faces[f];
+    face.nx = nx;
+    face.ny = ny;
+    face.nz = nz;
+    face.offset = nx * pa.x + ny * pa.y + nz * pa.z;
+    face.outside = -1;
+    face.farthest = -1;
+    face.farthestDist = 0.0;
+    face.mark = 0;
+    face.alive = true;
+    return f;
+}
+
+inline void QuickHull3D::AddConflict(int f, int p, double dist)
+{
+    Face &face = faces[f];
+    if (face.outside == -1) {
+        pending.push_back(f);
+    }
+    pointNext[p] = face.outside;
+    face.outside = p;
+    if (face.farthest == -1 || dist > face.farthestDist) {
+        face.farthest = p;
+        face.farthestDist = dist;
+    }
+}
+
+// Put p in the conflict list of the candidate face it is farthest above, or
+// drop it if it is inside all of them
+inline void QuickHull3D::AssignPoint(int p, const int *candidates, int count)
+{
+    int best = -1;
+    double bestDist = eps;
+    for (int i = 0; i < count; i++) {
+        double dist = Distance(candidates[i], p);
+        if (dist > bestDist) {
+            best = candidates[i];
+            bestDist = dist;
+        }
+    }
+    if (best != -1) {
+        AddConflict(best, p, bestDist);
+    }
+}
+
+inline bool QuickHull3D::InitialSimplex(int n, int *simplex)
+{
+    // Two extreme points along the axis with the largest extent
+    int minIndex[3] = { 0, 0, 0 };
+    int maxIndex[3] = { 0, 0, 0 };
+    for (int i = 1; i < n; i++) {
+        const float *p = &points[i].x;
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < (&points[minIndex[k]].x)[k]) minIndex[k] = i;
+            if (p[k] > (&points[maxIndex[k]].x)[k]) maxIndex[k] = i;
+        }
+    }
+    int axis = 0;
+    double extent = -1.0;
+    for (int k = 0; k < 3; k++) {
+        double temp = (double)(&points[maxIndex[k]].x)[k] - (&points[minIndex[k]].x)[k];
+        if (temp > extent) {
+            axis = k;
+            extent = temp;
+        }
+    }
+    if (extent <= eps) {
+        return false;
+    }
+    int a = minIndex[axis];
+    int b = maxIndex[axis];
+
+    // Farthest point from the line ab
+    Vec3 ab = points[b] - points[a];
+    int c = -1;
+    double maxDist = 0.0;
+    for (int i = 0; i < n; i++) {
+        double dist = lengthSq(cross(points[i] - points[a], ab));
+        if (dist > maxDist) {
+            c = i;
+            maxDist = dist;
+        }
+    }
+    if (c == -1 || sqrt(maxDist) / sqrt(lengthSq(ab)) <= eps) {
+        return false;
+    }
+
+    // Farthest point from the plane abc
+    Vec3 normal = cross(ab, points[c] - points[a]);
+    float len = length(normal);
+    normal = normal * (1.0f / len);
+    int d = -1;
+    maxDist = 0.0;
+    double signedDist = 0.0;
+    for (int i = 0; i < n; i++) {
+        double dist = dot(points[i] - points[a], normal);
+        if (fabs(dist) > maxDist) {
+            d = i;
+            maxDist = fabs(dist);
+            signedDist = dist;
+        }
+    }
+    if (d == -1 || maxDist <= eps) {
+        return false;
+    }
+
+    // Orient the base so d is behind it
+    if (signedDist > 0.0) {
+        int temp = b;
+        b = c;
+        c = temp;
+    }
+    simplex[0] = a;
+    simplex[1] = b;
+    simplex[2] = c;
+    simplex[3] = d;
+    return true;
+}
+
+// Depth-first walk over the faces visible from the eye, starting at f. The
+// recursion order yields the horizon edges as one closed loop.
+inline void QuickHull3D::ComputeHorizon(int f, int eye)
+{
+    visible.clear();
+    horizon.clear();
+    stack.clear();
+
+    stamp++;
+    faces[f].mark = stamp;
+    visible.push_back(f);
+    Frame root = { 3 * f, 3 };
+    stack.push_back(root);
+
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        if (frame.remaining == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int e = frame.edge;
+        frame.edge = NextEdge(e);
+        frame.remaining--;
+
+        int twin = edgeTwin[e];
+        int g = twin / 3;
+        if (faces[g].mark == stamp) {
+            continue;
+        }
+        if (Distance(g, eye) > eps) {
+            faces[g].mark = stamp;
+            visible.push_back(g);
+            Frame child = { NextEdge(twin), 2 };
+            stack.push_back(child);
+        }
+        else {
+            horizon.push_back(e);
+        }
+    }
+}
+
+inline void QuickHull3D::AddPoint(int f)
+{
+    int eye = faces[f].farthest;
+    ComputeHorizon(f, eye);
+
+    // Pull the conflict points off the faces that are about to go
+    orphans.clear();
+    for (size_t i = 0; i < visible.size(); i++) {
+        Face &face = faces[visible[i]];
+        for (int p = face.outside; p != -1; p = pointNext[p]) {
+            if (p != eye) {
+                orphans.push_back(p);
+            }
+        }
+        face.alive = false;
+        face.outside = -1;
+    }
+
+    size_t h = horizon.size();
+    horizonA.resize(h);
+    horizonB.resize(h);
+    horizonTwin.resize(h);
+    for (size_t i = 0; i < h; i++) {
+        int e = horizon[i];
+        horizonA[i] = edgeVertex[e];
+        horizonB[i] = edgeVertex[NextEdge(e)];
+        horizonTwin[i] = edgeTwin[e];
+    }
+    for (size_t i = 0; i < visible.size(); i++) {
+        freeFaces.push_back(visible[i]);
+    }
+
+    // Fan of new triangles (a, b, eye), one per horizon edge a->b
+    newFaces.resize(h);
+    for (size_t i = 0; i < h; i++) {
+        int nf = NewFace(horizonA[i], horizonB[i], eye);
+        edgeTwin[3 * nf] = horizonTwin[i];
+        edgeTwin[horizonTwin[i]] = 3 * nf;
+        newFaces[i] = nf;
+    }
+    for (size_t i = 0; i < h; i++) {
+        int e = 3 * newFaces[i] + 1;
+        int t = 3 * newFaces[(i + 1) % h] + 2;
+        edgeTwin[e] = t;
+        edgeTwin[t] = e;
+    }
+
+    for (size_t i = 0; i < orphans.size(); i++) {
+        AssignPoint(orphans[i], &newFaces[0], static_cast<int>(h));
+    }
+}
+
+inline bool QuickHull3D::Build(const Vec3 *input, int n, HalfEdgeMesh *mesh)
+{
+    mesh->Clear();
+    if (n < 4) {
+        return false;
+    }
+
+    points = input;
+    faces.clear();
+    freeFaces.clear();
+    pending.clear();
+    edgeVertex.clear();
+    edgeTwin.clear();
+    pointNext.assign(n, -1);
+    stamp = 0;
+
+    double maxX = 0.0, maxY = 0.0, maxZ = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (fabs(input[i].x) > maxX) maxX = fabs(input[i].x);
+        if (fabs(input[i].y) > maxY) maxY = fabs(input[i].y);
+        if (fabs(input[i].z) > maxZ) maxZ = fabs(input[i].z);
+    }
+    eps = distanceTolerance >= 0.0f ? distanceTolerance : 3.0 * FLT_EPSILON * (maxX + maxY + maxZ);
+    mergeEps = mergeTolerance >= 0.0f ? mergeTolerance : 4.0 * eps;
+
+    int s[4];
+    if (!InitialSimplex(n, s)) {
+        return false;
+    }
+
+    // Base (a, b, c) faces away from d; each side reuses a base edge reversed
+    int initial[4];
+    initial[0] = NewFace(s[0], s[1], s[2]);
+    initial[1] = NewFace(s[1], s[0], s[3]);
+    initial[2] = NewFace(s[2], s[1], s[3]);
+    initial[3] = NewFace(s[0], s[2], s[3]);
+    for (int e = 0; e < 12; e++) {
+        for (int t = 0; t < 12; t++) {
+            if (edgeVertex[e] == edgeVertex[NextEdge(t)] && edgeVertex[NextEdge(e)] == edgeVertex[t]) {
+                edgeTwin[e] = t;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (i != s[0] && i != s[1] && i != s[2] && i != s[3]) {
+            AssignPoint(i, initial, 4);
+        }
+    }
+
+    while (!pending.empty()) {
+        int f = pending.back();
+        pending.pop_back();
+        if (faces[f].alive && faces[f].outside != -1) {
+            AddPoint(f);
+        }
+    }
+
+    BuildMesh(n, mesh);
+    return true;
+}
+
+// Merge coplanar triangles into polygon faces and write the compact mesh.
+// Regions grow from a seed triangle and only take neighbours whose vertices
+// lie within the merge tolerance of the seed plane, so the tolerance cannot
+// accumulate across a gently curved surface.
+inline void QuickHull3D::BuildMesh(int n, HalfEdgeMesh *mesh)
+{
+    size_t faceCount = faces.size();
+    region.assign(faceCount, -1);
+    int regionCount = 0;
+
+    for (size_t seed = 0; seed < faceCount; seed++) {
+        if (!faces[seed].alive || region[seed] != -1) {
+            continue;
+        }
+        const Face &plane = faces[seed];
+        region[seed] = regionCount;
+        queue.clear();
+        queue.push_back(static_cast<int>(seed));
+        for (size_t q = 0; q < queue.size(); q++) {
+            int f = queue[q];
+            for (int k = 0; k < 3; k++) {
+                int g = edgeTwin[3 * f + k] / 3;
+                if (region[g] != -1) {
+                    continue;
+                }
+                const Face &other = faces[g];
+                if (plane.nx * other.nx + plane.ny * other.ny + plane.nz * other.nz <= kHullMergeMinCos) {
+                    continue;
+                }
+                bool coplanar = true;
+                for (int j = 0; j < 3 && coplanar; j++) {
+                    const Vec3 &p = points[edgeVertex[3 * g + j]];
+                    double dist = plane.nx * p.x + plane.ny * p.y + plane.nz * p.z - plane.offset;
+                    coplanar = fabs(dist) <= mergeEps;
+                }
+                if (coplanar) {
+                    region[g] = regionCount;
+                    queue.push_back(g);
+                }
+            }
+        }
+        regionCount++;
+    }
+
+    // Walk the boundary of every region to emit one polygon per loop
+    vertexMap.assign(n, -1);
+    edgeOut.assign(3 * faceCount, -1);
+    for (size_t f = 0; f < faceCount; f++) {
+        if (!faces[f].alive) {
+            continue;
+        }
+        int r = region[f];
+        for (int k = 0; k < 3; k++) {
+            int start = 3 * static_cast<int>(f) + k;
+            if (edgeOut[start] != -1 || region[edgeTwin[start] / 3] == r) {
+                continue;
+            }
+
+            int outFace = static_cast<int>(mesh->faces.size());
+            int first = static_cast<int>(mesh->edges.size());
+            double nx = 0.0, ny = 0.0, nz = 0.0;
+            double cx = 0.0, cy = 0.0, cz = 0.0;
+            int e = start;
+            do {
+                int v = edgeVertex[e];
+                if (vertexMap[v] == -1) {
+                    vertexMap[v] = static_cast<int>(mesh->vertices.size());
+                    mesh->vertices.push_back(points[v]);
+                    mesh->vertexEdge.push_back(static_cast<int>(mesh->edges.size()));
+                }
+                edgeOut[e] = static_cast<int>(mesh->edges.size());
+                HullHalfEdge out = { vertexMap[v], -1, static_cast<int>(mesh->edges.size()) + 1, outFace };
+                mesh->edges.push_back(out);
+
+                // Next boundary edge: rotate about the head vertex through
+                // triangles that belong to the same region
+                int next = NextEdge(e);
+                while (region[edgeTwin[next] / 3] == r) {
+                    next = NextEdge(edgeTwin[next]);
+                }
+
+                // Newell's method for the polygon normal
+                const Vec3 &p = points[v];
+                const Vec3 &q = points[edgeVertex[next]];
+                nx += ((double)p.y - q.y) * ((double)p.z + q.z);
+                ny += ((double)p.z - q.z) * ((double)p.x + q.x);
+                nz += ((double)p.x - q.x) * ((double)p.y + q.y);
+                cx += p.x;
+                cy += p.y;
+                cz += p.z;
+                e = next;
+            } while (e != start);
+            mesh->edges.back().next = first;
+
+            int count = static_cast<int>(mesh->edges.size()) - first;
+            double len = sqrt(nx * nx + ny * ny + nz * nz);
+            HullFace face;
+            face.edge = first;
+            face.normal = MakeVec3((float)(nx / len), (float)(ny / len), (float)(nz / len));
+            face.offset = (float)((nx * cx + ny * cy + nz * cz) / (len * count));
+            mesh->faces.push_back(face);
+        }
+    }
+
+    for (size_t f = 0; f < faceCount; f++) {
+        for (int k = 0; k < 3; k++) {
+            int e = 3 * static_cast<int>(f) + k;
+            if (edgeOut[e] != -1) {
+                mesh->edges[edgeOut[e]].twin = edgeOut[edgeTwin[e]];
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef _RAYCAST_H
+#define _RAYCAST_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "narrowphase.h"
+
+// Ray and swept-circle queries against convex polygons, and a bounding volume
+// hierarchy over a ShapeSet that casts many rays at once.
+//
+// A ray is origin + t * dir for t in [0, maxT]. dir need not be unit length;
+// times are in multiples of it. Polygons are counter-clockwise.
+
+const int   kRayPacketSize = 16;
+const int   kBVHLeafSize = 4;
+const int   kBVHMaxDepth = 64;
+const float kRayHuge = 1e30f;
+
+struct RayHit
+{
+    float   time;
+    Vec2    normal;
+};
+
+// Ray against a convex polygon by clipping it to each edge's half-plane
+// (Cyrus-Beck). The entering edge gives the outward unit normal. A ray that
+// starts inside hits at time 0 with a zero normal.
+inline bool rayConvex(const Vec2 *p, int n, Vec2 origin, Vec2 dir, float maxT, RayHit *hit)
+{
+    if (n < 3) {
+        return false;
+    }
+
+    float enter = 0.0f;
+    float exit = maxT;
+    Vec2 normal = MakeVec2(0.0f, 0.0f);
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        Vec2 e = p[i] - p[j];
+        Vec2 out = MakeVec2(e.y, -e.x);
+        float num = dot(out, p[j] - origin);
+        float den = dot(out, dir);
+        if (den == 0.0f) {
+            if (num < 0.0f) {
+                return false;
+            }
+            continue;
+        }
+        float t = num / den;
+        if (den < 0.0f) {
+            if (t > enter) {
+                enter = t;
+                normal = out;
+            }
+        }
+        else if (t < exit) {
+            exit = t;
+        }
+        if (enter > exit) {
+            return false;
+        }
+    }
+
+    float len = length(normal);
+    hit->time = enter;
+    hit->normal = len > 0.0f ? normal * (1.0f / len) : normal;
+    return true;
+}
+
+// Squared distance from q to segment ab
+inline float segmentDistSq(Vec2 q, Vec2 a, Vec2 b)
+{
+    float t;
+    return lengthSq(closestOnSegment(a - q, b - q, &t));
+}
+
+// Circle of the given radius whose center moves along the ray. That is the
+// center ray against the polygon grown by the radius: every edge pushed out
+// along its normal, joined by a circle around every vertex. Works on points
+// and segments too. A circle that starts in contact hits at time 0 with a
+// zero normal.
+inline bool circleCastConvex(const Vec2 *p, int n, Vec2 origin, float radius, Vec2 dir, float maxT, RayHit *hit)
+{
+    if (n <= 0) {
+        return false;
+    }
+
+    // Already touching
+    bool inside = n >= 3;
+    float nearest = lengthSq(p[0] - origin);
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        if (n >= 3 && cross(p[i] - p[j], origin - p[j]) < 0.0f) {
+            inside = false;
+        }
+        float d = segmentDistSq(origin, p[j], p[i]);
+        if (d < nearest) {
+            nearest = d;
+        }
+    }
+    if (inside || nearest <= radius * radius) {
+        hit->time = 0.0f;
+        hit->normal = MakeVec2(0.0f, 0.0f);
+        return true;
+    }
+
+    float best = maxT;
+    bool found = false;
+    Vec2 normal = MakeVec2(0.0f, 0.0f);
+
+    // Pushed-out edges, front faces only
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        Vec2 e = p[i] - p[j];
+        float len = length(e);
+        if (len == 0.0f) {
+            continue;
+        }
+        Vec2 u = MakeVec2(e.y / len, -e.x / len);
+        float den = dot(u, dir);
+        if (den >= 0.0f) {
+            continue;
+        }
+        float t = (dot(u, origin - p[j]) - radius) / -den;
+        if (t < 0.0f || t > best) {
+            continue;
+        }
+        float s = dot(origin + dir * t - p[j], e);
+        if (s >= 0.0f && s <= len * len) {
+            best = t;
+            normal = u;
+            found = true;
+        }
+    }
+
+    // Vertex circles
+    float a = dot(dir, dir);
+    for (int i = 0; i < n && a > 0.0f; i++) {
+        Vec2 m = origin - p[i];
+        float b = dot(m, dir);
+        float c = dot(m, m) - radius * radius;
+        if (b >= 0.0f) {
+            continue;
+        }
+        float disc = b * b - a * c;
+        if (disc < 0.0f) {
+            continue;
+        }
+        float t = (-b - sqrtf(disc)) / a;
+        Vec2 toCenter = m + dir * t;
+        float len = length(toCenter);
+        if (t >= 0.0f && t <= best && len > 0.0f) {
+            best = t;
+            normal = toCenter * (1.0f / len);
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+    hit->time = best;
+    hit->normal = normal;
+    return true;
+}
+
+// Nearest hit per ray in structure-of-arrays form; shape is -1 for a miss
+struct RayHits
+{
+    std::vector<int>    shape;
+    std::vector<float>  time;
+    std::vector<float>  normalX;
+    std::vector<float>  normalY;
+
+    void Resize(size_t n)
+    {
+        shape.resize(n);
+        time.resize(n);
+        normalX.resize(n);
+        normalY.resize(n);
+    }
+
+    size_t Size() const { return shape.size(); }
+};
+
+// Leaves hold count > 0 shapes starting at order[start]; inner nodes have
+// count 0 and their children at start and start + 1, the lower half along
+// axis first
+struct BVHNode
+{
+    float   minX;
+    float   minY;
+    float   maxX;
+    float   maxY;
+    int     start;
+    int     count;
+    int     axis;
+};
+
+// Bounding volume hierarchy over the shapes of a ShapeSet, split at the
+// median of the longer axis. Rays go through it in packets of
+// kRayPacketSize: each node is slab-tested against the whole packet in one
+// branch-free loop, and is entered if any ray in the packet still reaches
+// it, so coherent rays share the traversal.
+class ShapeBVH
+{
+public:
+    void Build(const ShapeSet &shapes)
+    {
+        int n = static_cast<int>(shapes.Size());
+        bounds.resize(4 * n);
+        order.resize(n);
+        for (int s = 0; s < n; s++) {
+            const Vec2 *p = shapes.Points(s);
+            float b[4] = { p[0].x, p[0].y, p[0].x, p[0].y };
+            for (int i = 1; i < shapes.count[s]; i++) {
+                b[0] = p[i].x < b[0] ? p[i].x : b[0];
+                b[1] = p[i].y < b[1] ? p[i].y : b[1];
+                b[2] = p[i].x > b[2] ? p[i].x : b[2];
+                b[3] = p[i].y > b[3] ? p[i].y : b[3];
+            }
+            for (int k = 0; k < 4; k++) {
+                bounds[4 * s + k] = b[k];
+            }
+            order[s] = s;
+        }
+
+        nodes.clear();
+        if (n == 0) {
+            return;
+        }
+        nodes.reserve(2 * n);
+        nodes.resize(1);
+        BuildNode(0, 0, n, 0);
+    }
+
+    // Nearest hit for each of count rays; a positive radius sweeps a circle
+    // instead. hits must already be sized for count entries.
+    void CastRays(const ShapeSet &shapes, const float *ox, const float *oy, const float *dx, const float *dy, int count,
+        float radius, float maxT, RayHits *hits) const
+    {
+        for (int k = 0; k < count; k++) {
+            hits->shape[k] = -1;
+            hits->time[k] = maxT;
+            hits->normalX[k] = 0.0f;
+            hits->normalY[k] = 0.0f;
+        }
+        if (nodes.empty()) {
+            return;
+        }
+
+        // Packets only pay off when their rays take similar paths, so group
+        // rays by direction quadrant and then by origin along a Morton curve
+        // over the root box
+        const BVHNode &root = nodes[0];
+        float scaleX = root.maxX > root.minX ? 255.0f / (root.maxX - root.minX) : 0.0f;
+        float scaleY = root.maxY > root.minY ? 255.0f / (root.maxY - root.minY) : 0.0f;
+        std::vector<std::pair<uint32_t, int> > rays(count);
+        for (int k = 0; k < count; k++) {
+            uint32_t cx = RayCell(ox[k], root.minX, scaleX);
+            uint32_t cy = RayCell(oy[k], root.minY, scaleY);
+            uint32_t quadrant = (dx[k] < 0.0f ? 2u : 0u) | (dy[k] < 0.0f ? 1u : 0u);
+            rays[k] = std::make_pair((quadrant << 16) | (SpreadBits(cx) << 1) | SpreadBits(cy), k);
+        }
+        std::sort(rays.begin(), rays.end());
+
+        for (int base = 0; base < count; base += kRayPacketSize) {
+            int m = count - base < kRayPacketSize ? count - base : kRayPacketSize;
+            int index[kRayPacketSize];
+            float px[kRayPacketSize];
+            float py[kRayPacketSize];
+            float pdx[kRayPacketSize];
+            float pdy[kRayPacketSize];
+            float best[kRayPacketSize];
+            float invX[kRayPacketSize];
+            float invY[kRayPacketSize];
+            int active[kRayPacketSize];
+            for (int k = 0; k < m; k++) {
+                int r = rays[base + k].second;
+                index[k] = r;
+                px[k] = ox[r];
+                py[k] = oy[r];
+                pdx[k] = dx[r];
+                pdy[k] = dy[r];
+                best[k] = maxT;
+                invX[k] = pdx[k] != 0.0f ? 1.0f / pdx[k] : kRayHuge;
+                invY[k] = pdy[k] != 0.0f ? 1.0f / pdy[k] : kRayHuge;
+            }
+
+            int stack[kBVHMaxDepth * 2];
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const BVHNode &node = nodes[stack[--top]];
+
+                // Slab test across the packet, with the box grown by the radius
+                int any = 0;
+                for (int k = 0; k < m; k++) {
+                    float x1 = (node.minX - radius - px[k]) * invX[k];
+                    float x2 = (node.maxX + radius - px[k]) * invX[k];
+                    float y1 = (node.minY - radius - py[k]) * invY[k];
+                    float y2 = (node.maxY + radius - py[k]) * invY[k];
+                    float nearX = x1 < x2 ? x1 : x2;
+                    float farX = x1 < x2 ? x2 : x1;
+                    float nearY = y1 < y2 ? y1 : y2;
+                    float farY = y1 < y2 ? y2 : y1;
+                    float enter = nearX > nearY ? nearX : nearY;
+                    float exit = farX < farY ? farX : farY;
+                    enter = enter > 0.0f ? enter : 0.0f;
+                    exit = exit < best[k] ? exit : best[k];
+                    active[k] = enter <= exit;
+                    any |= active[k];
+                }
+                if (!any) {
+                    continue;
+                }
+
+                // Near child first; the packet shares a direction quadrant,
+                // so its first ray speaks for all of them
+                if (node.count == 0) {
+                    float d = node.axis == 0 ? pdx[0] : pdy[0];
+                    int nearChild = d >= 0.0f ? node.start : node.start + 1;
+                    stack[top++] = node.start + node.start + 1 - nearChild;
+                    stack[top++] = nearChild;
+                    continue;
+                }
+
+                for (int i = node.start; i < node.start + node.count; i++) {
+                    int s = order[i];
+                    const Vec2 *p = shapes.Points(s);
+                    int n = shapes.count[s];
+                    for (int k = 0; k < m; k++) {
+                        if (!active[k]) {
+                            continue;
+                        }
+                        Vec2 origin = MakeVec2(px[k], py[k]);
+                        Vec2 dir = MakeVec2(pdx[k], pdy[k]);
+                        RayHit hit;
+                        bool found = radius > 0.0f ? circleCastConvex(p, n, origin, radius, dir, best[k], &hit) :
+                            rayConvex(p, n, origin, dir, best[k], &hit);
+                        int r = index[k];
+                        if (found && (hits->shape[r] < 0 || hit.time < best[k])) {
+                            best[k] = hit.time;
+                            hits->shape[r] = s;
+                            hits->time[r] = hit.time;
+                            hits->normalX[r] = hit.normal.x;
+                            hits->normalY[r] = hit.normal.y;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    size_t NodeCount() const { return nodes.size(); }
+
+private:
+    // Origin cell on a 256 x 256 grid, clamped for rays that start outside
+    static uint32_t RayCell(float v, float lo, float scale)
+    {
+        float c = (v - lo) * scale;
+        c = c > 0.0f ? c : 0.0f;
+        c = c < 255.0f ? c : 255.0f;
+        return static_cast<uint32_t>(c);
+    }
+
+    // Interleave the low 8 bits with zeros for a Morton code
+    static uint32_t SpreadBits(uint32_t v)
+    {
+        v = (v | (v << 4)) & 0x0F0Fu;
+        v = (v | (v << 2)) & 0x3333u;
+        v = (v | (v << 1)) & 0x5555u;
+        return v;
+    }
+
+    void BuildNode(int index, int start, int count, int depth)
+    {
+        float b[4] = { kRayHuge, kRayHuge, -kRayHuge, -kRayHuge };
+        for (int i = start; i < start + count; i++) {
+            const float *s = &bounds[4 * order[i]];
+            b[0] = s[0] < b[0] ? s[0] : b[0];
+            b[1] = s[1] < b[1] ? s[1] : b[1];
+            b[2] = s[2] > b[2] ? s[2] : b[2];
+            b[3] = s[3] > b[3] ? s[3] : b[3];
+        }
+        nodes[index].minX = b[0];
+        nodes[index].minY = b[1];
+        nodes[index].maxX = b[2];
+        nodes[index].maxY = b[3];
+
+        if (count <= kBVHLeafSize || depth >= kBVHMaxDepth - 1) {
+            nodes[index].start = start;
+            nodes[index].count = count;
+            nodes[index].axis = 0;
+            return;
+        }
+
+        // Median split on box centers along the longer axis
+        int axis = b[2] - b[0] >= b[3] - b[1] ? 0 : 1;
+        const std::vector<float> &box = bounds;
+        int half = count / 2;
+        std::nth_element(order.begin() + start, order.begin() + start + half, order.begin() + start + count,
+            [&box, axis](int l, int r) { return box[4 * l + axis] + box[4 * l + axis + 2] < box[4 * r + axis] + box[4 * r + axis + 2]; });
+
+        int child = static_cast<int>(nodes.size());
+        nodes.resize(child + 2);
+        nodes[index].start = child;
+        nodes[index].count = 0;
+        nodes[index].axis = axis;
+        BuildNode(child, start, half, depth + 1);
+        BuildNode(child + 1, start + half, count - half, depth + 1);
+    }
+
+    std::vector<BVHNode>    nodes;
+    std::vector<int>        order;
+    std::vector<float>      bounds;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _RECOMPUTE_H
+#define _RECOMPUTE_H
+
+#include <chrono>
+#include <stdint.h>
+
+// Paces recomputation of the hulls behind the drawing.
+//
+// Edits to the scene (a dragged point, a key) are reported to the scheduler
+// instead of invalidating the caches. They pile up as one pending change,
+// and a recompute of all of them starts at most once per display interval;
+// between recomputes the last completed result is drawn. The first edit
+// after a quiet interval is recomputed at once, and whoever drives the
+// scheduler arms a timer for Wait so the last edit of a drag is never left
+// pending.
+//
+// Recomputes run where the caller runs them, on the thread that draws, so
+// the scheduler only limits how often they happen. Edits made before a
+// recompute begins are covered by it; later ones wait for the next slot.
+//
+// Times are microseconds on any clock the caller likes. The window passes
+// recomputeClock(); a replay passes the trace's own timestamps, which makes
+// the schedule exact and repeatable without a window.
+
+const int64_t   kRecomputeInterval = 16667;     // One 60 Hz display frame, in microseconds
+
+inline int64_t recomputeClock()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class RecomputeScheduler
+{
+public:
+    explicit RecomputeScheduler(int64_t interval = kRecomputeInterval) : interval(interval), started(false), lastBegin(0),
+        oldest(0), pending(0), edits(0), runs(0), coalesced(0)
+    {
+    }
+
+    void SetInterval(int64_t us) { interval = us; }
+    int64_t Interval() const { return interval; }
+
+    // An edit at time now
+    void Edit(int64_t now)
+    {
+        oldest = pending == 0 ? now : oldest;
+        pending++;
+        edits++;
+    }
+
+    bool Pending() const { return pending > 0; }
+
+    // When the oldest pending edit was made
+    int64_t Oldest() const { return oldest; }
+
+    // Whether a recompute should start now: edits are pending and the last
+    // recompute began at least one interval ago
+    bool Due(int64_t now) const
+    {
+        return pending > 0 && (!started || now - lastBegin >= interval);
+    }
+
+    // Microseconds until Due, 0 if due now, -1 with nothing pending
+    int64_t Wait(int64_t now) const
+    {
+        if (pending == 0) {
+            return -1;
+        }
+        int64_t left = started ? lastBegin + interval - now : 0;
+        return left > 0 ? left : 0;
+    }
+
+    // A recompute of every edit so far starts now
+    void Begin(int64_t now)
+    {
+        started = true;
+        lastBegin = now;
+        coalesced += pending > 1 ? pending - 1 : 0;
+        pending = 0;
+        runs++;
+    }
+
+    uint64_t Edits() const { return edits; }
+    uint64_t Runs() const { return runs; }
+    uint64_t Coalesced() const { return coalesced; }   // Edits folded into another edit's recompute
+
+private:
+    int64_t     interval;
+    bool        started;        // Any recompute has begun
+    int64_t     lastBegin;
+    int64_t     oldest;
+    uint64_t    pending;        // Edits since the last Begin
+    uint64_t    edits;
+    uint64_t    runs;
+    uint64_t    coalesced;
+};
+
+#endif
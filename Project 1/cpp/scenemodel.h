@@ -0,0 +1,594 @@
+#ifndef _SCENEMODEL_H
+#define _SCENEMODEL_H
+
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+#include "allocaccount.h"
+#include "calipers.h"
+#include "geometry.h"
+#include "hull2d.h"
+#include "intersection2d.h"
+#include "narrowphase.h"
+#include "perfcounters.h"
+#include "scenesnapshot.h"
+#include "stageprofile.h"
+
+// The window's scene and its computations without Direct2D or Win32.
+//
+// SceneModel holds the points, view, screen, drag offsets and cached hulls.
+// MainWindow owns one, forwards its input to it and draws what it computed,
+// so the window and a headless replay run the same code. Edits leave the
+// cached hulls as they were until the caller invalidates them: after every
+// event, or on the slots of a RecomputeScheduler. Update then does the work
+// for the current screen that the window draws. Replaying input through it
+// times the path from an event to an updated result on any platform. Its
+// containers take their memory through GeometryAllocator, so replays
+// account for it per stage.
+
+// The window's screens, as snapshots store them
+enum SceneScreen
+{
+    SceneMinkowskiSum,
+    SceneMinkowskiDifference,
+    SceneGJK,
+    SceneQuickHull,
+    ScenePointConvexHull
+};
+
+// Win32 virtual-key codes, so keys recorded by the window replay unchanged
+const uint32_t  kSceneKeyBack = 0x08;
+const uint32_t  kSceneKeyLeft = 0x25;
+const uint32_t  kSceneKeyUp = 0x26;
+const uint32_t  kSceneKeyRight = 0x27;
+const uint32_t  kSceneKeyDown = 0x28;
+const uint32_t  kSceneKeyDelete = 0x2E;
+const int       kSceneWheelDelta = 120;
+
+// Lets the hull2d kernels read scene points in place
+struct ScenePointAccessor
+{
+    typedef HullCoord Coord;
+
+    static HullCoord X(const ScenePoint &p) { return toHullCoord(p.x); }
+    static HullCoord Y(const ScenePoint &p) { return toHullCoord(p.y); }
+};
+
+class SceneModel
+{
+public:
+    SceneModel() : screen(SceneQuickHull), centerX(0.0f), centerY(0.0f), selection(-1), dragging(false), group(10),
+        mouseX(0.0f), mouseY(0.0f), edited(false), stale(false), cacheValid(false), impactValid(false), hull1BoxValid(false), inside(false)
+    {
+        view.screen = SceneQuickHull;
+        view.scale = 1.0f;
+        view.panX = view.panY = view.pivotX = view.pivotY = 0.0f;
+        ClearOffsets();
+    }
+
+    // Replace the scene, as the window's buttons and F9 do. Cached hulls in
+    // the snapshot are kept if it says they are valid.
+    void Load(const SceneSnapshot &scene)
+    {
+        view = scene.view;
+        screen = scene.view.screen >= SceneMinkowskiSum && scene.view.screen <= ScenePointConvexHull ? static_cast<SceneScreen>(scene.view.screen) : SceneQuickHull;
+        centerX = scene.view.centerX;
+        centerY = scene.view.centerY;
+        points.assign(scene.points.begin(), scene.points.end());
+        hull1.clear();
+        hull2.clear();
+        bool valid = scene.cacheValid;
+        for (size_t i = 0; i < scene.hull1.size() && valid; i++) {
+            valid = scene.hull1[i] >= 0 && static_cast<size_t>(scene.hull1[i]) < points.size();
+            hull1.push_back(valid ? points[scene.hull1[i]] : ScenePoint());
+        }
+        for (size_t i = 0; i < scene.hull2.size() && valid; i++) {
+            valid = scene.hull2[i] >= 0 && static_cast<size_t>(scene.hull2[i]) < points.size();
+            hull2.push_back(valid ? points[scene.hull2[i]] : ScenePoint());
+        }
+        hull4.assign(scene.derived.begin(), scene.derived.end());
+        hull1Index.clear();
+        hull2Index.clear();
+        ClearOffsets();
+        selection = -1;
+        dragging = false;
+        edited = false;
+        stale = false;
+        cacheValid = false;
+        impactValid = false;
+        hull1BoxValid = false;
+        if (valid) {
+            hull1Index.assign(scene.hull1.begin(), scene.hull1.end());
+            hull2Index.assign(scene.hull2.begin(), scene.hull2.end());
+            cacheValid = true;
+            hull1BoxValid = hull1.size() >= 3 && minAreaRect(&hull1[0], static_cast<int>(hull1.size()), &hull1Box, ScenePointAccessor());
+        }
+    }
+
+    // Flatten the scene with any pending drag offsets applied. The cached
+    // hulls are written as indices into the points, and marked valid only if
+    // no edit came after they were built.
+    void Capture(SceneSnapshot *scene) const
+    {
+        float mx, my;
+        MinkowskiOffset(&mx, &my);
+        scene->view = view;
+        scene->view.screen = screen;
+        scene->view.centerX = centerX;
+        scene->view.centerY = centerY;
+        scene->points.clear();
+        for (size_t i = 0; i < points.size(); i++) {
+            scene->points.push_back(points[i]);
+            scene->points.back().x += OffsetX(points[i].group);
+            scene->points.back().y += OffsetY(points[i].group);
+        }
+        scene->hull1.assign(hull1Index.begin(), hull1Index.end());
+        scene->hull2.assign(hull2Index.begin(), hull2Index.end());
+        scene->derived.clear();
+        for (size_t i = 0; i < hull4.size(); i++) {
+            scene->derived.push_back(hull4[i]);
+            scene->derived.back().x += mx;
+            scene->derived.back().y += my;
+        }
+        scene->cacheValid = cacheValid && !stale;
+    }
+
+    // Left button down at a view-space point: select the point under it, or
+    // start dragging a group or panning
+    void Pick(float viewX, float viewY)
+    {
+        float wx, wy;
+        ViewToWorld(viewX, viewY, &wx, &wy);
+        CommitOffsets();
+        selection = -1;
+        dragging = true;
+        for (int i = static_cast<int>(points.size()) - 1; i >= 0 && selection < 0; i--) {
+            float dx = wx - points[i].x;
+            float dy = wy - points[i].y;
+            if (points[i].radius > 0.0f && dx * dx + dy * dy <= points[i].radius * points[i].radius) {
+                selection = i;
+            }
+        }
+        if (selection >= 0) {
+            mouseX = points[selection].x - wx;
+            mouseY = points[selection].y - wy;
+            return;
+        }
+        mouseX = viewX;
+        mouseY = viewY;
+        if (Contains(hull1, wx, wy)) {
+            group = screen == SceneQuickHull ? 0 : 1;
+        }
+        else if (Contains(hull2, wx, wy)) {
+            group = 2;
+        }
+        else {
+            group = 10;
+        }
+    }
+
+    // Mouse move with the left button held
+    void Drag(float viewX, float viewY)
+    {
+        float wx, wy;
+        ViewToWorld(viewX, viewY, &wx, &wy);
+        float dx = (viewX - mouseX) / view.scale;
+        float dy = (viewY - mouseY) / view.scale;
+        if (selection >= 0) {
+            if (dragging) {
+                points[selection].x = wx + mouseX;
+                points[selection].y = wy + mouseY;
+                Edited();
+            }
+            return;
+        }
+        if (group == 0) {
+            ALLOC_FORBID(rigid);
+            for (int g = 0; g < 3; g++) {
+                offsetX[g] += dx;
+                offsetY[g] += dy;
+            }
+        }
+        else if (group == 1 || group == 2) {
+            Sweep(group, dx, dy);
+            offsetX[group] += dx;
+            offsetY[group] += dy;
+        }
+        else if (group == 10) {
+            ALLOC_FORBID(pan);
+            view.panX += viewX - mouseX;
+            view.panY += viewY - mouseY;
+        }
+        mouseX = viewX;
+        mouseY = viewY;
+    }
+
+    void Release()
+    {
+        if (dragging) {
+            CommitOffsets();
+            dragging = false;
+        }
+    }
+
+    void Wheel(int delta)
+    {
+        if (delta >= kSceneWheelDelta && view.scale < 4.0f) {
+            view.scale *= 2.0f;
+        }
+        else if (delta <= -kSceneWheelDelta && view.scale > 0.25f) {
+            view.scale *= 0.5f;
+        }
+    }
+
+    // Keys that edit the scene. Keys that replace it (new seeds, F9) are
+    // followed by a Load of the scene they produced.
+    void Key(uint32_t vkey)
+    {
+        if (dragging || selection < 0) {
+            return;
+        }
+        switch (vkey) {
+        case kSceneKeyBack:
+        case kSceneKeyDelete:
+            points.erase(points.begin() + selection);
+            selection = -1;
+            Edited();
+            break;
+
+        case kSceneKeyLeft:
+            Move(-1.0f, 0.0f);
+            break;
+
+        case kSceneKeyRight:
+            Move(1.0f, 0.0f);
+            break;
+
+        case kSceneKeyUp:
+            Move(0.0f, -1.0f);
+            break;
+
+        case kSceneKeyDown:
+            Move(0.0f, 1.0f);
+            break;
+        }
+    }
+
+    // What OnPaint draws for the current screen: the hulls and Minkowski
+    // result when an edit invalidated them, then the per-frame tests
+    void Update()
+    {
+        switch (screen) {
+        case SceneQuickHull:
+            if (!cacheValid) {
+                Hull(points, -1, static_cast<int>(points.size()), &hull1, &hull1Index);
+                hull2Index.clear();
+                STAGE_SCOPE(calipers, StageCalipers, hull1.size());
+                ALLOC_SCOPE(allocations, StageCalipers);
+                hull1BoxValid = hull1.size() >= 3 && minAreaRect(&hull1[0], static_cast<int>(hull1.size()), &hull1Box, ScenePointAccessor());
+                cacheValid = true;
+                stale = false;
+            }
+            break;
+
+        case SceneMinkowskiSum:
+        case SceneMinkowskiDifference:
+        case SceneGJK:
+            if (!cacheValid) {
+                Hull(points, 1, -1, &hull1, &hull1Index);
+                Hull(points, 2, -1, &hull2, &hull2Index);
+                GeometryVector<ScenePoint> hull3;
+                Minkowski(screen == SceneMinkowskiSum ? 1 : -1, &hull3);
+                STAGE_SCOPE(rehull, StageRehull, hull3.size());
+                ALLOC_SCOPE(allocations, StageRehull);
+                Hull(hull3, -1, static_cast<int>(hull3.size()), &hull4);
+                STAGE_HULL(rehull, hull4.size());
+                cacheValid = true;
+                stale = false;
+            }
+            if (screen == SceneGJK) {
+                float ox, oy;
+                MinkowskiOffset(&ox, &oy);
+                inside = Contains(hull4, centerX - ox, centerY - oy);
+                Intersect();
+            }
+            break;
+
+        case ScenePointConvexHull:
+            if (!cacheValid) {
+                Hull(points, 1, GroupCount(1) - 1, &hull1, &hull1Index);
+                hull2Index.clear();
+                cacheValid = true;
+                stale = false;
+            }
+            if (!points.empty()) {
+                const ScenePoint &p = points.back();
+                float px = p.x + OffsetX(p.group) - OffsetX(1);
+                float py = p.y + OffsetY(p.group) - OffsetY(1);
+                inside = Contains(hull1, px, py);
+            }
+            break;
+        }
+    }
+
+    // Whether the points were edited since the last call. The cached hulls
+    // stay as they were until Invalidate.
+    bool TakeEdits()
+    {
+        bool was = edited;
+        edited = false;
+        return was;
+    }
+
+    // Rebuild the cached hulls on the next Update
+    void Invalidate() { cacheValid = false; impactValid = false; }
+
+    bool Valid() const { return cacheValid; }
+    int Screen() const { return screen; }
+    size_t PointCount() const { return points.size(); }
+    const SceneView &View() const { return view; }
+    float CenterX() const { return centerX; }
+    float CenterY() const { return centerY; }
+
+    // The points and cached shapes, without the pending drag offsets. Draw
+    // each at the offset of its group, the Minkowski result at
+    // MinkowskiOffset, and the region at group 1's offset.
+    const GeometryVector<ScenePoint> &Points() const { return points; }
+    const GeometryVector<ScenePoint> &Hull1() const { return hull1; }
+    const GeometryVector<ScenePoint> &Hull2() const { return hull2; }
+    const GeometryVector<ScenePoint> &Result() const { return hull4; }
+    const GeometryVector<HullPointT<HullReal> > &Region() const { return region; }
+    bool BoxValid() const { return hull1BoxValid; }
+    const OrientedRect<HullReal> &Box() const { return hull1Box; }
+    bool Inside() const { return inside; }
+    bool ImpactValid() const { return impactValid; }
+    const TimeOfImpactResult &Impact() const { return impact; }
+
+    float OffsetX(int g) const { return g >= 0 && g <= 2 ? offsetX[g] : 0.0f; }
+    float OffsetY(int g) const { return g >= 0 && g <= 2 ? offsetY[g] : 0.0f; }
+
+    // Offset of the cached Minkowski result: the sum moves with both groups,
+    // the difference (group 2 minus group 1) with their relative offset
+    void MinkowskiOffset(float *x, float *y) const
+    {
+        float sign = screen == SceneMinkowskiSum ? 1.0f : -1.0f;
+        *x = offsetX[2] + sign * offsetX[1];
+        *y = offsetY[2] + sign * offsetY[1];
+    }
+
+private:
+    void ClearOffsets()
+    {
+        for (int g = 0; g < 3; g++) {
+            offsetX[g] = offsetY[g] = 0.0f;
+        }
+    }
+
+    void Edited() { edited = true; stale = true; impactValid = false; }
+
+    void ViewToWorld(float x, float y, float *wx, float *wy) const
+    {
+        *wx = (x - view.pivotX - view.panX) / view.scale + view.pivotX;
+        *wy = (y - view.pivotY - view.panY) / view.scale + view.pivotY;
+    }
+
+    void Move(float x, float y)
+    {
+        points[selection].x += x / view.scale;
+        points[selection].y += y / view.scale;
+        Edited();
+    }
+
+    // Write the drag offsets into the points. The cached hulls are copies,
+    // so they are shifted with their groups.
+    void CommitOffsets()
+    {
+        float mx, my;
+        MinkowskiOffset(&mx, &my);
+        hull1Box.center.x += toHullCoord(offsetX[1]);
+        hull1Box.center.y += toHullCoord(offsetY[1]);
+        Shift(&hull1, offsetX[1], offsetY[1]);
+        Shift(&hull2, offsetX[2], offsetY[2]);
+        Shift(&hull4, mx, my);
+        for (size_t i = 0; i < points.size(); i++) {
+            points[i].x += OffsetX(points[i].group);
+            points[i].y += OffsetY(points[i].group);
+        }
+        ClearOffsets();
+    }
+
+    static void Shift(GeometryVector<ScenePoint> *shape, float x, float y)
+    {
+        for (size_t i = 0; i < shape->size(); i++) {
+            (*shape)[i].x += x;
+            (*shape)[i].y += y;
+        }
+    }
+
+    int GroupCount(int g) const
+    {
+        int count = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            count += points[i].group == g ? 1 : 0;
+        }
+        return count;
+    }
+
+    static bool Contains(const GeometryVector<ScenePoint> &hull, float x, float y)
+    {
+        STAGE_SCOPE(contains, StageContains, hull.size());
+        ALLOC_SCOPE(allocations, StageContains);
+        ALLOC_FORBID(hot);
+        PERF_SCOPE(counters, StageContains);
+        return !hull.empty() && hullContains(&hull[0], static_cast<int>(hull.size()), toHullCoord(x), toHullCoord(y), ScenePointAccessor());
+    }
+
+    // QuickHull of the first n points of group g (all groups if g < 0, all
+    // of the group if n < 0), with no hull below 3 points. Vertices come back
+    // counter-clockwise, and source, if given, gets their indices in from.
+    static void Hull(const GeometryVector<ScenePoint> &from, int g, int n, GeometryVector<ScenePoint> *hull, GeometryVector<int32_t> *source = NULL)
+    {
+        GeometryVector<ScenePoint> input;
+        GeometryVector<int32_t> origin;
+        {
+            STAGE_SCOPE(partition, StagePartition, from.size());
+            ALLOC_SCOPE(allocations, StagePartition);
+            for (size_t i = 0; i < from.size(); i++) {
+                if (g < 0 || from[i].group == g) {
+                    input.push_back(from[i]);
+                    if (source != NULL) {
+                        origin.push_back(static_cast<int32_t>(i));
+                    }
+                }
+            }
+        }
+        n = n < 0 || n > static_cast<int>(input.size()) ? static_cast<int>(input.size()) : n;
+        hull->clear();
+        if (source != NULL) {
+            source->clear();
+        }
+        if (n < 3) {
+            return;
+        }
+        STAGE_SCOPE(quickhull, StageQuickHull, n);
+        ALLOC_SCOPE(allocations, StageQuickHull);
+        PERF_SCOPE(counters, StageQuickHull);
+        GeometryVector<int> index;
+        quickHull(&input[0], n, &index, ScenePointAccessor());
+        for (size_t i = 0; i < index.size(); i++) {
+            hull->push_back(input[index[i]]);
+            if (source != NULL) {
+                source->push_back(origin[index[i]]);
+            }
+        }
+        STAGE_HULL(quickhull, index.size());
+    }
+
+    static ScenePoint MakeScenePoint(float x, float y)
+    {
+        ScenePoint p = { x, y, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 3 };
+        return p;
+    }
+
+    // The Minkowski sum (sign 1) or difference (-1) of the two hulls,
+    // recentred on the axes. Both inputs are hulls, so the fixed-point build
+    // merges their edges instead of combining every pair.
+    void Minkowski(int sign, GeometryVector<ScenePoint> *out) const
+    {
+        STAGE_SCOPE(minkowski, StageMinkowski, hull1.size() + hull2.size());
+        ALLOC_SCOPE(allocations, StageMinkowski);
+        PERF_SCOPE(counters, StageMinkowski);
+        out->clear();
+#ifdef GEOMETRY_FIXED_POINT
+        const ScenePoint *a = hull1.empty() ? NULL : &hull1[0];
+        const ScenePoint *b = hull2.empty() ? NULL : &hull2[0];
+        GeometryVector<HullPoint> merged;
+        if (sign > 0) {
+            minkowskiSum(a, static_cast<int>(hull1.size()), b, static_cast<int>(hull2.size()), &merged, ScenePointAccessor());
+        }
+        else {
+            minkowskiDifference(a, static_cast<int>(hull1.size()), b, static_cast<int>(hull2.size()), &merged, ScenePointAccessor());
+        }
+        HullPoint center = MakeHullPoint(toHullCoord(centerX), toHullCoord(centerY));
+        for (size_t i = 0; i < merged.size(); i++) {
+            HullCoord x = sign > 0 ? merged[i].x - center.x : merged[i].x + center.x;
+            HullCoord y = sign > 0 ? merged[i].y - center.y : merged[i].y + center.y;
+            out->push_back(MakeScenePoint(fromHullCoord(x), fromHullCoord(y)));
+        }
+        STAGE_HULL(minkowski, out->size());
+#else
+        for (size_t i = 0; i < hull1.size(); i++) {
+            for (size_t j = 0; j < hull2.size(); j++) {
+                if (sign > 0) {
+                    out->push_back(MakeScenePoint(hull1[i].x + hull2[j].x - centerX, hull1[i].y + hull2[j].y - centerY));
+                }
+                else {
+                    out->push_back(MakeScenePoint(hull2[j].x - hull1[i].x + centerX, hull2[j].y - hull1[i].y + centerY));
+                }
+            }
+        }
+        STAGE_HULL(minkowski, out->size());
+#endif
+    }
+
+    // The region the two groups share, in group 1's frame
+    void Intersect()
+    {
+        ALLOC_SCOPE(allocations, StageIntersection);
+        GeometryVector<HullPoint> a, b;
+        for (size_t i = 0; i < hull1.size(); i++) {
+            a.push_back(MakeHullPoint(toHullCoord(hull1[i].x), toHullCoord(hull1[i].y)));
+        }
+        for (size_t i = 0; i < hull2.size(); i++) {
+            b.push_back(MakeHullPoint(toHullCoord(hull2[i].x + offsetX[2] - offsetX[1]), toHullCoord(hull2[i].y + offsetY[2] - offsetY[1])));
+        }
+        STAGE_SCOPE(intersection, StageIntersection, a.size() + b.size());
+        region.clear();
+        if (a.size() >= 3 && b.size() >= 3) {
+            convexIntersection(&a[0], static_cast<int>(a.size()), &b[0], static_cast<int>(b.size()), &region);
+        }
+        STAGE_HULL(intersection, region.size());
+    }
+
+    // Sweep group g's hull over one drag step against the other group's hull.
+    // The hulls are only tested at the end of each step, so a fast drag can
+    // jump clean through; the time of impact catches the contact the step
+    // passed over and keeps it for drawing.
+    void Sweep(int g, float dx, float dy)
+    {
+        if (screen != SceneGJK || !cacheValid || hull1.empty() || hull2.empty()) {
+            return;
+        }
+        STAGE_SCOPE(sweep, StageTimeOfImpact, hull1.size() + hull2.size());
+        ALLOC_SCOPE(allocations, StageTimeOfImpact);
+        PERF_SCOPE(counters, StageTimeOfImpact);
+        GeometryVector<Vec2> a, b;
+        for (size_t i = 0; i < hull1.size(); i++) {
+            a.push_back(MakeVec2(hull1[i].x + offsetX[1], hull1[i].y + offsetY[1]));
+        }
+        for (size_t i = 0; i < hull2.size(); i++) {
+            b.push_back(MakeVec2(hull2[i].x + offsetX[2], hull2[i].y + offsetY[2]));
+        }
+        Vec2 step = MakeVec2(dx, dy);
+        Vec2 still = MakeVec2(0.0f, 0.0f);
+        TimeOfImpactResult result;
+        gjkTimeOfImpact(&a[0], static_cast<int>(a.size()), g == 1 ? step : still,
+            &b[0], static_cast<int>(b.size()), g == 2 ? step : still, &result);
+        if (result.hit && result.time > 0.0f) {
+            impactValid = true;
+            impact = result;
+        }
+    }
+
+    SceneScreen                         screen;
+    SceneView                           view;
+    float                               centerX;
+    float                               centerY;
+    GeometryVector<ScenePoint>          points;
+    float                               offsetX[3];     // Pending drag offsets of groups 0-2
+    float                               offsetY[3];
+
+    int                                 selection;      // Index into points, or -1
+    bool                                dragging;
+    int                                 group;          // What a drag moves: 0 all, 1 or 2 a group, 10 the view
+    float                               mouseX;
+    float                               mouseY;
+
+    GeometryVector<ScenePoint>          hull1;
+    GeometryVector<ScenePoint>          hull2;
+    GeometryVector<ScenePoint>          hull4;          // Hull of the Minkowski result
+    GeometryVector<int32_t>             hull1Index;     // Indices of the hull vertices in points
+    GeometryVector<int32_t>             hull2Index;
+    OrientedRect<HullReal>              hull1Box;       // Minimum-area rectangle around hull1
+    bool                                edited;         // Points changed since TakeEdits
+    bool                                stale;          // Points changed since the hulls were built
+    bool                                cacheValid;
+    bool                                impactValid;
+    TimeOfImpactResult                  impact;
+    bool                                hull1BoxValid;
+    GeometryVector<HullPointT<HullReal> > region;
+    bool                                inside;
+};
+
+#endif
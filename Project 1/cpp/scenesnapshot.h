@@ -0,0 +1,418 @@
+#ifndef _SCENESNAPSHOT_H
+#define _SCENESNAPSHOT_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "pointcloud.h"
+
+// Binary scene snapshots: every point with its radius, colour and group, the
+// view, and the cached hulls, so a scene comes back without recomputing.
+//
+// A snapshot file is a log of frames. A full frame holds the whole scene and
+// starts a new file; a delta frame is appended after it and holds only the
+// points that differ from the previous frame, plus the small parts of the
+// scene (view, hull indices, derived points) in full. Loading reads the file
+// with one bulk read and replays the frames. A frame cut short by a crash
+// is ignored, leaving the scene as of the frame before.
+//
+// Frame header, 80 bytes, little-endian:
+//    0  4  magic "SCNF"
+//    4  2  version (1)
+//    6  1  kind: 0 full, 1 delta
+//    7  1  zero
+//    8  8  sequence number, one more than the previous frame's
+//   16  8  payload bytes
+//   24  4  point count after this frame
+//   28  4  hull 1 vertex count
+//   32  4  hull 2 vertex count
+//   36  4  derived point count
+//   40  4  stored point count: all of them, or the changed ones
+//   44  4  flags, bit 0 set if the cached hulls are valid
+//   48 32  SceneView
+// Payload: hull 1 and hull 2 as int32 point indices, the derived points, then
+// the stored points as ScenePoint (full) or SceneChange (delta) records.
+//
+// Records are written in the host layout, so like point clouds the files are
+// only written and read on little-endian hosts.
+
+const uint32_t  kSceneMagic = 0x464E4353;
+const uint16_t  kSceneVersion = 1;
+const size_t    kSceneFrameHeader = 80;
+const int       kSceneMaxDeltas = 16;
+
+struct ScenePoint
+{
+    float       x;
+    float       y;
+    float       radius;
+    float       r;
+    float       g;
+    float       b;
+    float       a;
+    int32_t     group;
+};
+
+struct SceneChange
+{
+    uint32_t    index;
+    ScenePoint  point;
+};
+
+struct SceneView
+{
+    int32_t     screen;
+    float       centerX;
+    float       centerY;
+    float       scale;
+    float       panX;
+    float       panY;
+    float       pivotX;
+    float       pivotY;
+};
+
+struct SceneSnapshot
+{
+    SceneView                   view;
+    std::vector<ScenePoint>     points;
+    std::vector<int32_t>        hull1;      // Indices into points
+    std::vector<int32_t>        hull2;
+    std::vector<ScenePoint>     derived;    // Points owned by a cache, such as a Minkowski hull
+    bool                        cacheValid;
+};
+
+inline bool scenePointEqual(const ScenePoint &a, const ScenePoint &b)
+{
+    return memcmp(&a, &b, sizeof(ScenePoint)) == 0;
+}
+
+template <class T>
+inline void sceneAppend(const std::vector<T> &items, std::vector<uint8_t> *out)
+{
+    if (!items.empty()) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(&items[0]);
+        out->insert(out->end(), p, p + items.size() * sizeof(T));
+    }
+}
+
+// Encode one frame. base is the scene as of the previous frame, or NULL for
+// a full frame.
+inline void encodeSceneFrame(const SceneSnapshot &scene, const SceneSnapshot *base, uint64_t sequence, std::vector<uint8_t> *out)
+{
+    std::vector<SceneChange> changes;
+    if (base != NULL) {
+        for (size_t i = 0; i < scene.points.size(); i++) {
+            if (i >= base->points.size() || !scenePointEqual(scene.points[i], base->points[i])) {
+                SceneChange c = { static_cast<uint32_t>(i), scene.points[i] };
+                changes.push_back(c);
+            }
+        }
+    }
+
+    out->assign(kSceneFrameHeader, 0);
+    uint8_t *h = &(*out)[0];
+    putLE(kSceneMagic, 4, h);
+    putLE(kSceneVersion, 2, h + 4);
+    h[6] = base != NULL ? 1 : 0;
+    putLE(sequence, 8, h + 8);
+    putLE(scene.points.size(), 4, h + 24);
+    putLE(scene.hull1.size(), 4, h + 28);
+    putLE(scene.hull2.size(), 4, h + 32);
+    putLE(scene.derived.size(), 4, h + 36);
+    putLE(base != NULL ? changes.size() : scene.points.size(), 4, h + 40);
+    putLE(scene.cacheValid ? 1 : 0, 4, h + 44);
+    memcpy(h + 48, &scene.view, sizeof(SceneView));
+
+    sceneAppend(scene.hull1, out);
+    sceneAppend(scene.hull2, out);
+    sceneAppend(scene.derived, out);
+    if (base != NULL) {
+        sceneAppend(changes, out);
+    }
+    else {
+        sceneAppend(scene.points, out);
+    }
+    putLE(out->size() - kSceneFrameHeader, 8, &(*out)[16]);
+}
+
+template <class T>
+inline void sceneTake(const uint8_t **p, size_t count, std::vector<T> *items)
+{
+    items->resize(count);
+    if (count > 0) {
+        memcpy(&(*items)[0], *p, count * sizeof(T));
+    }
+    *p += count * sizeof(T);
+}
+
+// Replay the frames in data onto scene. Returns false unless the data starts
+// with a full frame; a trailing partial or inconsistent frame is dropped.
+inline bool decodeSceneFrames(const uint8_t *data, size_t bytes, SceneSnapshot *scene)
+{
+    if (!hostLittleEndian()) {
+        return false;
+    }
+    size_t offset = 0;
+    uint64_t sequence = 0;
+    bool any = false;
+    std::vector<int32_t> hulls1;
+    std::vector<int32_t> hulls2;
+    std::vector<ScenePoint> derivedPoints;
+    std::vector<SceneChange> changes;
+    while (bytes - offset >= kSceneFrameHeader) {
+        const uint8_t *h = data + offset;
+        if (getLE(h, 4) != kSceneMagic || getLE(h + 4, 2) != kSceneVersion || h[6] > 1 || h[7] != 0) {
+            break;
+        }
+        bool delta = h[6] == 1;
+        uint64_t payload = getLE(h + 16, 8);
+        uint64_t points = getLE(h + 24, 4);
+        uint64_t hull1 = getLE(h + 28, 4);
+        uint64_t hull2 = getLE(h + 32, 4);
+        uint64_t derived = getLE(h + 36, 4);
+        uint64_t stored = getLE(h + 40, 4);
+        uint64_t expect = (hull1 + hull2) * sizeof(int32_t) + derived * sizeof(ScenePoint) + stored * (delta ? sizeof(SceneChange) : sizeof(ScenePoint));
+        if (delta != any || (any && getLE(h + 8, 8) != sequence + 1) || payload != expect || payload > bytes - offset - kSceneFrameHeader) {
+            break;
+        }
+        if (!delta && stored != points) {
+            break;
+        }
+
+        // Check everything before touching scene
+        const uint8_t *p = h + kSceneFrameHeader;
+        SceneView view;
+        memcpy(&view, h + 48, sizeof(SceneView));
+        sceneTake(&p, static_cast<size_t>(hull1), &hulls1);
+        sceneTake(&p, static_cast<size_t>(hull2), &hulls2);
+        sceneTake(&p, static_cast<size_t>(derived), &derivedPoints);
+        bool good = true;
+        for (size_t i = 0; i < hulls1.size() && good; i++) {
+            good = hulls1[i] >= 0 && static_cast<uint64_t>(hulls1[i]) < points;
+        }
+        for (size_t i = 0; i < hulls2.size() && good; i++) {
+            good = hulls2[i] >= 0 && static_cast<uint64_t>(hulls2[i]) < points;
+        }
+        if (delta) {
+            sceneTake(&p, static_cast<size_t>(stored), &changes);
+            for (size_t i = 0; i < changes.size() && good; i++) {
+                good = changes[i].index < points;
+            }
+        }
+        if (!good) {
+            break;
+        }
+
+        if (delta) {
+            scene->points.resize(static_cast<size_t>(points));
+            for (size_t i = 0; i < changes.size(); i++) {
+                scene->points[changes[i].index] = changes[i].point;
+            }
+        }
+        else {
+            sceneTake(&p, static_cast<size_t>(stored), &scene->points);
+        }
+        scene->view = view;
+        scene->hull1.swap(hulls1);
+        scene->hull2.swap(hulls2);
+        scene->derived.swap(derivedPoints);
+        scene->cacheValid = (getLE(h + 44, 4) & 1) != 0;
+        sequence = getLE(h + 8, 8);
+        offset += kSceneFrameHeader + static_cast<size_t>(payload);
+        any = true;
+    }
+    return any;
+}
+
+// Load a snapshot file with a single read
+inline bool loadScene(const char *path, SceneSnapshot *scene)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    bool ok = fseek(f, 0, SEEK_END) == 0;
+    long size = ok ? ftell(f) : -1;
+    ok = size > 0 && fseek(f, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = fread(&data[0], 1, data.size(), f) == data.size();
+    }
+    fclose(f);
+    return ok && decodeSceneFrames(&data[0], data.size(), scene);
+}
+
+// Move from over to, replacing any file there in one step where the
+// platform can: MoveFileEx on Windows, rename on POSIX. Elsewhere rename
+// may refuse an existing file, so it is removed first, and a crash between
+// the two leaves no snapshot.
+inline bool replaceSceneFile(const char *from, const char *to)
+{
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#elif defined(__unix__) || defined(__APPLE__)
+    return rename(from, to) == 0;
+#else
+    remove(to);
+    return rename(from, to) == 0;
+#endif
+}
+
+// Writes snapshots of one scene to one file, as full frames or deltas
+// against the last frame written. Save hands the scene to a background
+// thread and returns at once; if saves arrive faster than they are written,
+// only the newest waiting one is kept.
+class SceneSaver
+{
+public:
+    explicit SceneSaver(const std::string &path) : path(path), sequence(0), deltas(0), stop(false), busy(false), lastOk(true)
+    {
+        worker = std::thread(&SceneSaver::Run, this);
+    }
+
+    // Writes anything still waiting before returning
+    ~SceneSaver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    void Save(SceneSnapshot scene)
+    {
+        std::shared_ptr<SceneSnapshot> copy(new SceneSnapshot());
+        std::swap(*copy, scene);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = copy;
+        }
+        wake.notify_all();
+    }
+
+    // Save on the calling thread, after any pending save
+    bool SaveNow(const SceneSnapshot &scene)
+    {
+        Flush();
+        std::lock_guard<std::mutex> lock(writing);
+        return Write(scene);
+    }
+
+    // Wait until every save handed over so far is on disk
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return !pending && !busy; });
+    }
+
+    // Whether the most recent write succeeded
+    bool LastOk() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lastOk;
+    }
+
+    // Start the next save with a full frame, as after loading another file
+    void Reset()
+    {
+        Flush();
+        std::lock_guard<std::mutex> lock(writing);
+        base.reset();
+    }
+
+private:
+    SceneSaver(const SceneSaver &);
+    SceneSaver &operator=(const SceneSaver &);
+
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stop || pending; });
+            if (!pending) {
+                return;
+            }
+            std::shared_ptr<SceneSnapshot> scene;
+            scene.swap(pending);
+            busy = true;
+            lock.unlock();
+            bool ok;
+            {
+                std::lock_guard<std::mutex> write(writing);
+                ok = Write(*scene);
+            }
+            lock.lock();
+            busy = false;
+            lastOk = ok;
+            idle.notify_all();
+        }
+    }
+
+    // A delta while it stays well under the size of a full frame; a full
+    // frame goes to a temporary file first and then replaces the old file
+    bool Write(const SceneSnapshot &scene)
+    {
+        size_t changed = 0;
+        for (size_t i = 0; base && i < scene.points.size(); i++) {
+            changed += i >= base->points.size() || !scenePointEqual(scene.points[i], base->points[i]) ? 1 : 0;
+        }
+        bool delta = base && deltas < kSceneMaxDeltas && changed * sizeof(SceneChange) * 2 <= scene.points.size() * sizeof(ScenePoint);
+
+        std::vector<uint8_t> frame;
+        encodeSceneFrame(scene, delta ? base.get() : NULL, delta ? sequence + 1 : 0, &frame);
+        bool ok;
+        if (delta) {
+            FILE *f = fopen(path.c_str(), "ab");
+            ok = f != NULL && fwrite(&frame[0], 1, frame.size(), f) == frame.size();
+            ok = f != NULL && fclose(f) == 0 && ok;
+        }
+        else {
+            std::string temp = path + ".tmp";
+            FILE *f = fopen(temp.c_str(), "wb");
+            ok = f != NULL && fwrite(&frame[0], 1, frame.size(), f) == frame.size();
+            ok = f != NULL && fclose(f) == 0 && ok;
+            ok = ok && replaceSceneFile(temp.c_str(), path.c_str());
+        }
+
+        if (!ok) {
+            // The file may now be behind, so begin again from a full frame
+            base.reset();
+            return false;
+        }
+        base.reset(new SceneSnapshot(scene));
+        sequence = delta ? sequence + 1 : 0;
+        deltas = delta ? deltas + 1 : 0;
+        return true;
+    }
+
+    std::string                         path;
+    std::unique_ptr<SceneSnapshot>      base;       // Scene as of the last frame written
+    uint64_t                            sequence;
+    int                                 deltas;     // Deltas since the last full frame
+
+    std::thread                         worker;
+    mutable std::mutex                  mutex;
+    std::mutex                          writing;
+    std::condition_variable             wake;
+    std::condition_variable             idle;
+    std::shared_ptr<SceneSnapshot>      pending;
+    bool                                stop;
+    bool                                busy;
+    bool                                lastOk;
+};
+
+#endif
@@ -0,0 +1,378 @@
+#ifndef _STAGEPROFILE_H
+#define _STAGEPROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// Per-stage timing for the algorithm and draw stages of a frame.
+//
+// Define GEOMETRY_PROFILE to turn it on. Otherwise the STAGE_ macros expand
+// to nothing and instrumented code compiles exactly as before.
+//
+// A STAGE_SCOPE times the rest of its block and records one event with the
+// points it processed, the hull size it produced and the allocations made
+// on its thread meanwhile. Each thread records into its own ring buffer of
+// the last kProfileRingSize events and its own running totals. Only the
+// owning thread writes them, so recording takes no locks and no atomic
+// read-modify-writes; readers on other threads copy a ring and discard any
+// slot that was overwritten while they read it.
+//
+// From the rings come rolling histograms (the recent events of a stage) and
+// a Chrome trace-event JSON file for chrome://tracing or Perfetto.
+
+enum ProfileStage
+{
+    StagePaint,         // The whole of OnPaint
+    StageGrid,          // Background grid and axes
+    StageDrawPoints,    // Every ellipse
+    StageDrawOverlay,   // The current screen's Draw, with any recomputation nested in it
+    StagePartition,     // Splitting the points into groups
+    StageQuickHull,
+    StageMinkowski,     // Pairwise sum or difference, or the edge merge
+    StageRehull,        // Hull of the Minkowski points
+    StageCalipers,      // Minimum-area box
+    StageContains,      // Point in hull
+    StageIntersection,  // Overlap of the two hulls
+    StageTimeOfImpact,  // Swept GJK over a drag step
+    StageGJK,           // GJK overlap query
+    ProfileStageCount
+};
+
+const int       kProfileRingSize = 8192;    // Events kept per thread, a power of two
+const int       kProfileMaxThreads = 64;
+const int       kProfileBuckets = 48;       // Histogram bucket b holds durations in [2^b, 2^(b+1)) ns
+
+inline const char *profileStageName(int stage)
+{
+    static const char *names[] = {
+        "paint", "grid", "draw_points", "draw_overlay", "partition", "quickhull",
+        "minkowski", "rehull", "calipers", "contains", "intersection", "time_of_impact", "gjk"
+    };
+    return stage >= 0 && stage < ProfileStageCount ? names[stage] : "unknown";
+}
+
+// Nanoseconds since the first call in the process
+inline uint64_t profileNow()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+// Allocations made by this thread. Whatever counts allocations (an operator
+// new replacement, an accounting allocator) adds to it.
+inline uint64_t &profileThreadAllocations()
+{
+    static thread_local uint64_t count = 0;
+    return count;
+}
+
+struct ProfileEvent
+{
+    int         stage;
+    uint64_t    begin;      // ns, profileNow
+    uint64_t    duration;   // ns
+    uint32_t    points;
+    uint32_t    hull;
+    uint32_t    allocations;
+};
+
+struct ProfileTotals
+{
+    uint64_t    count;
+    uint64_t    nanoseconds;
+    uint64_t    points;
+    uint64_t    hull;
+    uint64_t    allocations;
+};
+
+// One thread's events. Slot fields are relaxed atomics so a reader racing the
+// writer sees torn slots only as a sequence mismatch, never as undefined
+// behaviour; on x86 the stores are plain moves.
+class ProfileRing
+{
+public:
+    explicit ProfileRing(int thread) : thread(thread), head(0)
+    {
+        for (int i = 0; i < kProfileRingSize; i++) {
+            slots[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        for (int s = 0; s < ProfileStageCount; s++) {
+            for (int f = 0; f < 5; f++) {
+                totals[s][f].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Owner thread only
+    void Push(const ProfileEvent &e)
+    {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Slot &slot = slots[index & (kProfileRingSize - 1)];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.begin.store(e.begin, std::memory_order_relaxed);
+        slot.duration.store(e.duration, std::memory_order_relaxed);
+        slot.stagePoints.store(static_cast<uint64_t>(e.stage) << 32 | e.points, std::memory_order_relaxed);
+        slot.hullAllocations.store(static_cast<uint64_t>(e.hull) << 32 | e.allocations, std::memory_order_relaxed);
+        slot.sequence.store(index + 1, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+
+        std::atomic<uint64_t> *t = totals[e.stage];
+        t[0].store(t[0].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        t[1].store(t[1].load(std::memory_order_relaxed) + e.duration, std::memory_order_relaxed);
+        t[2].store(t[2].load(std::memory_order_relaxed) + e.points, std::memory_order_relaxed);
+        t[3].store(t[3].load(std::memory_order_relaxed) + e.hull, std::memory_order_relaxed);
+        t[4].store(t[4].load(std::memory_order_relaxed) + e.allocations, std::memory_order_relaxed);
+    }
+
+    // Any thread: the events still in the ring, oldest first
+    void Copy(std::vector<ProfileEvent> *out) const
+    {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > static_cast<uint64_t>(kProfileRingSize) ? end - kProfileRingSize : 0;
+        for (uint64_t index = begin; index < end; index++) {
+            const Slot &slot = slots[index & (kProfileRingSize - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue;
+            }
+            ProfileEvent e;
+            e.begin = slot.begin.load(std::memory_order_relaxed);
+            e.duration = slot.duration.load(std::memory_order_relaxed);
+            uint64_t stagePoints = slot.stagePoints.load(std::memory_order_relaxed);
+            uint64_t hullAllocations = slot.hullAllocations.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+                continue;
+            }
+            e.stage = static_cast<int>(stagePoints >> 32);
+            e.points = static_cast<uint32_t>(stagePoints);
+            e.hull = static_cast<uint32_t>(hullAllocations >> 32);
+            e.allocations = static_cast<uint32_t>(hullAllocations);
+            out->push_back(e);
+        }
+    }
+
+    void Totals(int stage, ProfileTotals *t) const
+    {
+        t->count += totals[stage][0].load(std::memory_order_relaxed);
+        t->nanoseconds += totals[stage][1].load(std::memory_order_relaxed);
+        t->points += totals[stage][2].load(std::memory_order_relaxed);
+        t->hull += totals[stage][3].load(std::memory_order_relaxed);
+        t->allocations += totals[stage][4].load(std::memory_order_relaxed);
+    }
+
+    int Thread() const { return thread; }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t>   sequence;       // Index + 1 once written, 0 while being written
+        std::atomic<uint64_t>   begin;
+        std::atomic<uint64_t>   duration;
+        std::atomic<uint64_t>   stagePoints;
+        std::atomic<uint64_t>   hullAllocations;
+    };
+
+    int                     thread;
+    std::atomic<uint64_t>   head;
+    Slot                    slots[kProfileRingSize];
+    std::atomic<uint64_t>   totals[ProfileStageCount][5];
+};
+
+// Every thread's ring. A thread claims a slot the first time it records and
+// keeps its ring for the life of the process, so readers never see one freed.
+struct ProfileRegistry
+{
+    std::atomic<int>            count;
+    std::atomic<ProfileRing *>  rings[kProfileMaxThreads];
+};
+
+inline ProfileRegistry &profileRegistry()
+{
+    static ProfileRegistry registry = {};
+    return registry;
+}
+
+// This thread's ring, or NULL once kProfileMaxThreads threads have one
+inline ProfileRing *profileThreadRing()
+{
+    static thread_local ProfileRing *ring = NULL;
+    static thread_local bool claimed = false;
+    if (!claimed) {
+        claimed = true;
+        ProfileRegistry &registry = profileRegistry();
+        int thread = registry.count.fetch_add(1);
+        if (thread < kProfileMaxThreads) {
+            ring = new ProfileRing(thread);
+            registry.rings[thread].store(ring, std::memory_order_release);
+        }
+    }
+    return ring;
+}
+
+inline void profileRecord(const ProfileEvent &e)
+{
+    ProfileRing *ring = profileThreadRing();
+    if (ring != NULL) {
+        ring->Push(e);
+    }
+}
+
+// Times its scope as one event of a stage
+class ProfileScope
+{
+public:
+    ProfileScope(ProfileStage stage, size_t points) : stage(stage), points(static_cast<uint32_t>(points)), hull(0),
+        allocations(profileThreadAllocations()), begin(profileNow())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        ProfileEvent e = { stage, begin, profileNow() - begin, points, hull, static_cast<uint32_t>(profileThreadAllocations() - allocations) };
+        profileRecord(e);
+    }
+
+    void SetPoints(size_t n) { points = static_cast<uint32_t>(n); }
+    void SetHull(size_t n) { hull = static_cast<uint32_t>(n); }
+
+private:
+    ProfileStage    stage;
+    uint32_t        points;
+    uint32_t        hull;
+    uint64_t        allocations;
+    uint64_t        begin;
+};
+
+// The recent events of every thread, with the thread each came from
+inline void profileEvents(std::vector<ProfileEvent> *events, std::vector<int> *threads)
+{
+    ProfileRegistry &registry = profileRegistry();
+    int count = registry.count.load();
+    for (int t = 0; t < count && t < kProfileMaxThreads; t++) {
+        ProfileRing *ring = registry.rings[t].load(std::memory_order_acquire);
+        if (ring != NULL) {
+            ring->Copy(events);
+            threads->resize(events->size(), ring->Thread());
+        }
+    }
+}
+
+// Totals of a stage over every thread since the start of the process
+inline ProfileTotals profileTotals(int stage)
+{
+    ProfileTotals t = {};
+    ProfileRegistry &registry = profileRegistry();
+    int count = registry.count.load();
+    for (int i = 0; i < count && i < kProfileMaxThreads; i++) {
+        ProfileRing *ring = registry.rings[i].load(std::memory_order_acquire);
+        if (ring != NULL) {
+            ring->Totals(stage, &t);
+        }
+    }
+    return t;
+}
+
+// Log2 histogram of durations
+struct ProfileHistogram
+{
+    uint64_t    buckets[kProfileBuckets];
+    uint64_t    count;
+    uint64_t    maximum;
+
+    void Add(uint64_t ns)
+    {
+        int b = 0;
+        while (b + 1 < kProfileBuckets && (ns >> (b + 1)) != 0) {
+            b++;
+        }
+        buckets[b]++;
+        count++;
+        maximum = ns > maximum ? ns : maximum;
+    }
+
+    // Upper edge of the bucket holding quantile q, in ns
+    uint64_t Percentile(double q) const
+    {
+        uint64_t rank = static_cast<uint64_t>(q * count);
+        uint64_t seen = 0;
+        for (int b = 0; b < kProfileBuckets; b++) {
+            seen += buckets[b];
+            if (seen > rank) {
+                uint64_t edge = static_cast<uint64_t>(2) << b;
+                return edge < maximum ? edge : maximum;
+            }
+        }
+        return maximum;
+    }
+};
+
+// Histogram of a stage over the events still in the rings, so it follows
+// the recent frames rather than the whole run
+inline ProfileHistogram profileHistogram(int stage)
+{
+    ProfileHistogram h = {};
+    std::vector<ProfileEvent> events;
+    std::vector<int> threads;
+    profileEvents(&events, &threads);
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].stage == stage) {
+            h.Add(events[i].duration);
+        }
+    }
+    return h;
+}
+
+// One line per stage that has run: count, total and mean time, rolling
+// p50/p99, and the counters
+inline void printProfile(FILE *f)
+{
+    fprintf(f, "%-16s %10s %12s %10s %10s %10s %12s %10s %10s\n", "stage", "count", "total ms", "mean us", "p50 us", "p99 us", "points", "hull", "allocs");
+    for (int s = 0; s < ProfileStageCount; s++) {
+        ProfileTotals t = profileTotals(s);
+        if (t.count == 0) {
+            continue;
+        }
+        ProfileHistogram h = profileHistogram(s);
+        fprintf(f, "%-16s %10llu %12.3f %10.2f %10.2f %10.2f %12llu %10llu %10llu\n", profileStageName(s), static_cast<unsigned long long>(t.count),
+            t.nanoseconds * 1e-6, t.nanoseconds * 1e-3 / t.count, h.Percentile(0.5) * 1e-3, h.Percentile(0.99) * 1e-3,
+            static_cast<unsigned long long>(t.points), static_cast<unsigned long long>(t.hull), static_cast<unsigned long long>(t.allocations));
+    }
+}
+
+// The recent events as Chrome trace-event JSON, one complete ("X") event
+// each. Returns false if the file could not be written.
+inline bool writeChromeTrace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    std::vector<ProfileEvent> events;
+    std::vector<int> threads;
+    profileEvents(&events, &threads);
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    for (size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent &e = events[i];
+        fprintf(f, "{\"name\": \"%s\", \"cat\": \"geometry\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d, "
+            "\"args\": {\"points\": %u, \"hull\": %u, \"allocations\": %u}}%s\n",
+            profileStageName(e.stage), e.begin * 1e-3, e.duration * 1e-3, threads[i], e.points, e.hull, e.allocations, i + 1 < events.size() ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    return fclose(f) == 0;
+}
+
+#ifdef GEOMETRY_PROFILE
+#define STAGE_SCOPE(name, stage, points)    ProfileScope name(stage, points)
+#define STAGE_POINTS(name, n)               name.SetPoints(n)
+#define STAGE_HULL(name, n)                 name.SetHull(n)
+#else
+#define STAGE_SCOPE(name, stage, points)
+#define STAGE_POINTS(name, n)
+#define STAGE_HULL(name, n)
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef _SUPPORT2D_H
+#define _SUPPORT2D_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "hull2d.h"
+
+const int kSupportClimbSteps = 8;   // Longest warm-started climb before the O(log n) search takes over
+
+// Extreme-vertex queries on a counter-clockwise strictly convex polygon.
+//
+// The outward normal of edge i (vertex i to i + 1) is (ey, -ex). Going around
+// the polygon the normals turn counter-clockwise through one full circle, so
+// measured as angles from normal 0 they are sorted. Vertex i is extreme in
+// direction d exactly when d lies between the normals of edges i - 1 and i,
+// which makes support(d) a lower bound over the normals. Angles are never
+// formed: the order is decided by which half-plane of normal 0 a vector is in
+// and then by a cross product, both exact in Wide.
+template <class Scalar>
+class SupportPolygon
+{
+public:
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+
+    template <class Point, class Accessor>
+    void Build(const Point *p, int n, Accessor)
+    {
+        vertices.resize(n);
+        nx.resize(n);
+        ny.resize(n);
+        halves.resize(n);
+        for (int i = 0; i < n; i++) {
+            vertices[i] = MakeHullPoint<Scalar>(Accessor::X(p[i]), Accessor::Y(p[i]));
+        }
+        for (int i = 0; i < n; i++) {
+            const HullPointT<Scalar> &a = vertices[i];
+            const HullPointT<Scalar> &b = vertices[(i + 1) % n];
+            nx[i] = static_cast<Wide>(b.y) - a.y;
+            ny[i] = static_cast<Wide>(a.x) - b.x;
+        }
+        for (int i = 0; i < n; i++) {
+            halves[i] = static_cast<uint8_t>(Half(nx[i], ny[i]));
+        }
+    }
+
+    void Build(const HullPointT<Scalar> *p, int n)
+    {
+        Build(p, n, HullPointAccessor<Scalar>());
+    }
+
+    int Size() const { return static_cast<int>(vertices.size()); }
+    const HullPointT<Scalar> &Vertex(int i) const { return vertices[i]; }
+
+    // Index of a vertex furthest along (dx, dy), in O(log n). Ties between the
+    // two ends of an edge perpendicular to d go to either end.
+    int Support(Wide dx, Wide dy) const
+    {
+        int n = Size();
+        if (n <= 2) {
+            return n == 2 && Dot(1, dx, dy) > Dot(0, dx, dy) ? 1 : 0;
+        }
+        int dHalf = Half(dx, dy);
+        int lo = 0;
+        int len = n;
+        while (len > 0) {
+            int half = len >> 1;
+            if (NormalBefore(lo + half, dHalf, dx, dy)) {
+                lo += half + 1;
+                len -= half + 1;
+            }
+            else {
+                len = half;
+            }
+        }
+        return lo == n ? 0 : lo;
+    }
+
+    // Hill-climb from a previous answer; O(1) when the direction has turned
+    // little since, as between frames or GJK iterations. With maxSteps set it
+    // gives up after that many steps and returns -1.
+    int SupportFrom(Wide dx, Wide dy, int start, int maxSteps = -1) const
+    {
+        int n = Size();
+        if (n == 0) {
+            return 0;
+        }
+        int i = start >= 0 && start < n ? start : 0;
+        Wide best = Dot(i, dx, dy);
+        int step = Dot((i + 1) % n, dx, dy) > best ? 1 : n - 1;
+        int limit = maxSteps >= 0 && maxSteps < n ? maxSteps : n;
+        for (int k = 0; k < limit; k++) {
+            int j = (i + step) % n;
+            Wide temp = Dot(j, dx, dy);
+            if (temp <= best) {
+                return i;
+            }
+            best = temp;
+            i = j;
+        }
+        return limit < n ? -1 : i;
+    }
+
+    // Support for count directions. Every direction runs the same fixed
+    // ladder of halving steps, so the inner loop over directions has no
+    // data-dependent trip count and the compiler can vectorize it.
+    void SupportBatch(const Wide *dx, const Wide *dy, int count, int *out) const
+    {
+        int n = Size();
+        if (n <= 2) {
+            for (int k = 0; k < count; k++) {
+                out[k] = Support(dx[k], dy[k]);
+            }
+            return;
+        }
+
+        // out[k] counts the normals ordered before direction k
+        int step = 1;
+        while (step * 2 <= n) {
+            step *= 2;
+        }
+        for (int k = 0; k < count; k++) {
+            out[k] = 0;
+        }
+        for (; step > 0; step >>= 1) {
+            for (int k = 0; k < count; k++) {
+                int probe = out[k] + step;
+                int take = probe <= n ? NormalBefore(probe - 1, Half(dx[k], dy[k]), dx[k], dy[k]) : 0;
+                out[k] += take * step;
+            }
+        }
+        for (int k = 0; k < count; k++) {
+            out[k] = out[k] == n ? 0 : out[k];
+        }
+    }
+
+private:
+    Wide Dot(int i, Wide dx, Wide dy) const
+    {
+        return dx * vertices[i].x + dy * vertices[i].y;
+    }
+
+    // 0 for the half-turn starting at normal 0, 1 for the other
+    int Half(Wide x, Wide y) const
+    {
+        Wide cross = nx[0] * y - ny[0] * x;
+        return cross > 0 || (cross == 0 && nx[0] * x + ny[0] * y > 0) ? 0 : 1;
+    }
+
+    // Whether normal i comes strictly before d, counting from normal 0
+    bool NormalBefore(int i, int dHalf, Wide dx, Wide dy) const
+    {
+        int half = halves[i];
+        if (half != dHalf) {
+            return half < dHalf;
+        }
+        return nx[i] * dy - ny[i] * dx > 0;
+    }
+
+    std::vector<HullPointT<Scalar> >    vertices;
+    std::vector<Wide>                   nx;
+    std::vector<Wide>                   ny;
+    std::vector<uint8_t>                halves;
+};
+
+// Support of A - B from two prepared polygons. lastA and lastB keep the
+// vertices behind the most recent support point (-1 before the first), and
+// each call climbs from them while the direction has turned only a little.
+template <class Scalar>
+struct GJKPolygonSupport
+{
+    typedef typename ScalarTraits<Scalar>::Wide Wide;
+
+    const SupportPolygon<Scalar>    *a;
+    const SupportPolygon<Scalar>    *b;
+    mutable int                     lastA;
+    mutable int                     lastB;
+
+    WidePoint<Wide> operator()(WidePoint<Wide> d) const
+    {
+        lastA = Near(a, d.x, d.y, lastA);
+        lastB = Near(b, -d.x, -d.y, lastB);
+        const HullPointT<Scalar> &pa = a->Vertex(lastA);
+        const HullPointT<Scalar> &pb = b->Vertex(lastB);
+        WidePoint<Wide> p = { static_cast<Wide>(pa.x) - pb.x, static_cast<Wide>(pa.y) - pb.y };
+        return p;
+    }
+
+    static int Near(const SupportPolygon<Scalar> *p, Wide dx, Wide dy, int last)
+    {
+        int climbed = last >= 0 ? p->SupportFrom(dx, dy, last, kSupportClimbSteps) : -1;
+        return climbed >= 0 ? climbed : p->Support(dx, dy);
+    }
+};
+
+// Boolean GJK with O(log n) support on each side
+template <class Scalar>
+inline bool gjkOverlap(const SupportPolygon<Scalar> &a, const SupportPolygon<Scalar> &b)
+{
+    if (a.Size() == 0 || b.Size() == 0) {
+        return false;
+    }
+    GJKPolygonSupport<Scalar> support = { &a, &b, -1, -1 };
+    return gjkOverlapWith<typename ScalarTraits<Scalar>::Wide>(support);
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef _WORKLOAD_H
+#define _WORKLOAD_H
+
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+// Seeded point workloads for scenes and benchmarks.
+//
+// Point i is a pure function of the seed and i: a counter-based hash gives
+// its random bits, with no generator state carried from one point to the
+// next. The same seed gives the same points however the output is chunked,
+// and any range can be produced on its own, so a 100M point workload streams
+// through a fixed-size buffer.
+//
+// The random bits are the same everywhere. The points are too for the
+// square and degenerate distributions, which use only basic arithmetic. The
+// disk, circle, cluster and group distributions go through libm cos, sin and
+// log, which are not correctly rounded and differ between C libraries, so
+// their points repeat exactly only within one build on one platform.
+
+enum WorkloadDistribution
+{
+    UniformSquare,      // Uniform in the bounds
+    UniformDisk,        // Uniform in the largest disk inside the bounds
+    CirclePoints,       // On that disk's boundary, so every point is a hull vertex
+    GaussianClusters,   // Normal blobs around random centres
+    Degenerate,         // Three lines on a coarse lattice: collinear runs and duplicates
+    ManyGroups,         // Small disks on a grid, one group per disk
+    WorkloadDistributionCount
+};
+
+const uint64_t  kWorkloadSeed = 1;
+const int       kWorkloadChunk = 4096;
+const int       kWorkloadClusters = 8;
+const int       kWorkloadGroups = 64;
+const int       kWorkloadLattice = 32;
+
+struct WorkloadSpec
+{
+    WorkloadDistribution    distribution;
+    uint64_t                seed;
+    uint64_t                count;
+    float                   minX;
+    float                   minY;
+    float                   maxX;
+    float                   maxY;
+    int                     clusters;   // GaussianClusters
+    int                     groups;     // ManyGroups
+};
+
+inline WorkloadSpec makeWorkload(WorkloadDistribution distribution, uint64_t count, uint64_t seed = kWorkloadSeed)
+{
+    WorkloadSpec spec = { distribution, seed, count, 0.0f, 0.0f, 4096.0f, 4096.0f, kWorkloadClusters, kWorkloadGroups };
+    return spec;
+}
+
+inline const char *workloadName(WorkloadDistribution distribution)
+{
+    static const char *names[] = { "square", "disk", "circle", "clusters", "degenerate", "groups" };
+    return distribution >= 0 && distribution < WorkloadDistributionCount ? names[distribution] : "unknown";
+}
+
+// Returns false if name is not one of the workloadName strings
+inline bool parseWorkload(const char *name, WorkloadDistribution *distribution)
+{
+    for (int d = 0; d < WorkloadDistributionCount; d++) {
+        if (strcmp(name, workloadName(static_cast<WorkloadDistribution>(d))) == 0) {
+            *distribution = static_cast<WorkloadDistribution>(d);
+            return true;
+        }
+    }
+    return false;
+}
+
+// SplitMix64 finalizer over (seed, index, stream)
+inline uint64_t workloadHash(uint64_t seed, uint64_t index, uint64_t stream)
+{
+    uint64_t z = seed * 0xD1B54A32D192ED03ull + (index * 4 + stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// In [0, 1)
+inline double workloadUnit(uint64_t bits)
+{
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+class WorkloadGenerator
+{
+public:
+    explicit WorkloadGenerator(const WorkloadSpec &spec) : spec(spec), position(0)
+    {
+        if (this->spec.clusters < 1) {
+            this->spec.clusters = 1;
+        }
+        if (this->spec.groups < 1) {
+            this->spec.groups = 1;
+        }
+    }
+
+    // Point i of the workload. group is 0 except for ManyGroups.
+    void Point(uint64_t i, float *x, float *y, uint32_t *group) const
+    {
+        const double pi2 = 6.283185307179586;
+        double w = static_cast<double>(spec.maxX) - spec.minX;
+        double h = static_cast<double>(spec.maxY) - spec.minY;
+        double cx = spec.minX + 0.5 * w;
+        double cy = spec.minY + 0.5 * h;
+        double r = 0.5 * (w < h ? w : h);
+        double u = workloadUnit(workloadHash(spec.seed, i, 0));
+        double v = workloadUnit(workloadHash(spec.seed, i, 1));
+        double px = cx;
+        double py = cy;
+        *group = 0;
+
+        switch (spec.distribution) {
+        case UniformSquare:
+            px = spec.minX + u * w;
+            py = spec.minY + v * h;
+            break;
+
+        case UniformDisk:
+            px = cx + r * sqrt(u) * cos(pi2 * v);
+            py = cy + r * sqrt(u) * sin(pi2 * v);
+            break;
+
+        case CirclePoints:
+            px = cx + r * cos(pi2 * u);
+            py = cy + r * sin(pi2 * u);
+            break;
+
+        case GaussianClusters: {
+            uint64_t c = workloadHash(spec.seed, i, 2) % static_cast<uint64_t>(spec.clusters);
+            double mx = spec.minX + (0.1 + 0.8 * workloadUnit(workloadHash(spec.seed, c, 3))) * w;
+            double my = spec.minY + (0.1 + 0.8 * workloadUnit(workloadHash(~spec.seed, c, 3))) * h;
+            double sigma = 0.05 * r;
+            double m = sigma * sqrt(-2.0 * log(1.0 - u));
+            px = mx + m * cos(pi2 * v);
+            py = my + m * sin(pi2 * v);
+            break;
+        }
+
+        // Integral bounds give exactly collinear lattice points
+        case Degenerate: {
+            uint64_t bits = workloadHash(spec.seed, i, 2);
+            double k = static_cast<double>(bits % (kWorkloadLattice + 1));
+            double sx = floor(w / kWorkloadLattice);
+            double sy = floor(h / kWorkloadLattice);
+            int line = static_cast<int>((bits >> 32) % 3);
+            px = line == 2 ? cx : spec.minX + k * sx;
+            py = line == 1 ? cy : spec.minY + k * sy;
+            break;
+        }
+
+        case ManyGroups: {
+            int side = static_cast<int>(ceil(sqrt(static_cast<double>(spec.groups))));
+            uint64_t g = workloadHash(spec.seed, i, 2) % static_cast<uint64_t>(spec.groups);
+            double cellW = w / side;
+            double cellH = h / side;
+            double cellR = 0.4 * (cellW < cellH ? cellW : cellH);
+            px = spec.minX + (static_cast<double>(g % side) + 0.5) * cellW + cellR * sqrt(u) * cos(pi2 * v);
+            py = spec.minY + (static_cast<double>(g / side) + 0.5) * cellH + cellR * sqrt(u) * sin(pi2 * v);
+            *group = static_cast<uint32_t>(g);
+            break;
+        }
+
+        default:
+            break;
+        }
+        *x = static_cast<float>(px);
+        *y = static_cast<float>(py);
+    }
+
+    // The next chunk of up to capacity points in structure-of-arrays form;
+    // groups may be NULL. Returns how many were written, 0 at the end.
+    int Next(float *xs, float *ys, uint32_t *groups, int capacity)
+    {
+        uint64_t left = spec.count - position;
+        int n = left < static_cast<uint64_t>(capacity) ? static_cast<int>(left) : capacity;
+        uint32_t group;
+        for (int k = 0; k < n; k++) {
+            Point(position + k, &xs[k], &ys[k], groups != NULL ? &groups[k] : &group);
+        }
+        position += n;
+        return n;
+    }
+
+    void Seek(uint64_t i) { position = i < spec.count ? i : spec.count; }
+    uint64_t Position() const { return position; }
+    bool Done() const { return position >= spec.count; }
+    const WorkloadSpec &Spec() const { return spec; }
+
+private:
+    WorkloadSpec    spec;
+    uint64_t        position;
+};
+
+#endif